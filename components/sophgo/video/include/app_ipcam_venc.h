@@ -235,6 +235,9 @@ typedef int (*pfpDataConsumes)(void *pData, void *pCtx, void *pUserData);
 
 APP_PARAM_VENC_CTX_S *app_ipcam_Venc_Param_Get(void);
 int app_ipcam_Venc_Consumes_Set(int chn, int index, pfpDataConsumes consume, void *pUserData);
+/* keep a stream passed to a consumer after it returns, until the matching release */
+void app_ipcam_Venc_Stream_Ref(VENC_STREAM_S *pstStream);
+void app_ipcam_Venc_Stream_Release(VENC_STREAM_S *pstStream);
 char *app_ipcam_Postfix_Get(PAYLOAD_TYPE_E enPayload);
 int app_ipcam_Venc_Init(APP_VENC_CHN_E VencIdx);
 int app_ipcam_Venc_Start(APP_VENC_CHN_E VencIdx);
@@ -1,7 +1,9 @@
 
 #include <sys/prctl.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <cvi_type.h>
 #include <cvi_vpss.h>
@@ -16,6 +18,10 @@
 #define H26X_MAX_NUM_PACKS      8
 #define JPEG_MAX_NUM_PACKS      1
 
+#define STREAM_POOL_MIN_SHIFT   14                  /* 16KB, smallest size class */
+#define STREAM_POOL_CLASSES     9                   /* up to 4MB, larger streams are not pooled */
+#define STREAM_POOL_MAX_SIZE    (8 * 1024 * 1024)   /* idle buffers kept for reuse */
+
 /**************************************************************************
  *                           C O N S T A N T S                            *
  **************************************************************************/
@@ -23,6 +29,16 @@
 /**************************************************************************
  *                          D A T A    T Y P E S                          *
  **************************************************************************/
+/* a saved stream and its packs in one allocation, the payloads packed back to back */
+typedef struct APP_STREAM_BUF_T {
+    struct APP_STREAM_BUF_T *pNext;
+    CVI_S32 s32Ref;
+    CVI_S32 s32Class;
+    CVI_U32 u32Capacity;
+    VENC_STREAM_S stStream;
+    VENC_PACK_S astPack[H26X_MAX_NUM_PACKS];
+    CVI_U8 au8Data[];
+} APP_STREAM_BUF_S;
 
 /**************************************************************************
  *                         G L O B A L    D A T A                         *
@@ -35,6 +51,10 @@ static void *g_pDataCtx[VENC_CHN_MAX] = { NULL };
 static void *g_pUserData[VENC_CHN_MAX][APP_DATA_COMSUMES_MAX] = { NULL };
 static pfpDataConsumes g_Consumes[VENC_CHN_MAX][APP_DATA_COMSUMES_MAX] = { NULL };
 
+static pthread_mutex_t g_StreamPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static APP_STREAM_BUF_S *g_pStreamPool[STREAM_POOL_CLASSES] = { NULL };
+static CVI_U32 g_u32StreamPoolSize = 0;
+
 /**************************************************************************
  *                 E X T E R N A L    R E F E R E N C E S                 *
  **************************************************************************/
@@ -798,6 +818,77 @@ static void _Data_Handle(void* pData, void* pArgs)
     }
 }
 
+static APP_STREAM_BUF_S *_Stream_Buf_Get(CVI_U32 u32Size)
+{
+    APP_STREAM_BUF_S *pBuf = NULL;
+    CVI_S32 s32Class = 0;
+
+    while ((s32Class < STREAM_POOL_CLASSES) && (((CVI_U32)1 << (STREAM_POOL_MIN_SHIFT + s32Class)) < u32Size)) {
+        s32Class++;
+    }
+
+    if (s32Class < STREAM_POOL_CLASSES) {
+        u32Size = (CVI_U32)1 << (STREAM_POOL_MIN_SHIFT + s32Class);
+        pthread_mutex_lock(&g_StreamPoolMutex);
+        pBuf = g_pStreamPool[s32Class];
+        if (pBuf) {
+            g_pStreamPool[s32Class] = pBuf->pNext;
+            g_u32StreamPoolSize -= pBuf->u32Capacity;
+        }
+        pthread_mutex_unlock(&g_StreamPoolMutex);
+    } else {
+        s32Class = -1;
+    }
+
+    if (pBuf == NULL) {
+        pBuf = (APP_STREAM_BUF_S *)malloc(sizeof(APP_STREAM_BUF_S) + u32Size);
+        if (pBuf == NULL) {
+            return NULL;
+        }
+        pBuf->s32Class = s32Class;
+        pBuf->u32Capacity = u32Size;
+    }
+
+    pBuf->pNext = NULL;
+    pBuf->s32Ref = 1;
+
+    return pBuf;
+}
+
+static void _Stream_Buf_Put(APP_STREAM_BUF_S *pBuf)
+{
+    if (__atomic_sub_fetch(&pBuf->s32Ref, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+
+    if (pBuf->s32Class >= 0) {
+        pthread_mutex_lock(&g_StreamPoolMutex);
+        if (g_u32StreamPoolSize + pBuf->u32Capacity <= STREAM_POOL_MAX_SIZE) {
+            pBuf->pNext = g_pStreamPool[pBuf->s32Class];
+            g_pStreamPool[pBuf->s32Class] = pBuf;
+            g_u32StreamPoolSize += pBuf->u32Capacity;
+            pBuf = NULL;
+        }
+        pthread_mutex_unlock(&g_StreamPoolMutex);
+    }
+
+    free(pBuf);
+}
+
+void app_ipcam_Venc_Stream_Ref(VENC_STREAM_S *pstStream)
+{
+    APP_STREAM_BUF_S *pBuf = (APP_STREAM_BUF_S *)((CVI_U8 *)pstStream - offsetof(APP_STREAM_BUF_S, stStream));
+
+    __atomic_add_fetch(&pBuf->s32Ref, 1, __ATOMIC_RELAXED);
+}
+
+void app_ipcam_Venc_Stream_Release(VENC_STREAM_S *pstStream)
+{
+    _Stream_Buf_Put((APP_STREAM_BUF_S *)((CVI_U8 *)pstStream - offsetof(APP_STREAM_BUF_S, stStream)));
+}
+
+/* one pooled copy per stream: every pack keeps its payload only (u32Offset 0), so packs that
+ * follow each other are contiguous and consumers can reference them instead of copying */
 static CVI_S32 _Data_Save(void **dst, void *src)
 {
     if(dst == NULL || src == NULL) {
@@ -806,46 +897,41 @@ static CVI_S32 _Data_Save(void **dst, void *src)
     }
 
     CVI_U32 i = 0;
+    CVI_U32 u32Size = 0;
     VENC_STREAM_S *psrc = (VENC_STREAM_S *)src;
-    VENC_STREAM_S *pdst = (VENC_STREAM_S *)malloc(sizeof(VENC_STREAM_S));
-    if(pdst == NULL) {
-        APP_PROF_LOG_PRINT(LEVEL_ERROR, "pdst malloc failded\n");
+
+    if (psrc->u32PackCount > H26X_MAX_NUM_PACKS) {
+        APP_PROF_LOG_PRINT(LEVEL_ERROR, "too many packs %d\n", psrc->u32PackCount);
         return CVI_FAILURE;
     }
-    memcpy(pdst, psrc, sizeof(VENC_STREAM_S));
-    pdst->pstPack = (VENC_PACK_S *)malloc(sizeof(VENC_PACK_S) * psrc->u32PackCount);
-    if(pdst->pstPack == NULL) {
-        APP_PROF_LOG_PRINT(LEVEL_ERROR, "pdst->pstPack malloc failded\n");
-        goto EXIT1;
-    }
-    memset(pdst->pstPack, 0, sizeof(VENC_PACK_S) * psrc->u32PackCount);
+
     for(i = 0; i < psrc->u32PackCount; i++) {
-        memcpy(&pdst->pstPack[i], &psrc->pstPack[i], sizeof(VENC_PACK_S));
-        pdst->pstPack[i].pu8Addr = (CVI_U8 *)malloc(psrc->pstPack[i].u32Len);
-        if(!pdst->pstPack[i].pu8Addr) {
-            goto EXIT2;
-        }
-        memcpy(pdst->pstPack[i].pu8Addr, psrc->pstPack[i].pu8Addr, psrc->pstPack[i].u32Len);
+        u32Size += psrc->pstPack[i].u32Len - psrc->pstPack[i].u32Offset;
     }
 
-    *dst = (void *)pdst;
-
-    return CVI_SUCCESS;
+    APP_STREAM_BUF_S *pBuf = _Stream_Buf_Get(u32Size);
+    if(pBuf == NULL) {
+        APP_PROF_LOG_PRINT(LEVEL_ERROR, "stream buffer malloc failded\n");
+        return CVI_FAILURE;
+    }
 
-EXIT2:
-    if(pdst->pstPack) {
-        for(i = 0;i < psrc->u32PackCount; i++) {
-            if(pdst->pstPack[i].pu8Addr) {
-                free(pdst->pstPack[i].pu8Addr);
-            }
-        }
-        free(pdst->pstPack);
+    CVI_U8 *pu8Data = pBuf->au8Data;
+    VENC_STREAM_S *pdst = &pBuf->stStream;
+    memcpy(pdst, psrc, sizeof(VENC_STREAM_S));
+    pdst->pstPack = pBuf->astPack;
+    for(i = 0; i < psrc->u32PackCount; i++) {
+        VENC_PACK_S *pPack = &psrc->pstPack[i];
+        memcpy(&pdst->pstPack[i], pPack, sizeof(VENC_PACK_S));
+        pdst->pstPack[i].pu8Addr = pu8Data;
+        pdst->pstPack[i].u32Len = pPack->u32Len - pPack->u32Offset;
+        pdst->pstPack[i].u32Offset = 0;
+        memcpy(pu8Data, pPack->pu8Addr + pPack->u32Offset, pPack->u32Len - pPack->u32Offset);
+        pu8Data += pPack->u32Len - pPack->u32Offset;
     }
 
-EXIT1:
-    free(pdst);
+    *dst = (void *)pdst;
 
-    return CVI_FAILURE;
+    return CVI_SUCCESS;
 }
 
 static CVI_S32 _Data_Free(void **src)
@@ -855,20 +941,9 @@ static CVI_S32 _Data_Free(void **src)
         return CVI_FAILURE;
     }
 
-    VENC_STREAM_S *psrc = NULL;
-    psrc = (VENC_STREAM_S *)*src;
-
-    if(psrc->pstPack) {
-        for(CVI_U32 i = 0; i < psrc->u32PackCount; i++) {
-            if(psrc->pstPack[i].pu8Addr) {
-                free(psrc->pstPack[i].pu8Addr);
-            }
-        }
-        free(psrc->pstPack);
-    }
-    if(psrc) {
-        free(psrc);
-    }
+    /* consumers may still hold a reference, see app_ipcam_Venc_Stream_Ref */
+    app_ipcam_Venc_Stream_Release((VENC_STREAM_S *)*src);
+    *src = NULL;
 
     return CVI_SUCCESS;
 }
@@ -882,6 +957,9 @@ static void* Thread_Streaming_Proc(void* pArgs)
     CVI_S32 vpssChn = pastVencChnCfg->VpssChn;
     CVI_S32 iTime = GetCurTimeInMsec();
 
+    /* pack descriptors, filled by CVI_VENC_GetStream for every frame */
+    VENC_PACK_S astPack[H26X_MAX_NUM_PACKS];
+
     CVI_CHAR TaskName[64] = { '\0' };
     sprintf(TaskName, "Thread_Venc%d_Proc", VencChn);
     prctl(PR_SET_NAME, TaskName, 0, 0, 0);
@@ -946,11 +1024,7 @@ static void* Thread_Streaming_Proc(void* pArgs)
 
         // get stream
         VENC_STREAM_S stStream = { 0 };
-        stStream.pstPack = (VENC_PACK_S*)malloc(sizeof(VENC_PACK_S) * H26X_MAX_NUM_PACKS);
-        if (stStream.pstPack == NULL) {
-            APP_PROF_LOG_PRINT(LEVEL_ERROR, "streaming malloc memory failed!\n");
-            break;
-        }
+        stStream.pstPack = astPack;
 
         ISP_EXP_INFO_S stExpInfo;
         memset(&stExpInfo, 0, sizeof(stExpInfo));
@@ -984,7 +1058,6 @@ static void* Thread_Streaming_Proc(void* pArgs)
         }
 
     CONTINUE:
-        free(stStream.pstPack);
         stStream.pstPack = NULL;
     }
 
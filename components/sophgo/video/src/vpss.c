@@ -122,6 +122,13 @@ static int app_ipcam_Vpss_Create(VPSS_GRP VpssGrp)
                 goto VPSS_EXIT;
             }
 
+            if (pstVpssGrpCfg->aenChnRotation[VpssChn] != ROTATION_0) {
+                if ((s32Ret = CVI_VPSS_SetChnRotation(pstVpssGrpCfg->VpssGrp, VpssChn, pstVpssGrpCfg->aenChnRotation[VpssChn])) != CVI_SUCCESS) {
+                    APP_PROF_LOG_PRINT(LEVEL_ERROR, "CVI_VPSS_SetChnRotation(%d) failed with %d\n", VpssChn, s32Ret);
+                    goto VPSS_EXIT;
+                }
+            }
+
             if ((bSBMEnable) && (VpssGrp == 0) && (VpssChn == 0)) {
                 APP_PROF_LOG_PRINT(LEVEL_INFO, "CVI_VPSS_SetChnBufWrapAttr grp(%d) chn(%d) \n", VpssGrp, VpssChn);
                 VPSS_CHN_BUF_WRAP_S stVpssChnBufWrap = {0};
@@ -133,6 +133,32 @@ int setupVideo(video_ch_index_t ch, const video_ch_param_t* param) {
     return 0;
 }
 
+int setupVideoTransform(video_ch_index_t ch, const video_ch_transform_t* transform) {
+    APP_PARAM_VPSS_CFG_T* vpss = app_ipcam_Vpss_Param_Get();
+
+    if (ch >= VIDEO_CH_MAX) {
+        APP_PROF_LOG_PRINT(LEVEL_ERROR, "video ch(%d) index is out of range\n", ch);
+        return -1;
+    }
+    if (transform == NULL) {
+        APP_PROF_LOG_PRINT(LEVEL_ERROR, "video ch(%d) transform is null\n", ch);
+        return -1;
+    }
+
+    APP_VPSS_GRP_CFG_T* pgrp   = &vpss->astVpssGrpCfg[0];
+    VPSS_CROP_INFO_S* crop     = &pgrp->stVpssChnCropInfo[ch];
+    crop->bEnable              = (transform->crop_width > 0 && transform->crop_height > 0) ? CVI_TRUE : CVI_FALSE;
+    crop->enCropCoordinate     = VPSS_CROP_ABS_COOR;
+    crop->stCropRect.s32X      = transform->crop_x;
+    crop->stCropRect.s32Y      = transform->crop_y;
+    crop->stCropRect.u32Width  = transform->crop_width;
+    crop->stCropRect.u32Height = transform->crop_height;
+
+    pgrp->aenChnRotation[ch] = (ROTATION_E)transform->rotation;
+
+    return 0;
+}
+
 int registerVideoFrameHandler(video_ch_index_t ch, int index, pfpDataConsumes handler, void* pUserData) {
     app_ipcam_Venc_Consumes_Set(ch, index, handler, pUserData);
     return 0;
@@ -32,6 +32,24 @@ typedef struct {
     uint8_t fps;
 } video_ch_param_t;
 
+// clockwise, as ROTATION_E
+typedef enum {
+    VIDEO_ROTATION_0 = 0,
+    VIDEO_ROTATION_90,
+    VIDEO_ROTATION_180,
+    VIDEO_ROTATION_270,
+} video_rotation_t;
+
+// done by the VPSS before the channel scaling: crop in sensor pixels (0 width keeps the whole
+// frame), then rotation, the channel width/height being the size after rotation
+typedef struct {
+    int32_t crop_x;
+    int32_t crop_y;
+    uint32_t crop_width;
+    uint32_t crop_height;
+    video_rotation_t rotation;
+} video_ch_transform_t;
+
 // typedef struct {
 //     uint32_t width;
 //     uint32_t height;
@@ -45,6 +63,7 @@ int initVideo(void);
 int deinitVideo(void);
 int startVideo(void);
 int setupVideo(video_ch_index_t ch, const video_ch_param_t* param);
+int setupVideoTransform(video_ch_index_t ch, const video_ch_transform_t* transform);
 int registerVideoFrameHandler(video_ch_index_t ch, int index, pfpDataConsumes handler, void* pUserData);
 
 #ifdef __cplusplus
@@ -1,7 +1,10 @@
 #include <cstddef>
+#include <cstdio>
 #include <cstdlib>
-#include <fstream>
-#include <sstream>
+#include <cstring>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
 
@@ -13,7 +16,7 @@ namespace ma {
 
 constexpr char TAG[] = "ma::storage::file";
 
-StorageFile::StorageFile() : Storage(), root_(nullptr), mutex_() {}
+StorageFile::StorageFile() : Storage(), root_(nullptr), mutex_(), dirty_(false), window_(0), pending_(0), writer_(nullptr), writing_(false) {}
 StorageFile::~StorageFile() {
     deInit();
 }
@@ -28,9 +31,7 @@ ma_err_t StorageFile::init(const void* config) noexcept {
     }
     filename_ = std::string(reinterpret_cast<const char*>(config));
     if (access(filename_.c_str(), F_OK) != 0) {
-        std::ofstream file(filename_);
-        file << "{}";
-        file.close();
+        write("{}");
     }
     if (access(filename_.c_str(), R_OK | W_OK) != 0) {
         MA_LOGE(TAG, "Failed to access file %s", filename_.c_str());
@@ -38,11 +39,28 @@ ma_err_t StorageFile::init(const void* config) noexcept {
     }
     MA_LOGD(TAG, "StorageFile::init: %s", filename_.c_str());
     load();
+    if (window_ > 0) {
+        writer_ = new Thread("storage", writerEntryStub);
+        if (writer_ == nullptr) {
+            return MA_ENOMEM;
+        }
+        writing_.store(true);
+        writer_->start(this);
+    }
     m_initialized = true;
     return MA_OK;
 }
 
 void StorageFile::deInit() noexcept {
+    // the writer takes the lock, stop it first
+    if (writing_.exchange(false)) {
+        pending_.signal();
+        writer_->join();
+    }
+    if (writer_) {
+        delete writer_;
+        writer_ = nullptr;
+    }
     Guard guard(mutex_);
     if (!m_initialized) [[unlikely]] {
         return;
@@ -50,29 +68,107 @@ void StorageFile::deInit() noexcept {
     save();
     if (root_) {
         cJSON_Delete(root_);
+        root_ = nullptr;
     }
     m_initialized = false;
 }
 
+void StorageFile::setWriteBehind(ma_tick_t window) noexcept {
+    Guard guard(mutex_);
+    if (m_initialized) {
+        MA_LOGW(TAG, "write-behind must be set before init");
+        return;
+    }
+    window_ = window;
+}
+
+void StorageFile::sync() noexcept {
+    save();
+}
+
+void StorageFile::touch() {
+    dirty_ = true;
+    if (writing_.load()) {
+        pending_.signal();
+    } else {
+        save();
+    }
+}
+
+void StorageFile::writerEntry() {
+    while (writing_.load()) {
+        pending_.wait();
+        // let the changes made in the window pile up, then write them at once
+        Thread::sleep(window_);
+        while (pending_.wait(0)) {
+        }
+        save();
+    }
+}
+
+void StorageFile::writerEntryStub(void* obj) {
+    reinterpret_cast<StorageFile*>(obj)->writerEntry();
+}
+
 void StorageFile::save() {
     Guard guard(mutex_);
-    if (root_) {
-        char* jsonString = cJSON_Print(root_);
-        std::ofstream file(filename_);
-        file << jsonString;
-        file.close();
+    if (root_ && dirty_) {
+        char* jsonString = cJSON_PrintUnformatted(root_);
+        if (jsonString && write(jsonString)) {
+            dirty_ = false;
+        }
         cJSON_free(jsonString);
     }
 }
 
+// the file is replaced as a whole, a crash leaves either the previous or the new content
+bool StorageFile::write(const std::string& content) {
+    std::string temp = filename_ + ".tmp";
+    int fd           = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        MA_LOGE(TAG, "Failed to open %s", temp.c_str());
+        return false;
+    }
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = ::write(fd, content.data() + written, content.size() - written);
+        if (n <= 0) {
+            break;
+        }
+        written += n;
+    }
+    bool ok = written == content.size() && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(temp.c_str(), filename_.c_str()) != 0) {
+        MA_LOGE(TAG, "Failed to write %s", filename_.c_str());
+        unlink(temp.c_str());
+        return false;
+    }
+    // make the rename itself durable
+    std::vector<char> path(filename_.begin(), filename_.end());
+    path.push_back('\0');
+    int dir = open(dirname(path.data()), O_RDONLY | O_DIRECTORY);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+    return true;
+}
+
 void StorageFile::load() {
     Guard guard(mutex_);
-    std::ifstream file(filename_);
-    if (file.is_open()) {
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        file.close();
-        root_ = cJSON_Parse(buffer.str().c_str());
+    int fd = open(filename_.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            std::string buffer(st.st_size, '\0');
+            ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n > 0) {
+                buffer.resize(n);
+                root_ = cJSON_Parse(buffer.c_str());
+            }
+        }
+        close(fd);
     }
     if (!root_) {
         root_ = cJSON_CreateObject();
@@ -105,6 +201,21 @@ cJSON* StorageFile::getNode(const std::string& key) {
     return current;
 }
 
+// the values set are strings and numbers only
+static bool sameValue(const cJSON* a, const cJSON* b) {
+    if (a == nullptr || b == nullptr || (a->type & 0xff) != (b->type & 0xff)) {
+        return false;
+    }
+    switch (a->type & 0xff) {
+        case cJSON_String:
+            return a->valuestring != nullptr && b->valuestring != nullptr && strcmp(a->valuestring, b->valuestring) == 0;
+        case cJSON_Number:
+            return a->valuedouble == b->valuedouble;
+        default:
+            return false;
+    }
+}
+
 ma_err_t StorageFile::setNode(const std::string& key, cJSON* value) {
     Guard guard(mutex_);
     std::vector<std::string> parts = splitKey(key);
@@ -116,12 +227,17 @@ ma_err_t StorageFile::setNode(const std::string& key, cJSON* value) {
             cJSON_AddItemToObject(parent, part.c_str(), child);
         }
         if (part == parts.back()) {
+            // setting the stored value again does not dirty the store
+            if (sameValue(child, value)) {
+                cJSON_Delete(value);
+                return MA_OK;
+            }
             cJSON_ReplaceItemInObjectCaseSensitive(parent, part.c_str(), value);
             break;
         }
         parent = child;
     }
-    save();
+    touch();
     return MA_OK;
 }
 
@@ -185,8 +301,11 @@ ma_err_t StorageFile::remove(const std::string& key) noexcept {
             return MA_ENOENT;
         }
     }
+    if (cJSON_GetObjectItemCaseSensitive(current, parts.back().c_str()) == nullptr) {
+        return MA_OK;
+    }
     cJSON_DeleteItemFromObjectCaseSensitive(current, parts.back().c_str());
-    save();
+    touch();
     return MA_OK;
 }
 
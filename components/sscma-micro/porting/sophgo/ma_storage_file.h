@@ -1,7 +1,9 @@
 #ifndef _MA_STORAGE_FILE_H_
 #define _MA_STORAGE_FILE_H_
 
+#include <atomic>
 #include <fstream>
+#include <string>
 
 #include <cJSON.h>
 
@@ -20,6 +22,12 @@ public:
     ma_err_t init(const void* config) noexcept override;
     void deInit() noexcept override;
 
+    // coalesce the changes made within `window` into a single write done by a background
+    // thread, to be called before init(), 0 (the default) writes on every change
+    void setWriteBehind(ma_tick_t window) noexcept;
+    // write the pending changes now
+    void sync() noexcept;
+
 
     ma_err_t set(const std::string& key, int64_t value) noexcept override;
     ma_err_t set(const std::string& key, double value) noexcept override;
@@ -36,9 +44,18 @@ private:
     std::string filename_;
     cJSON* root_;
     Mutex mutex_;
+    bool dirty_;
+    ma_tick_t window_;
+    Semaphore pending_;
+    Thread* writer_;
+    std::atomic<bool> writing_;
 
+    void touch();
     void save();
     void load();
+    bool write(const std::string& content);
+    void writerEntry();
+    static void writerEntryStub(void* obj);
     cJSON* getNode(const std::string& key);
     ma_err_t setNode(const std::string& key, cJSON* value);
 };
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <vector>
+
 #include "ma_transport_websocket.h"
 
 namespace ma {
@@ -6,8 +9,14 @@ using namespace hv;
 
 static const char* TAG = "ma::transport::websocket";
 
+// messages kept for a client, past this the oldest is dropped
+#define WS_CLIENT_QUEUE 16
+// bytes a socket may still hold before its client is considered slow and skipped
+#define WS_CLIENT_BACKLOG (64 * 1024)
+
 
-TransportWebSocket::TransportWebSocket() : Transport{MA_TRANSPORT_WS}, m_port(8080), m_receiveBuffer(nullptr) {}
+TransportWebSocket::TransportWebSocket()
+    : Transport{MA_TRANSPORT_WS}, m_port(8080), m_encoding("json"), m_generation(0), m_receiveBuffer(nullptr), m_signal(0), m_thread(nullptr), m_sending(false) {}
 TransportWebSocket::~TransportWebSocket() {
     deInit();
 }
@@ -18,9 +27,14 @@ ma_err_t TransportWebSocket::init(const void* config) noexcept {
     const Config* config_ = reinterpret_cast<const Config*>(config);
 
     m_server.port = config_->port;
+    if (!config_->encoding.empty()) {
+        m_encoding = config_->encoding;
+    }
 
     m_service.onopen = [this](const WebSocketChannelPtr& channel, const HttpRequestPtr& req) {
-        m_channels.emplace_front(channel);
+        Guard guard(m_mutex);
+        m_channels.emplace_front(Client{channel, req->GetParam("encoding", m_encoding), {}, 0, 0, 0});
+        m_generation.fetch_add(1);
     };
 
     m_service.onmessage = [this](const WebSocketChannelPtr& channel, const std::string& msg) {
@@ -28,13 +42,21 @@ ma_err_t TransportWebSocket::init(const void* config) noexcept {
     };
 
     m_service.onclose = [this](const WebSocketChannelPtr& channel) {
-        m_channels.remove_if([](const WebSocketChannelPtr& c) { return !c->isConnected(); });
+        Guard guard(m_mutex);
+        m_channels.remove_if([](const Client& c) { return !c.channel->isConnected(); });
     };
 
     m_server.registerWebSocketService(&m_service);
 
     m_receiveBuffer = new SPSCRingBuffer<char>(64 * 1024);
 
+    m_thread = new Thread("ws-sender", senderEntryStub);
+    if (m_thread == nullptr) {
+        return MA_ENOMEM;
+    }
+    m_sending.store(true);
+    m_thread->start(this);
+
     if (m_server.start() == MA_OK) {
         return MA_OK;
     }
@@ -45,6 +67,19 @@ void TransportWebSocket::deInit() noexcept {
 
     m_server.stop();
 
+    if (m_sending.exchange(false)) {
+        m_signal.signal();
+        m_thread->join();
+    }
+    if (m_thread) {
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    {
+        Guard guard(m_mutex);
+        m_channels.clear();
+    }
+
     if (m_receiveBuffer) {
         delete m_receiveBuffer;
         m_receiveBuffer = nullptr;
@@ -63,16 +98,108 @@ size_t TransportWebSocket::flush() noexcept {
 }
 
 size_t TransportWebSocket::send(const char* data, size_t length) noexcept {
+    return enqueue(data, length, nullptr, true);
+}
+
+bool TransportWebSocket::wants(const std::string& encoding) const noexcept {
     Guard guard(m_mutex);
-    if (m_channels.empty()) {
-        return 0;
+    for (const auto& client : m_channels) {
+        if (client.encoding == encoding) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t TransportWebSocket::send(const char* data, size_t length, const std::string& encoding, bool droppable) noexcept {
+    return enqueue(data, length, &encoding, droppable);
+}
+
+size_t TransportWebSocket::enqueue(const char* data, size_t length, const std::string* encoding, bool droppable) noexcept {
+    Guard guard(m_mutex);
+    std::shared_ptr<const std::string> payload;
+    for (auto& client : m_channels) {
+        if (encoding != nullptr && client.encoding != *encoding) {
+            continue;
+        }
+        if (!payload) {
+            // one copy shared by the clients, the producer buffer is reused as soon as we return
+            payload = std::make_shared<const std::string>(data, length);
+        }
+        if (droppable) {
+            size_t before = client.queue.size();
+            client.queue.erase(std::remove_if(client.queue.begin(), client.queue.end(), [](const Message& m) { return m.droppable; }), client.queue.end());
+            client.dropped += before - client.queue.size();
+        }
+        if (client.queue.size() >= WS_CLIENT_QUEUE) {
+            client.queue.pop_front();
+            client.dropped++;
+        }
+        client.queue.push_back(Message{payload, droppable});
     }
-    for (auto& channel : m_channels) {
-        int n_send = channel->send(data, length);
+    if (!payload) {
+        return 0;
     }
+    m_signal.signal();
     return length;
 }
 
+uint32_t TransportWebSocket::generation() const noexcept {
+    return m_generation.load();
+}
+
+json TransportWebSocket::stats() const noexcept {
+    Guard guard(m_mutex);
+    json clients = json::array();
+    for (const auto& client : m_channels) {
+        clients.push_back({{"peer", client.channel->peeraddr()},
+                           {"encoding", client.encoding},
+                           {"sent", client.sent},
+                           {"dropped", client.dropped},
+                           {"bytes", client.bytes},
+                           {"queued", client.queue.size()},
+                           {"backlog", client.channel->writeBufsize()}});
+    }
+    return clients;
+}
+
+void TransportWebSocket::senderEntry() {
+    std::vector<std::pair<WebSocketChannelPtr, std::shared_ptr<const std::string>>> batch;
+    while (true) {
+        bool sending = m_sending.load();
+        // a slow client is retried on the next round, its pending frame meanwhile replaced by newer ones
+        m_signal.wait(Tick::fromMilliseconds(10));
+        {
+            Guard guard(m_mutex);
+            for (auto& client : m_channels) {
+                if (client.queue.empty() || client.channel->writeBufsize() >= WS_CLIENT_BACKLOG) {
+                    continue;
+                }
+                for (auto& message : client.queue) {
+                    client.sent++;
+                    client.bytes += message.payload->size();
+                    batch.emplace_back(client.channel, std::move(message.payload));
+                }
+                client.queue.clear();
+            }
+        }
+        // the writes happen outside the lock, the producers never wait for a socket
+        for (auto& it : batch) {
+            if (it.first->isConnected()) {
+                it.first->send(it.second->data(), it.second->size());
+            }
+        }
+        batch.clear();
+        if (!sending) {
+            break;
+        }
+    }
+}
+
+void TransportWebSocket::senderEntryStub(void* obj) {
+    reinterpret_cast<TransportWebSocket*>(obj)->senderEntry();
+}
+
 size_t TransportWebSocket::receive(char* data, size_t length) noexcept {
     Guard guard(m_mutex);
     if (m_receiveBuffer->empty()) {
@@ -1,7 +1,10 @@
 #ifndef _MA_TRANSPORT_WEBSOCKET_H
 #define _MA_TRANSPORT_WEBSOCKET_H
 
+#include <atomic>
+#include <deque>
 #include <forward_list>
+#include <memory>
 
 #include "core/ma_common.h"
 #include "core/utils/ma_ringbuffer.hpp"
@@ -20,6 +23,7 @@ public:
     struct Config {
         int port;
         std::string session;
+        std::string encoding;  // served to the clients that do not pick one, "json" when empty
     };
 
 
@@ -35,14 +39,49 @@ public:
     size_t receiveIf(char* data, size_t length, char delimiter) noexcept override;
     size_t flush() noexcept override;
 
+    // clients pick a variant of the stream with the `encoding` query parameter of the URL,
+    // e.g. ws://host:8090/?encoding=binary, a producer only sends each variant to its clients
+    // the messages are queued per client and written by a sender thread, a droppable message
+    // replaces the one still pending for a client (latest frame wins), the others are kept
+    bool wants(const std::string& encoding) const noexcept;
+    size_t send(const char* data, size_t length, const std::string& encoding, bool droppable = true) noexcept;
+    // bumped each time a client connects, lets a producer resend the state a new client misses
+    uint32_t generation() const noexcept;
+
+    // backpressure of each client: messages sent and dropped, bytes still buffered by the socket
+    json stats() const noexcept;
+
 private:
+    struct Message {
+        std::shared_ptr<const std::string> payload;
+        bool droppable;
+    };
+
+    struct Client {
+        WebSocketChannelPtr channel;
+        std::string encoding;
+        std::deque<Message> queue;
+        uint64_t sent;
+        uint64_t dropped;
+        uint64_t bytes;
+    };
+
+    size_t enqueue(const char* data, size_t length, const std::string* encoding, bool droppable) noexcept;
+
+    void senderEntry();
+    static void senderEntryStub(void* obj);
+
     int m_port;
+    std::string m_encoding;
+    std::atomic<uint32_t> m_generation;
     Mutex m_mutex;
     hv::WebSocketService m_service;
     hv::WebSocketServer m_server;
-    std::forward_list<WebSocketChannelPtr> m_channels;
+    std::forward_list<Client> m_channels;
     SPSCRingBuffer<char>* m_receiveBuffer;
+    Semaphore m_signal;
     Thread* m_thread;
+    std::atomic<bool> m_sending;
 };
 
 }  // namespace ma
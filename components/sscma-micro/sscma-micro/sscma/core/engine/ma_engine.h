@@ -2,6 +2,8 @@
 #define _MA_ENGINE_H_
 
 #include "ma_engine_base.h"
+#include "ma_engine_scheduler.h"
+#include "ma_mapped_model.h"
 
 #ifdef MA_USE_ENGINE_TFLITE
 #include "ma_engine_tflite.h"
@@ -20,13 +20,31 @@ static const ma_tensor_type_t mapped_tensor_types[] = {
     MA_TENSOR_TYPE_U8,
 };
 
+#if MA_USE_FILESYSTEM_POSIX
+Mutex EngineCVI::s_mutex;
+std::list<EngineCVI*> EngineCVI::s_engines;
+#endif
+
 EngineCVI::EngineCVI() {
     model = nullptr;
 }
 
 EngineCVI::~EngineCVI() {
+    release();
+}
+
+void EngineCVI::release() {
+#if MA_USE_FILESYSTEM_POSIX
+    {
+        Guard guard(s_mutex);
+        s_engines.remove(this);
+    }
+    model_path.clear();
+    mapped.reset();
+#endif
     if (model != nullptr) {
         CVI_NN_CleanupModel(model);
+        model = nullptr;
     }
 }
 
@@ -45,6 +63,60 @@ ma_err_t EngineCVI::init(void* pool, size_t size) {
 }
 
 ma_err_t EngineCVI::load(const char* model_path) {
+#if MA_USE_FILESYSTEM_POSIX
+    CVI_RC _ret      = CVI_RC_SUCCESS;
+    int64_t start    = ma_get_time_ms();
+    std::string path = model_path;
+
+    release();
+
+    {
+        // the weights of a model already loaded by another engine are shared, not loaded again
+        Guard guard(s_mutex);
+        for (auto engine : s_engines) {
+            if (engine->model_path == path && engine->model != nullptr) {
+                _ret = CVI_NN_CloneModel(engine->model, &model);
+                if (_ret == CVI_RC_SUCCESS) {
+                    mapped = engine->mapped;
+                    MA_LOGI(TAG, "clone %s", model_path);
+                } else {
+                    model = nullptr;
+                }
+                break;
+            }
+        }
+    }
+
+    if (model == nullptr) {
+        mapped = MappedModel::open(path);
+        if (mapped == nullptr) {
+            return MA_ENOENT;
+        }
+        _ret = CVI_NN_RegisterModelFromBuffer(static_cast<const int8_t*>(mapped->data()), mapped->size(), &model);
+        if (_ret != CVI_RC_SUCCESS) {
+            model = nullptr;
+            mapped.reset();
+            return MA_EINVAL;
+        }
+    }
+
+    _ret = CVI_NN_GetInputOutputTensors(model, &input_tensors, &input_num, &output_tensors, &output_num);
+
+    if (_ret != CVI_RC_SUCCESS) {
+        release();
+        return MA_EINVAL;
+    }
+
+    this->model_path = path;
+    {
+        Guard guard(s_mutex);
+        s_engines.push_back(this);
+    }
+
+    MA_LOGI(TAG, "load %s: %d ms, rss %zu kB, peak %zu kB", model_path, static_cast<int>(ma_get_time_ms() - start), MappedModel::currentRss(), MappedModel::peakRss());
+
+    return MA_OK;
+#else
     ma_err_t ret = MA_OK;
     CVI_RC _ret  = CVI_RC_SUCCESS;
 
@@ -53,7 +125,7 @@ ma_err_t EngineCVI::load(const char* model_path) {
         model = nullptr;
     }
 
-    _ret == CVI_NN_RegisterModel(model_path, &model);
+    _ret = CVI_NN_RegisterModel(model_path, &model);
 
     if (_ret != CVI_RC_SUCCESS) {
         return MA_EINVAL;
@@ -66,6 +138,7 @@ ma_err_t EngineCVI::load(const char* model_path) {
         return MA_EINVAL;
     }
     return MA_OK;
+#endif
 }
 
 
@@ -77,14 +150,12 @@ ma_err_t EngineCVI::load(const void* model_data, size_t model_size) {
     ma_err_t ret = MA_OK;
     CVI_RC _ret  = CVI_RC_SUCCESS;
 
-    if (model != nullptr) {
-        CVI_NN_CleanupModel(model);
-        model = nullptr;
-    }
+    release();
 
-    _ret == CVI_NN_RegisterModelFromBuffer(static_cast<const int8_t*>(model_data), model_size, &model);
+    _ret = CVI_NN_RegisterModelFromBuffer(static_cast<const int8_t*>(model_data), model_size, &model);
 
     if (_ret != CVI_RC_SUCCESS) {
+        model = nullptr;
         return MA_EINVAL;
     }
 
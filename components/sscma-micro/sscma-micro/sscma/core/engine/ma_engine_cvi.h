@@ -3,7 +3,9 @@
 
 #include <cstddef>
 #include <cstdint>
-
+#include <list>
+#include <memory>
+#include <string>
 
 #include "../ma_common.h"
 
@@ -12,7 +14,7 @@
 #include <cviruntime.h>
 
 #include "ma_engine_base.h"
-
+#include "ma_mapped_model.h"
 
 namespace ma::engine {
 
@@ -48,11 +50,21 @@ public:
     int32_t getOutputNum(const char* name) override;
 
 private:
+    void release();
+
     CVI_MODEL_HANDLE model;
     CVI_TENSOR* input_tensors;
     CVI_TENSOR* output_tensors;
     int32_t input_num;
     int32_t output_num;
+#if MA_USE_FILESYSTEM_POSIX
+    std::string model_path;
+    std::shared_ptr<MappedModel> mapped;
+
+    // engines loaded from a file, a new engine loading the same file clones their weights
+    static Mutex s_mutex;
+    static std::list<EngineCVI*> s_engines;
+#endif
 };
 
 }  // namespace ma
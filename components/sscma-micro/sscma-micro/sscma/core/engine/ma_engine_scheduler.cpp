@@ -0,0 +1,237 @@
+#include "ma_engine_scheduler.h"
+
+namespace ma::engine {
+
+constexpr char TAG[] = "ma::engine::scheduler";
+
+#define MA_ENGINE_SCHEDULER_AGING_DEFAULT 200
+
+EngineScheduler::EngineScheduler() : mutex_(), running_(nullptr), last_(nullptr), aging_(MA_ENGINE_SCHEDULER_AGING_DEFAULT) {}
+
+EngineScheduler::~EngineScheduler() {}
+
+EngineScheduler* EngineScheduler::getInstance() noexcept {
+    static EngineScheduler scheduler;
+    return &scheduler;
+}
+
+EngineScheduler::Client* EngineScheduler::find(Engine* engine) {
+    for (auto& client : clients_) {
+        if (client.engine == engine) {
+            return &client;
+        }
+    }
+    return nullptr;
+}
+
+ma_err_t EngineScheduler::attach(Engine* engine, const std::string& name, int priority, uint32_t deadline) {
+    if (engine == nullptr) {
+        return MA_EINVAL;
+    }
+
+    Guard guard(mutex_);
+
+    if (find(engine) != nullptr) {
+        return MA_EEXIST;
+    }
+
+    clients_.push_back({engine, name, priority, deadline, Tick::current(), 0, 0, 0, 0, 0, 0});
+
+    MA_LOGI(TAG, "attach %s: priority %d, deadline %u ms", name.c_str(), priority, deadline);
+
+    return MA_OK;
+}
+
+bool EngineScheduler::busy(Engine* engine) const {
+    if (running_ == engine) {
+        return true;
+    }
+    for (const auto& request : requests_) {
+        if (request.client->engine == engine) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ma_err_t EngineScheduler::detach(Engine* engine, ma_tick_t timeout) {
+    ma_tick_t start = Tick::current();
+
+    while (true) {
+        {
+            Guard guard(mutex_);
+
+            if (!busy(engine)) {
+                for (auto it = clients_.begin(); it != clients_.end(); ++it) {
+                    if (it->engine == engine) {
+                        MA_LOGI(TAG, "detach %s", it->name.c_str());
+                        clients_.erase(it);
+                        break;
+                    }
+                }
+                if (last_ == engine) {
+                    last_ = nullptr;
+                }
+                return MA_OK;
+            }
+        }
+        if (timeout != Tick::waitForever && Tick::current() - start >= timeout) {
+            return MA_EBUSY;
+        }
+        // teardown path only, a short poll is enough
+        Thread::sleep(Tick::fromMilliseconds(1));
+    }
+}
+
+bool EngineScheduler::attached(Engine* engine) {
+    Guard guard(mutex_);
+    return find(engine) != nullptr;
+}
+
+ma_err_t EngineScheduler::setPriority(Engine* engine, int priority, uint32_t deadline) {
+    Guard guard(mutex_);
+
+    Client* client = find(engine);
+    if (client == nullptr) {
+        return MA_ENOENT;
+    }
+    client->priority = priority;
+    client->deadline = deadline;
+
+    return MA_OK;
+}
+
+void EngineScheduler::setAging(uint32_t ms) {
+    Guard guard(mutex_);
+    aging_ = ms;
+}
+
+int EngineScheduler::rank(const Request& request, ma_tick_t now) const {
+    int priority = request.client->priority;
+    if (aging_ != 0) {
+        priority += Tick::toMilliseconds(now - request.queued) / aging_;
+    }
+    return priority;
+}
+
+std::list<EngineScheduler::Request>::iterator EngineScheduler::elect(ma_tick_t now) {
+    auto best      = requests_.begin();
+    int best_rank  = rank(*best, now);
+
+    for (auto it = std::next(best); it != requests_.end(); ++it) {
+        int it_rank = rank(*it, now);
+        if (it_rank != best_rank) {
+            if (it_rank > best_rank) {
+                best      = it;
+                best_rank = it_rank;
+            }
+            continue;
+        }
+        // same rank: earliest deadline, then the model that just ran, then arrival order
+        if (it->deadline != best->deadline) {
+            if (it->deadline != 0 && (best->deadline == 0 || it->deadline < best->deadline)) {
+                best = it;
+            }
+            continue;
+        }
+        if (it->client->engine == last_ && best->client->engine != last_) {
+            best = it;
+        }
+    }
+
+    return best;
+}
+
+void EngineScheduler::dispatch() {
+    if (running_ != nullptr || requests_.empty()) {
+        return;
+    }
+
+    ma_tick_t now   = Tick::current();
+    auto it         = elect(now);
+    Request request = *it;
+    requests_.erase(it);
+
+    Client* client  = request.client;
+    uint32_t queued = Tick::toMilliseconds(now - request.queued);
+
+    client->requests++;
+    client->queue_last = queued;
+    client->queue_total += queued;
+    if (queued > client->queue_max) {
+        client->queue_max = queued;
+    }
+    if (request.deadline != 0 && now > request.deadline) {
+        client->misses++;
+        MA_LOGV(TAG, "%s: deadline missed by %u ms", client->name.c_str(), Tick::toMilliseconds(now - request.deadline));
+    }
+
+    running_ = client->engine;
+    request.granted->signal();
+}
+
+ma_err_t EngineScheduler::run(Engine* engine) {
+    if (engine == nullptr) {
+        return MA_EINVAL;
+    }
+
+    Semaphore granted(0);
+
+    mutex_.lock();
+
+    Client* client = find(engine);
+    if (client == nullptr) {
+        // not managed by the scheduler
+        mutex_.unlock();
+        return engine->run();
+    }
+
+    ma_tick_t now = Tick::current();
+    requests_.push_back({client, now, client->deadline != 0 ? now + Tick::fromMilliseconds(client->deadline) : 0, &granted});
+    dispatch();
+
+    mutex_.unlock();
+
+    granted.wait();
+
+    ma_tick_t start = Tick::current();
+    ma_err_t err    = engine->run();
+    ma_tick_t end   = Tick::current();
+
+    mutex_.lock();
+
+    client->busy += Tick::toMilliseconds(end - start);
+    running_ = nullptr;
+    last_    = engine;
+    dispatch();
+
+    mutex_.unlock();
+
+    return err;
+}
+
+std::vector<EngineScheduler::Stats> EngineScheduler::getStats() {
+    Guard guard(mutex_);
+
+    std::vector<Stats> stats;
+    stats.reserve(std::distance(clients_.begin(), clients_.end()));
+
+    ma_tick_t now = Tick::current();
+    for (auto& client : clients_) {
+        uint32_t elapsed = Tick::toMilliseconds(now - client.attached);
+        stats.push_back({client.name,
+                         client.priority,
+                         client.deadline,
+                         client.requests,
+                         client.misses,
+                         client.queue_last,
+                         client.queue_max,
+                         client.requests != 0 ? static_cast<uint32_t>(client.queue_total / client.requests) : 0,
+                         static_cast<uint32_t>(client.busy),
+                         elapsed != 0 ? static_cast<float>(client.busy) / elapsed : 0.0f});
+    }
+
+    return stats;
+}
+
+}  // namespace ma::engine
@@ -0,0 +1,101 @@
+#ifndef _MA_ENGINE_SCHEDULER_H_
+#define _MA_ENGINE_SCHEDULER_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "../ma_common.h"
+#include "porting/ma_osal.h"
+
+#include "ma_engine_base.h"
+
+namespace ma::engine {
+
+/**
+ * Arbitrates the forward passes of every engine sharing the accelerator.
+ *
+ * Engines are attached with a priority and an optional deadline (relative to the time the
+ * request is queued). Engine::run() calls routed through EngineScheduler::run() are granted
+ * one at a time: highest priority first, then earliest deadline, then arrival order. A
+ * request gains one priority level per aging period spent in the queue so that a busy
+ * high priority model cannot starve the others. Among equally ranked requests, the engine
+ * that just ran is preferred, which keeps back to back requests of the same model together.
+ *
+ * The forward pass itself runs on the caller's thread.
+ */
+class EngineScheduler {
+public:
+    struct Stats {
+        std::string name;
+        int priority;
+        uint32_t deadline;     // ms, 0 for none
+        uint32_t requests;
+        uint32_t misses;       // requests started after their deadline
+        uint32_t queue_last;   // ms
+        uint32_t queue_max;    // ms
+        uint32_t queue_avg;    // ms
+        uint32_t busy;         // ms spent in Engine::run()
+        float utilisation;     // share of the accelerator time since attach
+    };
+
+    static EngineScheduler* getInstance() noexcept;
+
+    ma_err_t attach(Engine* engine, const std::string& name, int priority = 0, uint32_t deadline = 0);
+    // blocks until the engine has no request queued or running, so that it can be deleted right
+    // after, returns MA_EBUSY if it is still in use when the timeout expires
+    ma_err_t detach(Engine* engine, ma_tick_t timeout = Tick::waitForever);
+    bool attached(Engine* engine);
+
+    ma_err_t setPriority(Engine* engine, int priority, uint32_t deadline = 0);
+    void setAging(uint32_t ms);
+
+    // blocking, returns the result of Engine::run()
+    ma_err_t run(Engine* engine);
+
+    std::vector<Stats> getStats();
+
+protected:
+    EngineScheduler();
+    ~EngineScheduler();
+
+private:
+    struct Client {
+        Engine* engine;
+        std::string name;
+        int priority;
+        uint32_t deadline;
+        ma_tick_t attached;
+        uint32_t requests;
+        uint32_t misses;
+        uint64_t queue_total;
+        uint32_t queue_last;
+        uint32_t queue_max;
+        uint64_t busy;
+    };
+
+    struct Request {
+        Client* client;
+        ma_tick_t queued;
+        ma_tick_t deadline;
+        Semaphore* granted;
+    };
+
+    Client* find(Engine* engine);
+    bool busy(Engine* engine) const;
+    int rank(const Request& request, ma_tick_t now) const;
+    std::list<Request>::iterator elect(ma_tick_t now);
+    void dispatch();
+
+    Mutex mutex_;
+    std::list<Client> clients_;
+    std::list<Request> requests_;
+    Engine* running_;
+    Engine* last_;
+    uint32_t aging_;
+};
+
+}  // namespace ma::engine
+
+#endif  // _MA_ENGINE_SCHEDULER_H_
@@ -2,6 +2,8 @@
 
 #if MA_USE_ENGINE_TFLITE
 
+#include <cstdio>
+
 namespace tflite {
 
 OpsResolver::OpsResolver() {
@@ -302,6 +304,8 @@ OpsResolver::OpsResolver() {
 
 namespace ma::engine {
 
+constexpr char TAG[] = "ma::engine::tflite";
+
 static const ma_tensor_type_t mapped_tensor_types[] = {
     MA_TENSOR_TYPE_NONE, MA_TENSOR_TYPE_F32, MA_TENSOR_TYPE_S32,  MA_TENSOR_TYPE_U8,
     MA_TENSOR_TYPE_S64,  MA_TENSOR_TYPE_STR, MA_TENSOR_TYPE_BOOL, MA_TENSOR_TYPE_S16,
@@ -311,11 +315,68 @@ static const ma_tensor_type_t mapped_tensor_types[] = {
 };
 
 
+TensorArena::TensorArena(size_t size) : pool(new uint8_t[size]), pool_size(size), own(true), micro_allocator(nullptr) {}
+
+TensorArena::TensorArena(void* pool, size_t size) : pool(static_cast<uint8_t*>(pool)), pool_size(size), own(false), micro_allocator(nullptr) {}
+
+TensorArena::~TensorArena() {
+    // the allocator lives in the arena itself
+    micro_allocator = nullptr;
+    if (own && pool != nullptr) {
+        delete[] pool;
+    }
+    pool = nullptr;
+}
+
+tflite::MicroAllocator* TensorArena::allocator() {
+    if (micro_allocator == nullptr && pool != nullptr) {
+        micro_allocator = tflite::MicroAllocator::Create(pool, pool_size);
+    }
+    return micro_allocator;
+}
+
+size_t TensorArena::size() const {
+    return pool_size;
+}
+
+size_t TensorArena::used() const {
+    return micro_allocator != nullptr ? micro_allocator->used_bytes() : 0;
+}
+
+#if MA_USE_FILESYSTEM
+size_t TensorArena::plan(const std::string& model_path) {
+    std::ifstream file(model_path + ".arena");
+    size_t used = 0;
+    if (!file.is_open() || !(file >> used)) {
+        return 0;
+    }
+    return used;
+}
+
+ma_err_t TensorArena::record(const std::string& model_path, size_t used) {
+    std::string path = model_path + ".arena";
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        if (!file.is_open() || !(file << used << std::endl)) {
+            return MA_EIO;
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return MA_EIO;
+    }
+    return MA_OK;
+}
+#endif
+
 EngineTFLite::EngineTFLite() {
     interpreter      = nullptr;
     model            = nullptr;
+    arena            = nullptr;
     memory_pool.pool = nullptr;
     memory_pool.size = 0;
+    memory_pool.own  = false;
 #if MA_USE_FILESYSTEM
     model_file = nullptr;
 #endif
@@ -341,7 +402,17 @@ EngineTFLite::~EngineTFLite() {
 }
 
 ma_err_t EngineTFLite::init() {
+#ifdef MA_USE_STATIC_TENSOR_ARENA
     return init(MA_ENGINE_TFLITE_TENSOE_ARENA_SIZE);
+#else
+    if (memory_pool.pool != nullptr || arena != nullptr) {
+        return MA_EPERM;
+    }
+    // allocated on load, sized from the recorded peak of the model when there is one
+    memory_pool.size = MA_ENGINE_TFLITE_TENSOE_ARENA_SIZE;
+    memory_pool.own  = true;
+    return MA_OK;
+#endif
 }
 
 #ifdef MA_USE_STATIC_TENSOR_ARENA
@@ -378,6 +449,32 @@ ma_err_t EngineTFLite::init(void* pool, size_t size) {
     return MA_OK;
 }
 
+ma_err_t EngineTFLite::init(TensorArena* arena) {
+    if (arena == nullptr) {
+        return MA_EINVAL;
+    }
+    if (memory_pool.pool != nullptr || this->arena != nullptr) {
+        return MA_EPERM;
+    }
+    this->arena = arena;
+    return MA_OK;
+}
+
+ma_err_t EngineTFLite::allocate() {
+    if (arena != nullptr || memory_pool.pool != nullptr) {
+        return MA_OK;
+    }
+    if (memory_pool.size == 0) {
+        return MA_EPERM;
+    }
+    memory_pool.pool = new uint8_t[memory_pool.size];
+    if (memory_pool.pool == nullptr) {
+        return MA_ENOMEM;
+    }
+    memory_pool.own = true;
+    return MA_OK;
+}
+
 ma_err_t EngineTFLite::run() {
     MA_ASSERT(interpreter != nullptr);
 
@@ -402,8 +499,16 @@ ma_err_t EngineTFLite::load(const void* model_data, size_t model_size) {
 
     static tflite::OpsResolver resolver;
 
-    interpreter = new tflite::MicroInterpreter(
-        model, resolver, static_cast<uint8_t*>(memory_pool.pool), memory_pool.size);
+    if (arena != nullptr) {
+        interpreter = new tflite::MicroInterpreter(model, resolver, arena->allocator());
+    } else {
+        ma_err_t ret = allocate();
+        if (ret != MA_OK) {
+            return ret;
+        }
+        interpreter = new tflite::MicroInterpreter(
+            model, resolver, static_cast<uint8_t*>(memory_pool.pool), memory_pool.size);
+    }
     if (interpreter == nullptr) {
         return MA_ENOMEM;
     }
@@ -562,22 +667,45 @@ ma_err_t EngineTFLite::load(const char* model_path) {
         delete model_file;
         model_file = nullptr;
     }
-    std::ifstream file(model_path, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
+    // the flatbuffer is used in place, the mapping is shared with the engines loading the same file
+    std::shared_ptr<MappedModel> file = MappedModel::open(model_path);
+    if (file == nullptr) {
         return MA_ELOG;
     }
-    size       = file.tellg();
-    model_file = new char[size];
-    if (model_file == nullptr) {
-        return MA_ENOMEM;
+    size = file->size();
+
+    // size a private arena from the recorded peak instead of the default guess
+    size_t planned      = TensorArena::plan(model_path);
+    size_t default_size = memory_pool.size;
+    bool resized        = false;
+    if (arena == nullptr && memory_pool.pool == nullptr && memory_pool.own && planned != 0) {
+        memory_pool.size = (planned + planned / 16 + 15) & ~static_cast<size_t>(15);
+        resized          = true;
+    }
+
+    ret = load(file->data(), size);
+    if (ret != MA_OK && resized) {
+        // the model changed since its peak was recorded
+        MA_LOGW(TAG, "planned arena of %zu bytes too small, retry with %zu", memory_pool.size, default_size);
+        delete[] static_cast<uint8_t*>(memory_pool.pool);
+        memory_pool.pool = nullptr;
+        memory_pool.size = default_size;
+        ret              = load(file->data(), size);
     }
-    file.seekg(0, std::ios::beg);
-    file.read(model_file, size);
-    file.close();
-    ret = load(model_file, size);
     if (ret != MA_OK) {
-        delete model_file;
-        model_file = nullptr;
+        return ret;
+    }
+
+    mapped = file;
+
+    if (arena != nullptr) {
+        MA_LOGI(TAG, "shared arena: %zu of %zu bytes used, %zu bytes headroom", arena->used(), arena->size(), arena->size() - arena->used());
+    } else {
+        size_t used = interpreter->arena_used_bytes();
+        MA_LOGI(TAG, "arena: %zu of %zu bytes used, %zu bytes headroom", used, memory_pool.size, memory_pool.size - used);
+        if (used != planned && TensorArena::record(model_path, used) != MA_OK) {
+            MA_LOGW(TAG, "failed to record the arena usage of %s", model_path);
+        }
     }
 
     return ret;
@@ -10,6 +10,7 @@
 
 #include <tensorflow/lite/c/common.h>
 #include <tensorflow/lite/micro/compatibility.h>
+#include <tensorflow/lite/micro/micro_allocator.h>
 #include <tensorflow/lite/micro/micro_interpreter.h>
 #include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
 #include <tensorflow/lite/micro/system_setup.h>
@@ -20,6 +21,10 @@
 #if MA_USE_FILESYSTEM_POSIX
 #include <dirent.h>
 #include <sys/stat.h>
+
+#include <memory>
+
+#include "ma_mapped_model.h"
 #endif
 
 namespace tflite {
@@ -332,6 +337,39 @@ private:
 
 namespace ma::engine {
 
+/**
+ * Tensor arena shared by several TFLite engines.
+ *
+ * All the interpreters are built on one MicroAllocator: the persistent data of each model
+ * is stacked at the tail of the arena while the scratch (head) section is shared, so the
+ * arena only needs the sum of the persistent sections plus the largest head instead of the
+ * sum of the arenas. The engines sharing it must never run, nor write their inputs, at the
+ * same time, and must be loaded after the arena was created and before it is destroyed.
+ */
+class TensorArena {
+public:
+    explicit TensorArena(size_t size);
+    TensorArena(void* pool, size_t size);
+    ~TensorArena();
+
+    tflite::MicroAllocator* allocator();
+
+    size_t size() const;
+    size_t used() const;
+
+#if MA_USE_FILESYSTEM
+    // peak arena usage recorded next to the model, 0 when unknown
+    static size_t plan(const std::string& model_path);
+    static ma_err_t record(const std::string& model_path, size_t used);
+#endif
+
+private:
+    uint8_t* pool;
+    size_t pool_size;
+    bool own;
+    tflite::MicroAllocator* micro_allocator;
+};
+
 class EngineTFLite final : public Engine {
 public:
     EngineTFLite();
@@ -340,6 +378,7 @@ public:
     ma_err_t init() override;
     ma_err_t init(size_t size) override;
     ma_err_t init(void* pool, size_t size) override;
+    ma_err_t init(TensorArena* arena);
 
     ma_err_t run() override;
 
@@ -361,13 +400,19 @@ public:
     ma_err_t setInput(int32_t index, const ma_tensor_t& tensor) override;
 
 private:
+    ma_err_t allocate();
+
     tflite::MicroInterpreter* interpreter;
      const tflite::Model* model;
     ma_memory_pool_t memory_pool;
+    TensorArena* arena;
 
 #if MA_USE_FILESYSTEM
     char* model_file;
 #endif
+#if MA_USE_FILESYSTEM_POSIX
+    std::shared_ptr<MappedModel> mapped;
+#endif
 };
 
 }  // namespace ma::engine
@@ -0,0 +1,124 @@
+#include "ma_mapped_model.h"
+
+#if MA_USE_FILESYSTEM_POSIX
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace ma::engine {
+
+constexpr char TAG[] = "ma::engine::mapped";
+
+Mutex MappedModel::s_mutex;
+std::map<std::string, std::weak_ptr<MappedModel>> MappedModel::s_models;
+
+MappedModel::MappedModel(const std::string& path, void* data, size_t size, uint64_t inode, int64_t mtime, int64_t mtime_nsec)
+    : path_(path), data_(data), size_(size), inode_(inode), mtime_(mtime), mtime_nsec_(mtime_nsec) {}
+
+MappedModel::~MappedModel() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+    }
+}
+
+std::shared_ptr<MappedModel> MappedModel::open(const std::string& path, bool readahead) {
+    Guard guard(s_mutex);
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || st.st_size <= 0) {
+        return nullptr;
+    }
+
+    auto it = s_models.find(path);
+    if (it != s_models.end()) {
+        auto model = it->second.lock();
+        if (model != nullptr && model->inode_ == static_cast<uint64_t>(st.st_ino) && model->mtime_ == static_cast<int64_t>(st.st_mtim.tv_sec) &&
+            model->mtime_nsec_ == static_cast<int64_t>(st.st_mtim.tv_nsec) && model->size_ == static_cast<size_t>(st.st_size)) {
+            MA_LOGD(TAG, "reuse %s", path.c_str());
+            return model;
+        }
+        s_models.erase(it);
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        MA_LOGE(TAG, "open %s failed: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+
+    if (readahead) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        MA_LOGE(TAG, "mmap %s failed: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    if (readahead) {
+        madvise(data, size, MADV_WILLNEED);
+    }
+
+    std::shared_ptr<MappedModel> model(new MappedModel(path, data, size, st.st_ino, st.st_mtim.tv_sec, st.st_mtim.tv_nsec));
+    s_models[path] = model;
+
+    MA_LOGD(TAG, "map %s: %zu bytes", path.c_str(), size);
+
+    return model;
+}
+
+const void* MappedModel::data() const {
+    return data_;
+}
+
+size_t MappedModel::size() const {
+    return size_;
+}
+
+const std::string& MappedModel::path() const {
+    return path_;
+}
+
+static size_t readStatus(const char* key) {
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp == nullptr) {
+        return 0;
+    }
+
+    char line[128];
+    size_t value = 0;
+    size_t len   = strlen(key);
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        if (strncmp(line, key, len) == 0) {
+            value = strtoul(line + len, nullptr, 10);
+            break;
+        }
+    }
+    fclose(fp);
+
+    return value;
+}
+
+size_t MappedModel::peakRss() {
+    return readStatus("VmHWM:");
+}
+
+size_t MappedModel::currentRss() {
+    return readStatus("VmRSS:");
+}
+
+}  // namespace ma::engine
+
+#endif
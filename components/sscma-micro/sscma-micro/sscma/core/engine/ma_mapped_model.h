@@ -0,0 +1,58 @@
+#ifndef _MA_MAPPED_MODEL_H_
+#define _MA_MAPPED_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "../ma_common.h"
+
+#if MA_USE_FILESYSTEM_POSIX
+
+#include "porting/ma_osal.h"
+
+namespace ma::engine {
+
+/**
+ * Read-only memory mapping of a model file.
+ *
+ * The pages are backed by the page cache instead of an anonymous heap copy, so they can
+ * be dropped under memory pressure and are shared by every engine loading the same file:
+ * open() returns the live mapping of a path as long as the file did not change on disk.
+ */
+class MappedModel {
+public:
+    ~MappedModel();
+
+    static std::shared_ptr<MappedModel> open(const std::string& path, bool readahead = true);
+
+    const void* data() const;
+    size_t size() const;
+    const std::string& path() const;
+
+    // VmHWM of the process, in kB, 0 when unavailable
+    static size_t peakRss();
+    // VmRSS of the process, in kB, 0 when unavailable
+    static size_t currentRss();
+
+private:
+    MappedModel(const std::string& path, void* data, size_t size, uint64_t inode, int64_t mtime, int64_t mtime_nsec);
+
+    std::string path_;
+    void* data_;
+    size_t size_;
+    uint64_t inode_;
+    int64_t mtime_;
+    int64_t mtime_nsec_;  // a rewrite within the same second keeps mtime_
+
+    static Mutex s_mutex;
+    static std::map<std::string, std::weak_ptr<MappedModel>> s_models;
+};
+
+}  // namespace ma::engine
+
+#endif
+
+#endif  // _MA_MAPPED_MODEL_H_
@@ -8,8 +8,10 @@
 #include "model/ma_model.h"
 
 #include "utils/ma_base64.h"
+#include "utils/ma_mask.h"
 #include "utils/ma_nms.h"
 #include "utils/ma_ringbuffer.hpp"
+#include "utils/ma_span.hpp"
 
 #include "pipeline/ma_executor.hpp"
 
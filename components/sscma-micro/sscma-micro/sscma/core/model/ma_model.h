@@ -3,5 +3,6 @@
 
 #include "../model/ma_model_base.h"
 #include "../model/ma_model_factory.h"
+#include "../model/ma_model_pipeline.h"
 
 #endif  // _MA_MODEL_H_
\ No newline at end of file
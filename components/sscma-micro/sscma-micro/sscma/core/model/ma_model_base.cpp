@@ -1,4 +1,5 @@
 #include "ma_model_base.h"
+#include "ma_model_pipeline.h"
 
 namespace ma {
 
@@ -10,6 +11,7 @@ Model::Model(Engine* engine, const char* name, uint16_t type) {
     p_name_     = name;
     m_type_     = type;
     p_user_ctx_ = nullptr;
+    p_pipeline_ = nullptr;
 
     p_preprocess_done_     = nullptr;
     p_postprocess_done_    = nullptr;
@@ -21,37 +23,41 @@ Model::Model(Engine* engine, const char* name, uint16_t type) {
 
 Model::~Model() {}
 
-ma_err_t Model::underlyingRun() {
+ma_err_t Model::runPreprocess() {
 
     ma_err_t err       = MA_OK;
-    int64_t start_time = 0;
-
-    start_time = ma_get_time_ms();
+    int64_t start_time = ma_get_time_ms();
 
     err = preprocess();
     if (p_preprocess_done_ != nullptr) {
         p_preprocess_done_(p_user_ctx_);
     }
     perf_.preprocess = ma_get_time_ms() - start_time;
-    if (err != MA_OK) {
-        return err;
-    }
 
+    return err;
+}
+
+ma_err_t Model::runInference() {
+
+    ma_err_t err       = MA_OK;
+    int64_t start_time = ma_get_time_ms();
 
-    start_time = ma_get_time_ms();
-    err        = p_engine_->run();
+    // engines not attached to the scheduler run straight away
+    err = engine::EngineScheduler::getInstance()->run(p_engine_);
     if (p_underlying_run_done_ != nullptr) {
         p_underlying_run_done_(p_user_ctx_);
     }
-
     perf_.inference = ma_get_time_ms() - start_time;
 
+    return err;
+}
 
-    if (err != MA_OK) {
-        return err;
-    }
-    start_time = ma_get_time_ms();
-    err        = postprocess();
+ma_err_t Model::runPostprocess() {
+
+    ma_err_t err       = MA_OK;
+    int64_t start_time = ma_get_time_ms();
+
+    err = postprocess();
     if (p_postprocess_done_ != nullptr) {
         p_postprocess_done_(p_user_ctx_);
     }
@@ -60,6 +66,32 @@ ma_err_t Model::underlyingRun() {
     return err;
 }
 
+ma_err_t Model::replayPostprocess() {
+    return postprocess();
+}
+
+ma_err_t Model::underlyingRun() {
+
+    ma_err_t err = MA_OK;
+
+    err = runPreprocess();
+    if (err != MA_OK) {
+        return err;
+    }
+
+    // pipelined mode: inference and postprocess are completed by the pipeline workers
+    if (p_pipeline_ != nullptr) {
+        return p_pipeline_->enqueue(this);
+    }
+
+    err = runInference();
+    if (err != MA_OK) {
+        return err;
+    }
+
+    return runPostprocess();
+}
+
 
 const ma_perf_t Model::getPerf() const {
     return perf_;
@@ -97,4 +129,12 @@ void Model::setUserCtx(void* ctx) {
     p_user_ctx_ = ctx;
 }
 
+void* Model::getUserCtx() const {
+    return p_user_ctx_;
+}
+
+Engine* Model::getEngine() const {
+    return p_engine_;
+}
+
 }  // namespace ma
\ No newline at end of file
@@ -7,10 +7,14 @@
 
 #include "../engine/ma_engine.h"
 #include "../ma_common.h"
+#include "../utils/ma_span.hpp"
 
 namespace ma {
 
 using namespace ma::engine;
+
+class ModelPipeline;
+
 class Model {
 private:
     ma_perf_t perf_;
@@ -19,6 +23,13 @@ private:
     std::function<void(void*)> p_underlying_run_done_;
     void* p_user_ctx_;
     uint16_t m_type_;
+    ModelPipeline* p_pipeline_;
+
+    ma_err_t runPreprocess();
+    ma_err_t runInference();
+    ma_err_t runPostprocess();
+
+    friend class ModelPipeline;
 
 protected:
     Engine* p_engine_;
@@ -42,6 +53,10 @@ public:
     void setPostprocessDone(std::function<void(void*)> func);
     void setRunDone(std::function<void(void*)> func);
     void setUserCtx(void* ctx);
+    void* getUserCtx() const;
+    Engine* getEngine() const;
+    // postprocess the current output tensors again without running the engine, for profiling
+    ma_err_t replayPostprocess();
 };
 }  // namespace ma
 
@@ -108,7 +108,7 @@ ma_err_t Classifier::postprocess() {
                 auto score{static_cast<decltype(scale)>(data[i] - zero_point) * scale};
                 score = rescale ? score : score / 100.f;
                 if (score > threshold_score_)
-                    results_.emplace_front(ma_class_t{score, i});
+                    results_.emplace_back(ma_class_t{score, i});
             }
         } break;
 
@@ -123,7 +123,7 @@ ma_err_t Classifier::postprocess() {
                 auto score{static_cast<decltype(scale)>(data[i] - zero_point) * scale};
                 score = rescale ? score : score / 100.f;
                 if (score > threshold_score_)
-                    results_.emplace_front(ma_class_t{score, i});
+                    results_.emplace_back(ma_class_t{score, i});
             }
         } break;
 
@@ -138,7 +138,7 @@ ma_err_t Classifier::postprocess() {
                 auto score{static_cast<decltype(scale)>(data[i] - zero_point) * scale};
                 score = rescale ? score : score / 100.f;
                 if (score > threshold_score_)
-                    results_.emplace_front(ma_class_t{score, i});
+                    results_.emplace_back(ma_class_t{score, i});
             }
         } break;
 
@@ -149,7 +149,7 @@ ma_err_t Classifier::postprocess() {
             for (decltype(pred_l) i{0}; i < pred_l; ++i) {
                 auto score{data[i]};
                 if (score > threshold_score_)
-                    results_.emplace_front(ma_class_t{score, i});
+                    results_.emplace_back(ma_class_t{score, i});
             }
         } break;
 
@@ -157,16 +157,22 @@ ma_err_t Classifier::postprocess() {
             return MA_ENOTSUP;
     }
 
-    results_.sort([](const ma_class_t& a, const ma_class_t& b) { return a.score > b.score; });
+    // equal scores keep the order of the former list version, i.e. the highest class index first
+    std::sort(results_.begin(), results_.end(), [](const ma_class_t& a, const ma_class_t& b) { return a.score != b.score ? a.score > b.score : a.target > b.target; });
 
     return MA_OK;
 }
 
 
-const std::forward_list<ma_class_t>& Classifier::getResults() {
+Span<const ma_class_t> Classifier::getResultSpan() const {
     return results_;
 }
 
+const std::forward_list<ma_class_t>& Classifier::getResults() {
+    results_list_.assign(results_.begin(), results_.end());
+    return results_list_;
+}
+
 const void* Classifier::getInput() {
     return &img_;
 }
@@ -1,6 +1,7 @@
 #ifndef _MA_MODEL_CLASSIFIER_H
 #define _MA_MODEL_CLASSIFIER_H
 
+#include <forward_list>
 #include <vector>
 
 #include "../cv/ma_cv.h"
@@ -17,7 +18,8 @@ protected:
     bool is_nhwc_;
     const ma_img_t* input_img_;
     double threshold_score_;
-    std::forward_list<ma_class_t> results_;
+    std::vector<ma_class_t> results_;  // capacity kept between runs
+    std::forward_list<ma_class_t> results_list_;
 
 protected:
     ma_err_t preprocess() override;
@@ -27,6 +29,9 @@ public:
     Classifier(Engine* engine);
     virtual ~Classifier();
     static bool isValid(Engine* engine);
+    // valid until the next run
+    Span<const ma_class_t> getResultSpan() const;
+    // compatibility adapter, copies the results into a list
     const std::forward_list<ma_class_t>& getResults();
     const void *getInput();
     ma_err_t run(const ma_img_t* img);
@@ -0,0 +1,144 @@
+#ifndef _MA_MODEL_DECODER_H_
+#define _MA_MODEL_DECODER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "../math/ma_math.h"
+#include "../utils/ma_nms.h"
+
+namespace ma::model::decoder {
+
+/**
+ * Detection decoding in the tensor domain, shared by the detector heads.
+ *
+ * The score threshold is moved into the raw domain of each output once (inverse activation,
+ * then floor quantisation), so filtering and the class argmax are plain integer loops. Only
+ * the candidates passing the threshold are dequantised: their boxes are needed by the NMS,
+ * their pre-activation score orders them like the final score does, and the activation is
+ * applied to the survivors only. Buffers are kept between frames.
+ */
+
+enum class Activation {
+    Linear,
+    Sigmoid,
+};
+
+// element access of a tensor of type T, raw values are int32_t for quantised types
+template <typename T> struct Tensor {
+    using raw_t = std::conditional_t<std::is_floating_point_v<T>, float, int32_t>;
+
+    const T* data;
+    float scale;
+    int32_t zero_point;
+
+    explicit Tensor(const ma_tensor_t& tensor)
+        : data(static_cast<const T*>(tensor.data.data)), scale(tensor.quant_param.scale), zero_point(tensor.quant_param.zero_point) {}
+
+    inline raw_t raw(size_t index) const {
+        return static_cast<raw_t>(data[index]);
+    }
+
+    inline float dequantize(raw_t raw) const {
+        if constexpr (std::is_floating_point_v<T>) {
+            return raw;
+        } else {
+            return ma::math::dequantizeValue(raw, scale, zero_point);
+        }
+    }
+
+    inline float value(size_t index) const {
+        return dequantize(raw(index));
+    }
+
+    // largest raw value whose dequantised value does not exceed value
+    inline raw_t floor(float value) const {
+        if constexpr (std::is_floating_point_v<T>) {
+            return value;
+        } else {
+            return std::clamp(ma::math::quantizeValueFloor(value, scale, zero_point),
+                              static_cast<int32_t>(std::numeric_limits<T>::lowest()) - 1,
+                              static_cast<int32_t>(std::numeric_limits<T>::max()) + 1);
+        }
+    }
+};
+
+// first class with the highest raw score not below best, -1 when none, best is updated
+template <typename T, typename R> inline int32_t argmax(const T* scores, size_t num, R& best) {
+    int32_t target = -1;
+    for (size_t k = 0; k < num; ++k) {
+        const R score = static_cast<R>(scores[k]);
+        if (score < best || (score == best && target >= 0)) [[likely]] {
+            continue;
+        }
+        best   = score;
+        target = static_cast<int32_t>(k);
+    }
+    return target;
+}
+
+class Candidates {
+public:
+    Candidates()  = default;
+    ~Candidates() = default;
+
+    inline void clear() {
+        items_.clear();
+    }
+
+    inline size_t size() const {
+        return items_.size();
+    }
+
+    // key orders the candidates and becomes the score through the activation
+    inline void push(float x, float y, float w, float h, float key, int32_t target) {
+        items_.push_back({ma_bbox_t{.x = x, .y = y, .w = w, .h = h, .score = key, .target = target}, false});
+    }
+
+    // NMS on the keys, then the activation on the survivors, sorted by x like the other detectors
+    template <Activation A> void emit(std::vector<ma_bbox_t>& results, float threshold_iou, bool multi_target) {
+        std::stable_sort(items_.begin(), items_.end(), [](const Item& a, const Item& b) { return a.box.score > b.box.score; });
+
+        for (auto it = items_.begin(); it != items_.end(); ++it) {
+            if (it->suppressed) {
+                continue;
+            }
+            for (auto it2 = std::next(it); it2 != items_.end(); ++it2) {
+                if (it2->suppressed || (multi_target && it->box.target != it2->box.target)) {
+                    continue;
+                }
+                if (ma::utils::compute_iou(it->box, it2->box) > threshold_iou) {
+                    it2->suppressed = true;
+                }
+            }
+        }
+
+        for (const auto& item : items_) {
+            if (item.suppressed) {
+                continue;
+            }
+            results.push_back(item.box);
+            if constexpr (A == Activation::Sigmoid) {
+                results.back().score = ma::math::sigmoid(item.box.score);
+            }
+        }
+
+        std::stable_sort(results.begin(), results.end(), [](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
+    }
+
+private:
+    struct Item {
+        ma_bbox_t box;
+        bool suppressed;
+    };
+
+    std::vector<Item> items_;
+};
+
+}  // namespace ma::model::decoder
+
+#endif  // _MA_MODEL_DECODER_H_
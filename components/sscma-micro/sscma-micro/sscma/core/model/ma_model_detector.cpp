@@ -54,10 +54,15 @@ ma_err_t Detector::preprocess() {
     return ret;
 }
 
-const std::forward_list<ma_bbox_t>& Detector::getResults() {
+Span<const ma_bbox_t> Detector::getResultSpan() const {
     return results_;
 }
 
+const std::forward_list<ma_bbox_t>& Detector::getResults() {
+    results_list_.assign(results_.begin(), results_.end());
+    return results_list_;
+}
+
 const void* Detector::getInput() {
     return static_cast<const void*>(&img_);
 }
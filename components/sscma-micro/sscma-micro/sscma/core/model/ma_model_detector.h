@@ -1,6 +1,7 @@
 #ifndef _MA_MODEL_DETECTOR_H
 #define _MA_MODEL_DETECTOR_H
 
+#include <forward_list>
 #include <vector>
 
 #include "../cv/ma_cv.h"
@@ -17,7 +18,8 @@ protected:
     double threshold_nms_;
     double threshold_score_;
     bool is_nhwc_;
-    std::forward_list<ma_bbox_t> results_;
+    std::vector<ma_bbox_t> results_;  // capacity kept between runs
+    std::forward_list<ma_bbox_t> results_list_;
 
 protected:
     ma_err_t preprocess() override;
@@ -25,6 +27,9 @@ protected:
 public:
     Detector(Engine* engine, const char* name, ma_model_type_t type);
     virtual ~Detector();
+    // valid until the next run
+    Span<const ma_bbox_t> getResultSpan() const;
+    // compatibility adapter, copies the results into a list
     const std::forward_list<ma_bbox_t>& getResults();
     const void* getInput() override;
     ma_err_t run(const ma_img_t* img);
@@ -127,11 +127,11 @@ ma_err_t FOMO::postProcessI8() {
             box.score  = max_score;
             box.target = max_target;
 
-            results_.emplace_front(std::move(box));
+            results_.emplace_back(std::move(box));
         }
     }
 
-    results_.sort([](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
+    std::stable_sort(results_.begin(), results_.end(), [](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
 
     return MA_OK;
 }
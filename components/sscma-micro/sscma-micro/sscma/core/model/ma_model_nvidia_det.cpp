@@ -1,7 +1,6 @@
 #include "ma_model_nvidia_det.h"
 
 #include <algorithm>
-#include <forward_list>
 #include <vector>
 
 #include "../utils/ma_nms.h"
@@ -94,68 +93,57 @@ ma_err_t NvidiaDet::postprocess() {
     }
 }
 
-ma_err_t NvidiaDet::postProcessF32() {
+template <typename T> ma_err_t NvidiaDet::decode() {
     results_.clear();
+    candidates_.clear();
 
     // get output
     const auto out0 = p_engine_->getOutput(0);
     const auto out1 = p_engine_->getOutput(1);
 
-    const auto* data0 = out0.data.f32;
-    const auto* data1 = out1.data.f32;
-
-    const auto output_shape0 = out0.shape;
-    const auto output_shape1 = out1.shape;
+    const bool bboxes_first = out0.shape.dims[3] > out1.shape.dims[3];
 
-    const auto* bboxs = output_shape0.dims[3] > output_shape1.dims[3] ? data0 : data1;
-    const auto* conf  = output_shape0.dims[3] > output_shape1.dims[3] ? data1 : data0;
+    const decoder::Tensor<T> bboxs(bboxes_first ? out0 : out1);
+    const decoder::Tensor<T> conf(bboxes_first ? out1 : out0);
 
-    conf_shape_   = output_shape0.dims[3] > output_shape1.dims[3] ? output_shape1 : output_shape0;
-    bboxes_shape_ = output_shape0.dims[3] > output_shape1.dims[3] ? output_shape0 : output_shape1;
+    conf_shape_   = bboxes_first ? out1.shape : out0.shape;
+    bboxes_shape_ = bboxes_first ? out0.shape : out1.shape;
 
     const auto H = conf_shape_.dims[1];
     const auto W = conf_shape_.dims[2];
     const auto N = conf_shape_.dims[3];
     const auto C = N * 4;
 
+    const auto conf_threshold_raw = conf.floor(0.2f);
+
     for (int h = 0; h < H; h++) {
         for (int w = 0; w < W; w++) {
             for (int j = 0; j < N; j++) {
-                if (conf[h * (W * N) + w * N + j] > 0.2) {
-                    ma_bbox_t box;
-
-                    box.x = (w * stride_ + offset_ - bboxs[h * (W * C) + w * C + j * 4] * scale_) /
-                        img_.width;
-                    box.y =
-                        (h * stride_ + offset_ - bboxs[h * (W * C) + w * C + j * 4 + 1] * scale_) /
-                        img_.height;
-
-                    box.w =
-                        ((w * stride_ + offset_ + bboxs[h * (W * C) + w * C + j * 4 + 2] * scale_) /
-                         img_.width) -
-                        box.x;
-                    box.h =
-                        ((h * stride_ + offset_ + bboxs[h * (W * C) + w * C + j * 4 + 3] * scale_) /
-                         img_.height) -
-                        box.y;
-
-                    box.x = box.x + box.w / 2;
-                    box.y = box.y + box.h / 2;
-
-                    box.score  = conf[h * (W * N) + w * N + j] * 2.0;
-                    box.target = j;
-
-                    results_.emplace_front(std::move(box));
+                const auto conf_raw = conf.raw(h * (W * N) + w * N + j);
+                if (conf_raw <= conf_threshold_raw) [[likely]] {
+                    continue;
                 }
+
+                const size_t pre = h * (W * C) + w * C + j * 4;
+
+                float x = (w * stride_ + offset_ - bboxs.value(pre) * scale_) / img_.width;
+                float y = (h * stride_ + offset_ - bboxs.value(pre + 1) * scale_) / img_.height;
+
+                float bw = ((w * stride_ + offset_ + bboxs.value(pre + 2) * scale_) / img_.width) - x;
+                float bh = ((h * stride_ + offset_ + bboxs.value(pre + 3) * scale_) / img_.height) - y;
+
+                candidates_.push(x + bw / 2, y + bh / 2, bw, bh, conf.dequantize(conf_raw) * 2.0f, j);
             }
         }
     }
 
-    ma::utils::nms(results_, threshold_nms_, threshold_score_, false, true);
-
-    results_.sort([](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
+    candidates_.emit<decoder::Activation::Linear>(results_, threshold_nms_, true);
 
     return MA_OK;
 }
 
+ma_err_t NvidiaDet::postProcessF32() {
+    return decode<float>();
+}
+
 }  // namespace ma::model
@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "ma_model_decoder.h"
 #include "ma_model_detector.h"
 
 namespace ma::model {
@@ -16,6 +17,10 @@ class NvidiaDet : public Detector {
     int8_t scale_  = 35;
     float  offset_ = 0.5;
 
+    decoder::Candidates candidates_;
+
+    template <typename T> ma_err_t decode();
+
    protected:
     ma_err_t postprocess() override;
 
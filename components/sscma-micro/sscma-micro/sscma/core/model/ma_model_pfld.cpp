@@ -96,7 +96,7 @@ ma_err_t PFLD::postProcessI8() {
         point.score  = 1.0;
         point.target = i / 2;
 
-        results_.push_front(std::move(point));
+        results_.push_back(std::move(point));
     }
 
     return MA_OK;
@@ -0,0 +1,166 @@
+#include "ma_model_pipeline.h"
+
+namespace ma {
+
+constexpr char TAG[] = "ma::model::pipeline";
+
+ModelPipeline::ModelPipeline(const std::vector<Model*>& lanes, Callback callback)
+    : callback_(std::move(callback)), free_(lanes.size()), infer_(lanes.size()), post_(lanes.size()), infer_thread_(nullptr), post_thread_(nullptr), started_(false) {
+
+    MA_ASSERT(lanes.size() > 0 && lanes.size() <= 64);
+
+    lanes_.reserve(lanes.size());
+    for (auto model : lanes) {
+        MA_ASSERT(model != nullptr);
+        lanes_.push_back({model, MA_OK});
+    }
+    for (auto& lane : lanes_) {
+        lane.model->p_pipeline_ = this;
+        free_.post(&lane, 0);
+    }
+
+    infer_thread_ = new Thread("pipeline#infer", &ModelPipeline::inferenceEntryStub, this);
+    post_thread_  = new Thread("pipeline#post", &ModelPipeline::postprocessEntryStub, this);
+}
+
+ModelPipeline::~ModelPipeline() {
+    stop();
+
+    if (infer_thread_ != nullptr) {
+        delete infer_thread_;
+        infer_thread_ = nullptr;
+    }
+    if (post_thread_ != nullptr) {
+        delete post_thread_;
+        post_thread_ = nullptr;
+    }
+
+    for (auto& lane : lanes_) {
+        lane.model->p_pipeline_ = nullptr;
+    }
+}
+
+ma_err_t ModelPipeline::start() {
+    if (started_) {
+        return MA_OK;
+    }
+    if (infer_thread_ == nullptr || post_thread_ == nullptr) {
+        return MA_ENOMEM;
+    }
+
+    started_ = true;
+
+    if (!infer_thread_->start(this) || !post_thread_->start(this)) {
+        stop();
+        return MA_EIO;
+    }
+
+    MA_LOGI(TAG, "pipeline started with %zu lanes", lanes_.size());
+
+    return MA_OK;
+}
+
+ma_err_t ModelPipeline::stop() {
+    if (!started_) {
+        return MA_OK;
+    }
+    started_ = false;
+
+    infer_thread_->join();
+    post_thread_->join();
+
+    // cancel the frames still in flight, the callback owns their user context
+    Lane* lane = nullptr;
+    while (infer_.fetch(reinterpret_cast<void**>(&lane), 0)) {
+        lane->err = MA_EBUSY;
+        complete(lane);
+    }
+    while (post_.fetch(reinterpret_cast<void**>(&lane), 0)) {
+        lane->err = MA_EBUSY;
+        complete(lane);
+    }
+
+    return MA_OK;
+}
+
+Model* ModelPipeline::acquire(ma_tick_t timeout) {
+    Lane* lane = nullptr;
+    if (!started_ || !free_.fetch(reinterpret_cast<void**>(&lane), timeout)) {
+        return nullptr;
+    }
+    lane->err = MA_OK;
+    return lane->model;
+}
+
+void ModelPipeline::release(Model* model) {
+    Lane* lane = find(model);
+    if (lane != nullptr) {
+        free_.post(lane, 0);
+    }
+}
+
+size_t ModelPipeline::size() const {
+    return lanes_.size();
+}
+
+ModelPipeline::Lane* ModelPipeline::find(Model* model) {
+    for (auto& lane : lanes_) {
+        if (lane.model == model) {
+            return &lane;
+        }
+    }
+    return nullptr;
+}
+
+ma_err_t ModelPipeline::enqueue(Model* model) {
+    Lane* lane = find(model);
+    if (lane == nullptr) {
+        return MA_EINVAL;
+    }
+    // never blocks: a lane can only be in one queue at a time
+    if (!infer_.post(lane, 0)) {
+        return MA_EBUSY;
+    }
+    return MA_OK;
+}
+
+void ModelPipeline::complete(Lane* lane) {
+    if (callback_) {
+        callback_(lane->model, lane->err, lane->model->getUserCtx());
+    }
+    free_.post(lane, 0);
+}
+
+void ModelPipeline::inferenceEntry() {
+    Lane* lane = nullptr;
+    while (started_) {
+        if (!infer_.fetch(reinterpret_cast<void**>(&lane), Tick::fromMilliseconds(100))) {
+            continue;
+        }
+        lane->err = lane->model->runInference();
+        post_.post(lane, 0);
+    }
+}
+
+void ModelPipeline::postprocessEntry() {
+    Lane* lane = nullptr;
+    while (started_) {
+        if (!post_.fetch(reinterpret_cast<void**>(&lane), Tick::fromMilliseconds(100))) {
+            continue;
+        }
+        if (lane->err == MA_OK) {
+            lane->err = lane->model->runPostprocess();
+        }
+        complete(lane);
+    }
+}
+
+void ModelPipeline::inferenceEntryStub(void* obj) {
+    reinterpret_cast<ModelPipeline*>(obj)->inferenceEntry();
+}
+
+void ModelPipeline::postprocessEntryStub(void* obj) {
+    reinterpret_cast<ModelPipeline*>(obj)->postprocessEntry();
+}
+
+}  // namespace ma
@@ -0,0 +1,74 @@
+#ifndef _MA_MODEL_PIPELINE_H_
+#define _MA_MODEL_PIPELINE_H_
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "../ma_common.h"
+#include "porting/ma_osal.h"
+
+#include "ma_model_base.h"
+
+namespace ma {
+
+/**
+ * Pipelined run mode for Model.
+ *
+ * Each lane is a Model bound to its own Engine instance, i.e. its own set of input/output
+ * tensors. A lane acquired from the pipeline is preprocessed on the caller's thread by the
+ * usual Model::run(), then handed over to the inference worker and finally to the postprocess
+ * worker, which reports the results through the completion callback together with the user
+ * context set on the lane. With three lanes, the preprocess of frame N+1 and the postprocess of
+ * frame N-1 overlap the forward pass of frame N. With two lanes only one of them can overlap the
+ * forward pass at a time, as the third frame has no lane to be preprocessed into.
+ */
+class ModelPipeline {
+public:
+    using Callback = std::function<void(Model* model, ma_err_t err, void* ctx)>;
+
+    ModelPipeline(const std::vector<Model*>& lanes, Callback callback);
+    ~ModelPipeline();
+
+    ma_err_t start();
+    ma_err_t stop();
+
+    // wait for a lane recycled by the postprocess stage, nullptr on timeout
+    Model* acquire(ma_tick_t timeout = Tick::waitForever);
+    // give back a lane that has been acquired but not run
+    void release(Model* model);
+
+    size_t size() const;
+
+protected:
+    ma_err_t enqueue(Model* model);
+
+    void inferenceEntry();
+    void postprocessEntry();
+    static void inferenceEntryStub(void* obj);
+    static void postprocessEntryStub(void* obj);
+
+private:
+    struct Lane {
+        Model* model;
+        ma_err_t err;
+    };
+
+    Lane* find(Model* model);
+    void complete(Lane* lane);
+
+    std::vector<Lane> lanes_;
+    Callback callback_;
+    MessageBox free_;
+    MessageBox infer_;
+    MessageBox post_;
+    Thread* infer_thread_;
+    Thread* post_thread_;
+    std::atomic<bool> started_;
+
+    friend class Model;
+};
+
+}  // namespace ma
+
+#endif  // _MA_MODEL_PIPELINE_H_
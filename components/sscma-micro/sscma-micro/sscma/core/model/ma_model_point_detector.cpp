@@ -30,10 +30,15 @@ PointDetector::PointDetector(Engine* p_engine, const char* name, ma_model_type_t
 
 PointDetector::~PointDetector() {}
 
-const std::forward_list<ma_point_t>& PointDetector::getResults() const {
+Span<const ma_point_t> PointDetector::getResultSpan() const {
     return results_;
 }
 
+const std::forward_list<ma_point_t>& PointDetector::getResults() const {
+    results_list_.assign(results_.begin(), results_.end());
+    return results_list_;
+}
+
 ma_err_t PointDetector::preprocess() {
     ma_err_t ret = MA_OK;
 
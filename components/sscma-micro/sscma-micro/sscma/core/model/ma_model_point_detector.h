@@ -2,6 +2,7 @@
 #define _MA_MODEL_POINT_DETECTOR_H_
 
 #include <forward_list>
+#include <vector>
 
 #include "ma_model_base.h"
 
@@ -17,7 +18,8 @@ protected:
 
     bool is_nhwc_;
 
-    std::forward_list<ma_point_t> results_;
+    std::vector<ma_point_t> results_;  // capacity kept between runs
+    mutable std::forward_list<ma_point_t> results_list_;
 
 protected:
     ma_err_t preprocess() override;
@@ -26,6 +28,9 @@ public:
     PointDetector(Engine* engine, const char* name, ma_model_type_t type);
     virtual ~PointDetector();
 
+    // valid until the next run
+    Span<const ma_point_t> getResultSpan() const;
+    // compatibility adapter, copies the results into a list
     const std::forward_list<ma_point_t>& getResults() const;
 
     ma_err_t run(const ma_img_t* img);
@@ -31,10 +31,15 @@ PoseDetector::PoseDetector(Engine* p_engine, const char* name, ma_model_type_t t
 
 PoseDetector::~PoseDetector() {}
 
-const std::forward_list<ma_keypoint3f_t>& PoseDetector::getResults() const {
+Span<const ma_keypoint3f_t> PoseDetector::getResultSpan() const {
     return results_;
 }
 
+const std::forward_list<ma_keypoint3f_t>& PoseDetector::getResults() const {
+    results_list_.assign(results_.begin(), results_.end());
+    return results_list_;
+}
+
 const void* PoseDetector::getInput() {
     return static_cast<const void*>(&img_);
 }
@@ -6,6 +6,7 @@
 #include <utility>
 #include <vector>
 
+#include "ma_model_decoder.h"
 #include "ma_model_detector.h"
 
 namespace ma::model {
@@ -23,6 +24,10 @@ class RTMDet : public Detector {
     size_t output_scores_ids_[anchor_variants_];
     size_t output_bboxes_ids_[anchor_variants_];
 
+    decoder::Candidates candidates_;
+
+    template <typename T> ma_err_t decode();
+
    protected:
     ma_err_t postprocess() override;
 
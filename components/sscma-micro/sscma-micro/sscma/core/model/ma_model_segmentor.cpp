@@ -54,10 +54,15 @@ const void* Segmentor::getInput() {
     return static_cast<const void*>(&img_);
 }
 
-const std::forward_list<ma_segm2f_t>& Segmentor::getResults() const {
+Span<const ma_segm2f_t> Segmentor::getResultSpan() const {
     return results_;
 }
 
+const std::forward_list<ma_segm2f_t>& Segmentor::getResults() const {
+    results_list_.assign(results_.begin(), results_.end());
+    return results_list_;
+}
+
 ma_err_t Segmentor::run(const ma_img_t* img) {
 
     input_img_ = img;
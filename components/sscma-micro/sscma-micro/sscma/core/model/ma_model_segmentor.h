@@ -1,6 +1,7 @@
 #ifndef _MA_MODEL_SEGMENTOR_H_
 #define _MA_MODEL_SEGMENTOR_H_
 
+#include <forward_list>
 #include <vector>
 
 #include "ma_model_base.h"
@@ -18,7 +19,8 @@ protected:
 
     bool is_nhwc_;
 
-    std::forward_list<ma_segm2f_t> results_;
+    std::vector<ma_segm2f_t> results_;  // capacity kept between runs
+    mutable std::forward_list<ma_segm2f_t> results_list_;
 
 protected:
     ma_err_t preprocess() override;
@@ -27,6 +29,9 @@ public:
     Segmentor(Engine* engine, const char* name, ma_model_type_t type);
     virtual ~Segmentor();
 
+    // valid until the next run
+    Span<const ma_segm2f_t> getResultSpan() const;
+    // compatibility adapter, copies the results into a list
     const std::forward_list<ma_segm2f_t>& getResults() const;
 
     ma_err_t run(const ma_img_t* img);
@@ -153,7 +153,7 @@ ma_err_t Yolo11::postProcessI8() {
                     box.y      = (y1 + h / 2.0) / img_.height;
                     box.w      = w / img_.width;
                     box.h      = h / img_.height;
-                    results_.emplace_front(std::move(box));
+                    results_.emplace_back(std::move(box));
                 }
             }
         }
@@ -218,7 +218,7 @@ ma_err_t Yolo11::postProcessF32() {
                     box.y      = (y1 + h / 2.0) / img_.height;
                     box.w      = w / img_.width;
                     box.h      = h / img_.height;
-                    results_.emplace_front(std::move(box));
+                    results_.emplace_back(std::move(box));
                 }
             }
         }
@@ -242,7 +242,7 @@ ma_err_t Yolo11::postprocess() {
 
     ma::utils::nms(results_, threshold_nms_, threshold_score_, false, false);
 
-    results_.sort([](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
+    std::stable_sort(results_.begin(), results_.end(), [](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
 
     return err;
 }
@@ -83,7 +83,8 @@ ma_err_t Yolo11Pose::postProcessI8() {
 
     const float score_threshold_non_sigmoid = ma::math::inverseSigmoid(threshold_score_);
 
-    std::forward_list<ma_bbox_ext_t> multi_level_bboxes;
+    auto& multi_level_bboxes = candidates_;
+    multi_level_bboxes.clear();
 
     auto* data = outputs_.data.f32;
     for (decltype(num_record_) i = 0; i < num_record_; ++i) {
@@ -107,7 +108,7 @@ ma_err_t Yolo11Pose::postProcessI8() {
         bbox.score  = ma::math::dequantizeValue(score, outputs_.quant_param.scale, outputs_.quant_param.zero_point);
         bbox.target = 0;
 
-        multi_level_bboxes.emplace_front(std::move(bbox));
+        multi_level_bboxes.emplace_back(std::move(bbox));
     }
 
     ma::utils::nms(multi_level_bboxes, threshold_nms_, threshold_score_, false, true);
@@ -132,14 +133,15 @@ ma_err_t Yolo11Pose::postProcessI8() {
         keypoint.pts = n_keypoint;
 
 
-        results_.emplace_front(std::move(keypoint));
+        results_.emplace_back(std::move(keypoint));
     }
 
     return MA_OK;
 }
 ma_err_t Yolo11Pose::postProcessF32() {
 
-    std::forward_list<ma_bbox_ext_t> multi_level_bboxes;
+    auto& multi_level_bboxes = candidates_;
+    multi_level_bboxes.clear();
 
     auto* data = outputs_.data.f32;
     for (decltype(num_record_) i = 0; i < num_record_; ++i) {
@@ -163,7 +165,7 @@ ma_err_t Yolo11Pose::postProcessF32() {
         bbox.score  = score;
         bbox.target = 0;
 
-        multi_level_bboxes.emplace_front(std::move(bbox));
+        multi_level_bboxes.emplace_back(std::move(bbox));
     }
 
     ma::utils::nms(multi_level_bboxes, threshold_nms_, threshold_score_, false, true);
@@ -188,7 +190,7 @@ ma_err_t Yolo11Pose::postProcessF32() {
         keypoint.pts = n_keypoint;
 
 
-        results_.emplace_front(std::move(keypoint));
+        results_.emplace_back(std::move(keypoint));
     }
 
     return MA_OK;
@@ -17,6 +17,7 @@ private:
     int32_t num_element_;
     int32_t num_class_;
     int32_t num_keypoints_;
+    std::vector<ma_bbox_ext_t> candidates_;  // reused between frames
 
 protected:
     ma_err_t postprocess() override;
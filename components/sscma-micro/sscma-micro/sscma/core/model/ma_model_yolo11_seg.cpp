@@ -23,6 +23,8 @@ Yolo11Seg::Yolo11Seg(Engine* p_engine_) : Segmentor(p_engine_, "yolo11_seg", MA_
 
     num_class_  = bboxes_.shape.dims[1] - 36;  // 4 + 1 + 32
     num_record_ = bboxes_.shape.dims[2];
+
+    threshold_mask_ = 0.5f;
 }
 
 Yolo11Seg::~Yolo11Seg() {}
@@ -76,6 +78,9 @@ bool Yolo11Seg::isValid(Engine* engine) {
 }
 
 ma_err_t Yolo11Seg::postprocess() {
+    for (auto& result : results_) {
+        mask_pool_.emplace_back(std::move(result.mask.data));
+    }
     results_.clear();
     if (bboxes_.type == MA_TENSOR_TYPE_F32) {
         return postProcessF32();
@@ -85,7 +90,8 @@ ma_err_t Yolo11Seg::postprocess() {
 
 ma_err_t Yolo11Seg::postProcessF32() {
 
-    std::forward_list<ma_bbox_ext_t> multi_level_bboxes;
+    auto& multi_level_bboxes = candidates_;
+    multi_level_bboxes.clear();
     auto* data = bboxes_.data.f32;
     for (decltype(num_record_) i = 0; i < num_record_; ++i) {
 
@@ -120,7 +126,7 @@ ma_err_t Yolo11Seg::postProcessF32() {
         bbox.score  = max;
         bbox.target = target;
 
-        multi_level_bboxes.emplace_front(std::move(bbox));
+        multi_level_bboxes.emplace_back(std::move(bbox));
     }
 
     ma::utils::nms(multi_level_bboxes, threshold_nms_, threshold_score_, false, true);
@@ -129,44 +135,37 @@ ma_err_t Yolo11Seg::postProcessF32() {
         return MA_OK;
 
     // fetch mask
-    for (auto& bbox : multi_level_bboxes) {
-        ma_segm2f_t seg;
-        seg.box         = {.x = bbox.x, .y = bbox.y, .w = bbox.w, .h = bbox.h, .score = bbox.score, .target = bbox.target};
-        seg.mask.width  = protos_.shape.dims[2];
-        seg.mask.height = protos_.shape.dims[3];
-        seg.mask.data.resize(protos_.shape.dims[2] * protos_.shape.dims[3] / 8, 0);  // bitwise
-
-        const int mask_size = protos_.shape.dims[2] * protos_.shape.dims[3];
+    const int num_protos = protos_.shape.dims[1];
+    const int height     = protos_.shape.dims[2];
+    const int width      = protos_.shape.dims[3];
+    const size_t num     = multi_level_bboxes.size();
 
-        std::vector<float> masks(mask_size, 0.0f);
+    mask_coeffs_.resize(num * num_protos);
+    mask_rois_.resize(num);
+    mask_bits_.resize(num);
 
-        // TODO: parallel for
-        for (int j = 0; j < protos_.shape.dims[1]; ++j) {
-            float mask_in = bboxes_.data.f32[bbox.index + num_record_ * (4 + num_class_ + j)];
-            for (int i = 0; i < mask_size; ++i) {
-                masks[i] += mask_in * protos_.data.f32[j * mask_size + i];
-            }
+    size_t n = 0;
+    for (auto& bbox : multi_level_bboxes) {
+        for (int j = 0; j < num_protos; ++j) {
+            mask_coeffs_[n * num_protos + j] = data[bbox.index + num_record_ * (4 + num_class_ + j)];
         }
+        mask_rois_[n] = utils::MaskAssembler::roi(bbox, height, width);
 
-        int x1 = (bbox.x - bbox.w / 2) * protos_.shape.dims[2];
-        int y1 = (bbox.y - bbox.h / 2) * protos_.shape.dims[3];
-        int x2 = (bbox.x + bbox.w / 2) * protos_.shape.dims[2];
-        int y2 = (bbox.y + bbox.h / 2) * protos_.shape.dims[3];
-
-        for (int i = 0; i < protos_.shape.dims[2]; i++) {
-            for (int j = 0; j < protos_.shape.dims[3]; j++) {
-                if (i < y1 || i >= y2 || j < x1 || j >= x2) [[likely]] {
-                    continue;
-                }
-                if (masks[i * protos_.shape.dims[3] + j] > 0.5) {
-                    seg.mask.data[i * protos_.shape.dims[3] / 8 + j / 8] |= (1 << (j % 8));
-                }
-            }
+        ma_segm2f_t seg;
+        seg.box         = {.x = bbox.x, .y = bbox.y, .w = bbox.w, .h = bbox.h, .score = bbox.score, .target = bbox.target};
+        seg.mask.width  = width;
+        seg.mask.height = height;
+        if (!mask_pool_.empty()) {
+            seg.mask.data = std::move(mask_pool_.back());
+            mask_pool_.pop_back();
         }
+        seg.mask.data.assign(width * height / 8, 0);  // bitwise
 
-        results_.emplace_front(std::move(seg));
+        results_.emplace_back(std::move(seg));
+        mask_bits_[n++] = results_.back().mask.data.data();
     }
 
+    mask_assembler_.assemble(protos_.data.f32, num_protos, height, width, mask_coeffs_.data(), mask_rois_.data(), num, threshold_mask_, mask_bits_.data());
 
     return MA_OK;
 }
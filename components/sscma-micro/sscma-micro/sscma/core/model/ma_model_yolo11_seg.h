@@ -6,6 +6,7 @@
 #include <utility>
 #include <vector>
 
+#include "../utils/ma_mask.h"
 #include "ma_model_segmentor.h"
 
 namespace ma::model {
@@ -16,6 +17,14 @@ private:
     ma_tensor_t protos_;
     int32_t num_record_;
     int32_t num_class_;
+    float threshold_mask_;  // logit
+    std::vector<ma_bbox_ext_t> candidates_;  // reused between frames
+
+    utils::MaskAssembler mask_assembler_;
+    std::vector<float> mask_coeffs_;
+    std::vector<utils::MaskAssembler::Roi> mask_rois_;
+    std::vector<uint8_t*> mask_bits_;
+    std::vector<std::vector<uint8_t>> mask_pool_;  // buffers of the previous results
 
 protected:
     ma_err_t postprocess() override;
@@ -170,59 +170,32 @@ ma_err_t YoloWorld::postprocess() {
     return MA_ENOTSUP;
 }
 
-ma_err_t YoloWorld::postProcessI8() {
+template <typename T> ma_err_t YoloWorld::decode() {
     results_.clear();
+    candidates_.clear();
 
-    const int8_t* output_data[num_outputs_];
-
-    for (size_t i = 0; i < num_outputs_; ++i) {
-        output_data[i] = outputs_[i].data.s8;
-    }
-
-    const auto score_threshold = threshold_score_;
-    const auto iou_threshold   = threshold_nms_;
-
-    const float score_threshold_non_sigmoid = ma::math::inverseSigmoid(score_threshold);
+    const float score_threshold_non_sigmoid = ma::math::inverseSigmoid(threshold_score_);
 
     const auto anchor_matrix_size = anchor_matrix_.size();
 
     for (size_t i = 0; i < anchor_matrix_size; ++i) {
-        const auto   output_scores_id           = output_scores_ids_[i];
-        const auto*  output_scores              = output_data[output_scores_id];
-        const size_t output_scores_shape_dims_2 = outputs_[output_scores_id].shape.dims[2];
-        const auto   output_scores_quant_parm   = outputs_[output_scores_id].quant_param;
+        const decoder::Tensor<T> output_scores(outputs_[output_scores_ids_[i]]);
+        const size_t output_scores_shape_dims_2 = outputs_[output_scores_ids_[i]].shape.dims[2];
 
-        const auto   output_bboxes_id           = output_bboxes_ids_[i];
-        const auto*  output_bboxes              = output_data[output_bboxes_id];
-        const size_t output_bboxes_shape_dims_2 = outputs_[output_bboxes_id].shape.dims[2];
-        const auto   output_bboxes_quant_parm   = outputs_[output_bboxes_id].quant_param;
+        const decoder::Tensor<T> output_bboxes(outputs_[output_bboxes_ids_[i]]);
+        const size_t output_bboxes_shape_dims_2 = outputs_[output_bboxes_ids_[i]].shape.dims[2];
 
         const auto& anchor_array      = anchor_matrix_[i];
         const auto  anchor_array_size = anchor_array.size();
 
-        const int32_t score_threshold_quan_non_sigmoid = ma::math::quantizeValueFloor(
-          score_threshold_non_sigmoid, output_scores_quant_parm.scale, output_scores_quant_parm.zero_point);
+        const auto score_threshold_raw = output_scores.floor(score_threshold_non_sigmoid);
 
         for (size_t j = 0; j < anchor_array_size; ++j) {
-            const auto j_mul_output_scores_shape_dims_2 = j * output_scores_shape_dims_2;
-
-            auto    max_score_raw = score_threshold_quan_non_sigmoid;
-            int32_t target        = -1;
-
-            for (size_t k = 0; k < output_scores_shape_dims_2; ++k) {
-                int8_t score = output_scores[j_mul_output_scores_shape_dims_2 + k];
+            auto max_score_raw   = score_threshold_raw;
+            const int32_t target = decoder::argmax(output_scores.data + j * output_scores_shape_dims_2, output_scores_shape_dims_2, max_score_raw);
 
-                if (static_cast<decltype(max_score_raw)>(score) < max_score_raw) [[likely]]
-                    continue;
-
-                max_score_raw = score;
-                target        = k;
-            }
-
-            if (target < 0) continue;
-
-            const float real_score = ma::math::sigmoid(ma::math::dequantizeValue(
-              max_score_raw, output_scores_quant_parm.scale, output_scores_quant_parm.zero_point));
+            if (target < 0) [[likely]]
+                continue;
 
             // DFL
             float dist[4];
@@ -232,9 +205,7 @@ ma_err_t YoloWorld::postProcessI8() {
             for (size_t m = 0; m < 4; ++m) {
                 const size_t offset = pre + m * 16;
                 for (size_t n = 0; n < 16; ++n) {
-                    matrix[n] = ma::math::dequantizeValue(static_cast<int32_t>(output_bboxes[offset + n]),
-                                                          output_bboxes_quant_parm.scale,
-                                                          output_bboxes_quant_parm.zero_point);
+                    matrix[n] = output_bboxes.value(offset + n);
                 }
 
                 ma::math::softmax(matrix, 16);
@@ -253,104 +224,22 @@ ma_err_t YoloWorld::postProcessI8() {
             float w  = dist[0] + dist[2];
             float h  = dist[1] + dist[3];
 
-            results_.emplace_front(ma_bbox_t{.x = cx, .y = cy, .w = w, .h = h, .score = real_score, .target = target});
+            candidates_.push(cx, cy, w, h, output_scores.dequantize(max_score_raw), target);
         }
     }
 
-    ma::utils::nms(results_, threshold_nms_, threshold_score_, false, true);
-
-    results_.sort([](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
+    candidates_.emit<decoder::Activation::Sigmoid>(results_, threshold_nms_, true);
 
     return MA_OK;
 }
 
+ma_err_t YoloWorld::postProcessI8() {
+    return decode<int8_t>();
+}
+
 #ifdef MA_MODEL_POSTPROCESS_FP32_VARIANT
 ma_err_t YoloWorld::postProcessF32() {
-    results_.clear();
-
-    const float* output_data[num_outputs_];
-
-    for (size_t i = 0; i < num_outputs_; ++i) {
-        output_data[i] = outputs_[i].data.f32;
-    }
-
-    const auto score_threshold = threshold_score_;
-    const auto iou_threshold   = threshold_nms_;
-
-    const float score_threshold_non_sigmoid = ma::math::inverseSigmoid(score_threshold);
-
-    const auto anchor_matrix_size = anchor_matrix_.size();
-
-    for (size_t i = 0; i < anchor_matrix_size; ++i) {
-        const auto   output_scores_id           = output_scores_ids_[i];
-        const auto*  output_scores              = output_data[output_scores_id];
-        const size_t output_scores_shape_dims_2 = outputs_[output_scores_id].shape.dims[2];
-        const auto   output_scores_quant_parm   = outputs_[output_scores_id].quant_param;
-
-        const auto   output_bboxes_id           = output_bboxes_ids_[i];
-        const auto*  output_bboxes              = output_data[output_bboxes_id];
-        const size_t output_bboxes_shape_dims_2 = outputs_[output_bboxes_id].shape.dims[2];
-        const auto   output_bboxes_quant_parm   = outputs_[output_bboxes_id].quant_param;
-
-        const auto& anchor_array      = anchor_matrix_[i];
-        const auto  anchor_array_size = anchor_array.size();
-
-        for (size_t j = 0; j < anchor_array_size; ++j) {
-            const auto j_mul_output_scores_shape_dims_2 = j * output_scores_shape_dims_2;
-
-            auto    max_score_raw = score_threshold_non_sigmoid;
-            int32_t target        = -1;
-
-            for (size_t k = 0; k < output_scores_shape_dims_2; ++k) {
-                int8_t score = output_scores[j_mul_output_scores_shape_dims_2 + k];
-
-                if (static_cast<decltype(max_score_raw)>(score) < max_score_raw) [[likely]]
-                    continue;
-
-                max_score_raw = score;
-                target        = k;
-            }
-
-            if (target < 0) continue;
-
-            const float real_score = ma::math::sigmoid(max_score_raw);
-
-            // DFL
-            float dist[4];
-            float matrix[16];
-
-            const auto pre = j * output_bboxes_shape_dims_2;
-            for (size_t m = 0; m < 4; ++m) {
-                const size_t offset = pre + m * 16;
-                for (size_t n = 0; n < 16; ++n) {
-                    matrix[n] = output_bboxes[offset + n];
-                }
-
-                ma::math::softmax(matrix, 16);
-
-                float res = 0.0;
-                for (size_t n = 0; n < 16; ++n) {
-                    res += matrix[n] * static_cast<float>(n);
-                }
-                dist[m] = res;
-            }
-
-            const auto anchor = anchor_array[j];
-
-            float cx = anchor.x + ((dist[2] - dist[0]) * 0.5f);
-            float cy = anchor.y + ((dist[3] - dist[1]) * 0.5f);
-            float w  = dist[0] + dist[2];
-            float h  = dist[1] + dist[3];
-
-            results_.emplace_front(ma_bbox_t{.x = cx, .y = cy, .w = w, .h = h, .score = real_score, .target = target});
-        }
-    }
-
-    ma::utils::nms(results_, threshold_nms_, threshold_score_, false, true);
-
-    results_.sort([](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
-
-    return MA_OK;
+    return decode<float>();
 }
 #endif
 
@@ -1,5 +1,6 @@
 #include <algorithm>
-#include <forward_list>
+#include <limits>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -107,94 +108,63 @@ bool YoloV5::isValid(Engine* engine) {
     }
 }
 
-ma_err_t YoloV5::generalPostProcess() {
-    if (output_.type == MA_TENSOR_TYPE_S8) {
-        auto* data      = output_.data.s8;
-        auto scale      = output_.quant_param.scale;
-        auto zero_point = output_.quant_param.zero_point;
-        bool normalized = scale < 0.1f;
-
-        for (decltype(num_record_) i = 0; i < num_record_; ++i) {
-            auto idx = i * num_element_;
-
-            auto score = static_cast<float>(data[idx + INDEX_S] - zero_point) * scale;
-            score      = normalized ? score : score / 100.0f;
-
-            if (score <= threshold_score_)
-                continue;
-
-            int8_t max_class = -128;
-            int target       = 0;
-            for (decltype(num_class_) t = 0; t < num_class_; ++t) {
-                if (max_class < data[idx + INDEX_T + t]) {
-                    max_class = data[idx + INDEX_T + t];
-                    target    = t;
-                }
-            }
+template <typename T> ma_err_t YoloV5::decode() {
+    candidates_.clear();
 
-            float x = ((data[idx + INDEX_X] - zero_point) * scale);
-            float y = ((data[idx + INDEX_Y] - zero_point) * scale);
-            float w = ((data[idx + INDEX_W] - zero_point) * scale);
-            float h = ((data[idx + INDEX_H] - zero_point) * scale);
+    const decoder::Tensor<T> output(output_);
 
-            if (!normalized) {
-                x /= img_.width;
-                y /= img_.height;
-                w /= img_.width;
-                h /= img_.height;
-            }
+    bool normalized;
+    if constexpr (std::is_floating_point_v<T>) {
+        normalized = output.data[0] < 1.0f;
+    } else {
+        normalized = output.scale < 0.1f;
+    }
+    const float score_scale = normalized ? 1.0f : 0.01f;
 
-            ma_bbox_t box{.x = MA_CLIP(x, 0, 1.0f), .y = MA_CLIP(y, 0, 1.0f), .w = MA_CLIP(w, 0, 1.0f), .h = MA_CLIP(h, 0, 1.0f), .score = score, .target = target};
+    // score > threshold in the raw domain
+    const auto score_threshold_raw = output.floor(threshold_score_ / score_scale);
 
-            results_.emplace_front(box);
-        }
-    } else if (output_.type == MA_TENSOR_TYPE_F32) {
-        auto* data      = output_.data.f32;
-        bool normalized = data[0] < 1.0f;
-
-        for (decltype(num_record_) i = 0; i < num_record_; ++i) {
-            auto idx   = i * num_element_;
-            auto score = normalized ? data[idx + INDEX_S] : data[idx + INDEX_S] / 100.0f;
-
-            if (score <= threshold_score_)
-                continue;
-
-            float max_class = -1.0f;
-            int target      = 0;
-            for (decltype(num_class_) t = 0; t < num_class_; ++t) {
-                if (max_class < data[idx + INDEX_T + t]) {
-                    max_class = data[idx + INDEX_T + t];
-                    target    = t;
-                }
-            }
+    for (decltype(num_record_) i = 0; i < num_record_; ++i) {
+        auto idx = i * num_element_;
 
-            float x = data[idx + INDEX_X];
-            float y = data[idx + INDEX_Y];
-            float w = data[idx + INDEX_W];
-            float h = data[idx + INDEX_H];
+        const auto score_raw = output.raw(idx + INDEX_S);
+        if (score_raw <= score_threshold_raw) [[likely]]
+            continue;
 
-            if (!normalized) {
-                x /= img_.width;
-                y /= img_.height;
-                w /= img_.width;
-                h /= img_.height;
-            }
+        auto max_class = std::numeric_limits<typename decoder::Tensor<T>::raw_t>::lowest();
+        int target     = std::max(decoder::argmax(output.data + idx + INDEX_T, num_class_, max_class), 0);
 
-            ma_bbox_t box{.x = MA_CLIP(x, 0, 1.0f), .y = MA_CLIP(y, 0, 1.0f), .w = MA_CLIP(w, 0, 1.0f), .h = MA_CLIP(h, 0, 1.0f), .score = score, .target = target};
+        float x = output.value(idx + INDEX_X);
+        float y = output.value(idx + INDEX_Y);
+        float w = output.value(idx + INDEX_W);
+        float h = output.value(idx + INDEX_H);
 
-            results_.emplace_front(box);
+        if (!normalized) {
+            x /= img_.width;
+            y /= img_.height;
+            w /= img_.width;
+            h /= img_.height;
         }
-    } else {
-        return MA_ENOTSUP;
-    }
 
-    ma::utils::nms(results_, threshold_nms_, threshold_score_, false, false);
+        candidates_.push(MA_CLIP(x, 0, 1.0f), MA_CLIP(y, 0, 1.0f), MA_CLIP(w, 0, 1.0f), MA_CLIP(h, 0, 1.0f), output.dequantize(score_raw) * score_scale, target);
+    }
 
-    results_.sort([](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
+    candidates_.emit<decoder::Activation::Linear>(results_, threshold_nms_, false);
 
     return MA_OK;
 }
 
+ma_err_t YoloV5::generalPostProcess() {
+    switch (output_.type) {
+        case MA_TENSOR_TYPE_S8:
+            return decode<int8_t>();
+        case MA_TENSOR_TYPE_F32:
+            return decode<float>();
+        default:
+            return MA_ENOTSUP;
+    }
+}
+
 ma_err_t YoloV5::nmsPostProcess() {
 #if MA_USE_ENGINE_HAILO
 
@@ -260,7 +230,7 @@ ma_err_t YoloV5::nmsPostProcess() {
                     res.w = MA_CLIP(res.w, 0, 1.0f);
                     res.h = MA_CLIP(res.h, 0, 1.0f);
 
-                    results_.emplace_front(res);
+                    results_.emplace_back(res);
                 }
             }
         } break;
@@ -299,7 +269,7 @@ ma_err_t YoloV5::nmsPostProcess() {
                     res.w = MA_CLIP(res.w, 0, 1.0f);
                     res.h = MA_CLIP(res.h, 0, 1.0f);
 
-                    results_.emplace_front(res);
+                    results_.emplace_back(res);
                 }
             }
         } break;
@@ -310,7 +280,7 @@ ma_err_t YoloV5::nmsPostProcess() {
 
     ma::utils::nms(results_, threshold_nms_, threshold_score_, false, false);
 
-    results_.sort([](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
+    std::stable_sort(results_.begin(), results_.end(), [](const ma_bbox_t& a, const ma_bbox_t& b) { return a.x < b.x; });
 
     return MA_OK;
 #else
@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "ma_model_decoder.h"
 #include "ma_model_detector.h"
 
 namespace ma::model {
@@ -21,6 +22,9 @@ private:
         INDEX_S = 4,
         INDEX_T = 5,
     };
+    decoder::Candidates candidates_;
+
+    template <typename T> ma_err_t decode();
 
 protected:
     ma_err_t postprocess() override;
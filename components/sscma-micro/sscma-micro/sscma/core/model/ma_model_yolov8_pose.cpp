@@ -203,7 +203,8 @@ ma_err_t YoloV8Pose::postProcessI8() {
 
     const float score_threshold_non_sigmoid = ma::math::inverseSigmoid(score_threshold);
 
-    std::forward_list<ma_bbox_ext_t> multi_level_bboxes;
+    auto& multi_level_bboxes = candidates_;
+    multi_level_bboxes.clear();
 
     const auto anchor_matrix_size = anchor_matrix_.size();
 
@@ -281,7 +282,7 @@ ma_err_t YoloV8Pose::postProcessI8() {
             bbox_ext.level  = i;
             bbox_ext.index  = j;
 
-            multi_level_bboxes.emplace_front(std::move(bbox_ext));
+            multi_level_bboxes.emplace_back(std::move(bbox_ext));
         }
     }
 
@@ -317,7 +318,7 @@ ma_err_t YoloV8Pose::postProcessI8() {
         keypoint.box = {.x = bbox.x, .y = bbox.y, .w = bbox.w, .h = bbox.h, .score = bbox.score, .target = bbox.target};
         keypoint.pts = n_keypoint;
 
-        results_.emplace_front(std::move(keypoint));
+        results_.emplace_back(std::move(keypoint));
     }
 
     return MA_OK;
@@ -338,7 +339,8 @@ ma_err_t YoloV8Pose::postProcessF32() {
 
     const float score_threshold_non_sigmoid = ma::math::inverseSigmoid(score_threshold);
 
-    std::forward_list<ma_bbox_ext_t> multi_level_bboxes;
+    auto& multi_level_bboxes = candidates_;
+    multi_level_bboxes.clear();
 
     const auto anchor_matrix_size = anchor_matrix_.size();
 
@@ -412,7 +414,7 @@ ma_err_t YoloV8Pose::postProcessF32() {
             bbox_ext.level  = i;
             bbox_ext.index  = j;
 
-            multi_level_bboxes.emplace_front(std::move(bbox_ext));
+            multi_level_bboxes.emplace_back(std::move(bbox_ext));
         }
     }
 
@@ -448,7 +450,7 @@ ma_err_t YoloV8Pose::postProcessF32() {
         keypoint.box = {.x = bbox.x, .y = bbox.y, .w = bbox.w, .h = bbox.h, .score = bbox.score, .target = bbox.target};
         keypoint.pts = n_keypoint;
 
-        results_.empalce_front(std::move(keypoint));
+        results_.emplace_back(std::move(keypoint));
     }
 
     return MA_OK;
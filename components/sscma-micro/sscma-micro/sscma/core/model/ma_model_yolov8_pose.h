@@ -24,6 +24,8 @@ class YoloV8Pose : public PoseDetector {
     size_t output_bboxes_ids_[anchor_variants_];
     size_t output_keypoints_id_;
 
+    std::vector<ma_bbox_ext_t> candidates_;  // reused between frames
+
    protected:
     ma_err_t postprocess() override;
 
@@ -238,7 +238,7 @@ static decltype(auto) decodeBoxesAndKeypoints(const std::vector<ma_tensor_t>& ra
                                               float score_threshold) {
 
     int class_index = 0;
-    std::forward_list<ma_keypoint3f_t> decodings;
+    std::vector<ma_keypoint3f_t> decodings;
 
     int instance_index = 0;
     float confidence   = 0.0;
@@ -338,7 +338,7 @@ static decltype(auto) decodeBoxesAndKeypoints(const std::vector<ma_tensor_t>& ra
                 kp.pts.push_back(pt);
             }
 
-            decodings.push_front(std::move(kp));
+            decodings.push_back(std::move(kp));
         }
     }
 
@@ -424,7 +424,7 @@ ma_err_t YoloV8SegHailo::postprocess() {
             }
         } 
 
-        results_.emplace_front(std::move(segm));
+        results_.emplace_back(std::move(segm));
     }
 
     return MA_OK;
@@ -0,0 +1,344 @@
+#include "ma_mask.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace ma::utils {
+
+MaskAssembler::Roi MaskAssembler::roi(const ma_bbox_t& box, int height, int width) {
+    Roi roi;
+    roi.x1 = std::clamp(static_cast<int>((box.x - box.w / 2) * width), 0, width);
+    roi.y1 = std::clamp(static_cast<int>((box.y - box.h / 2) * height), 0, height);
+    roi.x2 = std::clamp(static_cast<int>((box.x + box.w / 2) * width), roi.x1, width);
+    roi.y2 = std::clamp(static_cast<int>((box.y + box.h / 2) * height), roi.y1, height);
+    return roi;
+}
+
+void MaskAssembler::assemble(const float* protos, int num_protos, int height, int width, const float* coeffs, const Roi* rois, size_t num, float threshold, uint8_t* const* masks) {
+    if (num == 0) {
+        return;
+    }
+
+    const size_t plane = static_cast<size_t>(height) * width;
+
+    acc_.resize(num * width);
+    active_.reserve(num);
+
+    for (int y = 0; y < height; ++y) {
+        active_.clear();
+        for (size_t n = 0; n < num; ++n) {
+            if (y >= rois[n].y1 && y < rois[n].y2 && rois[n].x2 > rois[n].x1) {
+                active_.push_back(n);
+                std::fill_n(acc_.data() + n * width + rois[n].x1, rois[n].x2 - rois[n].x1, 0.0f);
+            }
+        }
+        if (active_.empty()) [[likely]] {
+            continue;
+        }
+
+        // [active x num_protos] x [num_protos x roi] on this row
+        const float* row = protos + static_cast<size_t>(y) * width;
+        for (int k = 0; k < num_protos; ++k) {
+            const float* proto = row + k * plane;
+            for (size_t n : active_) {
+                const float c = coeffs[n * num_protos + k];
+                float* acc    = acc_.data() + n * width;
+                for (int x = rois[n].x1; x < rois[n].x2; ++x) {
+                    acc[x] += c * proto[x];
+                }
+            }
+        }
+
+        for (size_t n : active_) {
+            const float* acc = acc_.data() + n * width;
+            uint8_t* bits    = masks[n] + static_cast<size_t>(y) * width / 8;
+            for (int x = rois[n].x1; x < rois[n].x2; ++x) {
+                if (acc[x] > threshold) {
+                    bits[x >> 3] |= 1 << (x & 7);
+                }
+            }
+        }
+    }
+}
+
+// byte -> 8 pixels of 0 or 1, LSB first
+static const std::array<std::array<uint8_t, 8>, 256> s_unpack = [] {
+    std::array<std::array<uint8_t, 8>, 256> table{};
+    for (int b = 0; b < 256; ++b) {
+        for (int i = 0; i < 8; ++i) {
+            table[b][i] = (b >> i) & 1;
+        }
+    }
+    return table;
+}();
+
+// label map values, bit 0 set for the mask pixels
+enum : uint8_t {
+    kHole       = 0,
+    kMask       = 1,
+    kBackground = 2,
+    kTraced     = 3,
+};
+
+void MaskTracer::unpack(const uint8_t* bits, int width, int height, uint8_t* dst, size_t stride, uint8_t value) {
+    const int bytes = width / 8;
+    const int tail  = width % 8;
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = bits + static_cast<size_t>(y) * width / 8;
+        uint8_t* out       = dst + y * stride;
+        for (int b = 0; b < bytes; ++b) {
+            // 0/1 bytes times value cannot carry into the next pixel
+            uint64_t pixels;
+            std::memcpy(&pixels, s_unpack[row[b]].data(), 8);
+            pixels *= value;
+            std::memcpy(out + b * 8, &pixels, 8);
+        }
+        for (int x = bytes * 8; x < bytes * 8 + tail; ++x) {
+            out[x] = (row[x >> 3] & (1 << (x & 7))) ? value : 0;
+        }
+    }
+}
+
+void MaskTracer::fill(int width, int height) {
+    // scanline fill of the 4-connected zeros reachable from the frame
+    const int stride = width + 2;
+    const int rows   = height + 2;
+
+    stack_.clear();
+    stack_.push_back(0);
+
+    while (!stack_.empty()) {
+        int p = stack_.back();
+        stack_.pop_back();
+        if (map_[p] != kHole) {
+            continue;
+        }
+
+        int y  = p / stride;
+        int x1 = p % stride;
+        int x2 = x1;
+        while (x1 > 0 && map_[y * stride + x1 - 1] == kHole) {
+            --x1;
+        }
+        while (x2 < stride - 1 && map_[y * stride + x2 + 1] == kHole) {
+            ++x2;
+        }
+        std::fill(map_.begin() + y * stride + x1, map_.begin() + y * stride + x2 + 1, kBackground);
+
+        for (int ny : {y - 1, y + 1}) {
+            if (ny < 0 || ny >= rows) {
+                continue;
+            }
+            const uint8_t* row = map_.data() + ny * stride;
+            for (int x = x1; x <= x2; ++x) {
+                if (row[x] == kHole && (x == x1 || row[x - 1] != kHole)) {
+                    stack_.push_back(ny * stride + x);
+                }
+            }
+        }
+    }
+}
+
+void MaskTracer::follow(int start, int width, std::vector<Point>& contour) {
+    const int stride = width + 2;
+    // E, NE, N, NW, W, SW, S, SE
+    const int deltas[8]  = {1, -stride + 1, -stride, -stride - 1, -1, stride - 1, stride, stride + 1};
+    const int8_t dx[8]   = {1, 1, 0, -1, -1, -1, 0, 1};
+    const int8_t dy[8]   = {0, -1, -1, -1, 0, 1, 1, 1};
+    uint8_t* map         = map_.data();
+
+    Point pt = {static_cast<int16_t>(start % stride - 1), static_cast<int16_t>(start / stride - 1)};
+
+    // first neighbour clockwise from the background pixel on the left
+    int s = 4;
+    do {
+        s = (s - 1) & 7;
+    } while (!(map[start + deltas[s]] & 1) && s != 4);
+
+    if (s == 4) {
+        map[start] = kTraced;
+        contour.push_back(pt);
+        return;
+    }
+
+    const int second = start + deltas[s];
+    int p            = start;
+    int prev         = s ^ 4;
+
+    for (;;) {
+        // next mask pixel counter-clockwise from the one we came from
+        int from = s;
+        int next = p;
+        for (int k = 1; k <= 8; ++k) {
+            s    = (from + k) & 7;
+            next = p + deltas[s];
+            if (map[next] & 1) {
+                break;
+            }
+        }
+        map[p] = kTraced;
+
+        if (s != prev) {
+            contour.push_back(pt);
+            prev = s;
+        }
+        pt.x += dx[s];
+        pt.y += dy[s];
+
+        if (next == start && p == second) {
+            break;
+        }
+        p = next;
+        s = (s + 4) & 7;
+    }
+}
+
+void MaskTracer::simplify(std::vector<Point>& contour, float epsilon) {
+    const size_t n = contour.size();
+    if (n <= 3 || epsilon <= 0.0f) {
+        return;
+    }
+
+    // closed polygon: split at the point farthest from the first one, then Douglas-Peucker both halves
+    size_t far = 0;
+    int dmax   = -1;
+    for (size_t i = 1; i < n; ++i) {
+        int dx = contour[i].x - contour[0].x;
+        int dy = contour[i].y - contour[0].y;
+        if (dx * dx + dy * dy > dmax) {
+            dmax = dx * dx + dy * dy;
+            far  = i;
+        }
+    }
+
+    keep_.assign(n, 0);
+    keep_[0]   = 1;
+    keep_[far] = 1;
+
+    const float eps2 = epsilon * epsilon;
+
+    stack_.clear();
+    stack_.push_back(0);
+    stack_.push_back(static_cast<int>(far));
+    stack_.push_back(static_cast<int>(far));
+    stack_.push_back(static_cast<int>(n));
+
+    while (!stack_.empty()) {
+        size_t last  = stack_.back();
+        stack_.pop_back();
+        size_t first = stack_.back();
+        stack_.pop_back();
+
+        const Point& a = contour[first];
+        const Point& b = contour[last % n];
+        float ex       = b.x - a.x;
+        float ey       = b.y - a.y;
+        float len2     = ex * ex + ey * ey;
+
+        size_t index = 0;
+        float best   = 0.0f;
+        for (size_t i = first + 1; i < last; ++i) {
+            float px = contour[i].x - a.x;
+            float py = contour[i].y - a.y;
+            float d2;
+            if (len2 > 0.0f) {
+                float cross = px * ey - py * ex;
+                d2          = cross * cross / len2;
+            } else {
+                d2 = px * px + py * py;
+            }
+            if (d2 > best) {
+                best  = d2;
+                index = i;
+            }
+        }
+
+        if (best > eps2) {
+            keep_[index] = 1;
+            stack_.push_back(static_cast<int>(first));
+            stack_.push_back(static_cast<int>(index));
+            stack_.push_back(static_cast<int>(index));
+            stack_.push_back(static_cast<int>(last));
+        }
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (keep_[i]) {
+            contour[out++] = contour[i];
+        }
+    }
+    contour.resize(out);
+}
+
+size_t MaskTracer::trace(const uint8_t* bits, int width, int height, float epsilon) {
+    for (auto& contour : contours_) {
+        contour.clear();
+        spare_.push_back(std::move(contour));
+    }
+    contours_.clear();
+
+    if (bits == nullptr || width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    const int stride = width + 2;
+
+    map_.assign(static_cast<size_t>(stride) * (height + 2), kHole);
+    unpack(bits, width, height, map_.data() + stride + 1, stride, kMask);
+    fill(width, height);
+
+    for (int y = 1; y <= height; ++y) {
+        const uint8_t* row = map_.data() + y * stride;
+        for (int x = 1; x <= width; ++x) {
+            // untraced mask pixel next to the outer background: start of an external border
+            if (row[x] != kMask || row[x - 1] != kBackground) {
+                continue;
+            }
+            if (spare_.empty()) {
+                contours_.emplace_back();
+            } else {
+                contours_.push_back(std::move(spare_.back()));
+                spare_.pop_back();
+            }
+            follow(y * stride + x, width, contours_.back());
+            simplify(contours_.back(), epsilon);
+        }
+    }
+
+    return contours_.size();
+}
+
+const std::vector<std::vector<MaskTracer::Point>>& MaskTracer::contours() const {
+    return contours_;
+}
+
+bool MaskTracer::largest(const uint8_t* bits, int width, int height, float sx, float sy, float epsilon, std::vector<uint16_t>& xy) {
+    if (trace(bits, width, height) == 0) {
+        return false;
+    }
+
+    // same pick as the findContours path: the contour with the most points, findContours lists
+    // them in reverse raster order so the last one traced wins a tie
+    auto best = contours_.begin();
+    for (auto it = std::next(best); it != contours_.end(); ++it) {
+        if (it->size() >= best->size()) {
+            best = it;
+        }
+    }
+
+    simplify(*best, epsilon);
+
+    xy.reserve(xy.size() + best->size() * 2);
+    for (const auto& pt : *best) {
+        xy.push_back(static_cast<uint16_t>(pt.x * sx));
+        xy.push_back(static_cast<uint16_t>(pt.y * sy));
+    }
+
+    return true;
+}
+
+}  // namespace ma::utils
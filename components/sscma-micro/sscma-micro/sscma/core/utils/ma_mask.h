@@ -0,0 +1,88 @@
+#ifndef _MA_MASK_H_
+#define _MA_MASK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../ma_types.h"
+
+namespace ma::utils {
+
+/**
+ * Instance mask assembly for prototype based segmentation heads (YOLOv8-seg, YOLO11-seg).
+ *
+ * The mask of an instance is the product of its coefficients with the prototypes, thresholded
+ * in the logit domain. Only the pixels inside the ROI of each instance are computed: the
+ * prototypes are walked row by row and every row is multiplied with the coefficients of all
+ * the instances covering it, so each prototype row is read once per frame rather than once
+ * per instance. Masks are written bit-packed (LSB first, width must be a multiple of 8).
+ */
+class MaskAssembler {
+public:
+    struct Roi {
+        int x1;
+        int y1;
+        int x2;
+        int y2;
+    };
+
+    MaskAssembler()  = default;
+    ~MaskAssembler() = default;
+
+    // protos: [num_protos][height][width], coeffs: [num][num_protos], masks: num buffers of width * height / 8 bytes, zeroed
+    void assemble(const float* protos, int num_protos, int height, int width, const float* coeffs, const Roi* rois, size_t num, float threshold, uint8_t* const* masks);
+
+    // ROI in prototype pixels of a normalized center/size box, clipped to the prototype
+    static Roi roi(const ma_bbox_t& box, int height, int width);
+
+private:
+    std::vector<float> acc_;
+    std::vector<size_t> active_;
+};
+
+/**
+ * Contours of bit-packed masks (LSB first, rows of width / 8 bytes).
+ *
+ * The mask is expanded a byte at a time through a 256 entry table into a label map with a one
+ * pixel frame, the background reachable from the frame is filled, and the external borders are
+ * followed with the Suzuki-Abe rule, keeping only the points where the chain changes direction
+ * (the same points as cv::findContours with RETR_EXTERNAL and CHAIN_APPROX_SIMPLE). Buffers are
+ * kept between calls, so a tracer owned by the caller does not allocate once warmed up.
+ */
+class MaskTracer {
+public:
+    struct Point {
+        int16_t x;
+        int16_t y;
+    };
+
+    MaskTracer()  = default;
+    ~MaskTracer() = default;
+
+    // one byte per pixel, 0 or value, rows of stride bytes
+    static void unpack(const uint8_t* bits, int width, int height, uint8_t* dst, size_t stride, uint8_t value = 255);
+
+    // external contours in mask pixels, simplified with Douglas-Peucker when epsilon > 0, returns their count
+    size_t trace(const uint8_t* bits, int width, int height, float epsilon = 0.0f);
+    const std::vector<std::vector<Point>>& contours() const;
+
+    // contour with the most points before simplification, simplified, scaled by (sx, sy) and appended
+    // to xy as x, y pairs
+    bool largest(const uint8_t* bits, int width, int height, float sx, float sy, float epsilon, std::vector<uint16_t>& xy);
+
+private:
+    void fill(int width, int height);
+    void follow(int start, int width, std::vector<Point>& contour);
+    void simplify(std::vector<Point>& contour, float epsilon);
+
+    std::vector<uint8_t> map_;
+    std::vector<int> stack_;
+    std::vector<std::vector<Point>> contours_;
+    std::vector<std::vector<Point>> spare_;
+    std::vector<uint8_t> keep_;
+};
+
+}  // namespace ma::utils
+
+#endif  // _MA_MASK_H_
@@ -14,7 +14,8 @@ static constexpr void nms_impl(Container& bboxes, float threshold_iou, float thr
     if constexpr (std::is_same_v<Container, std::forward_list<T>>) {
         bboxes.sort([](const auto& box1, const auto& box2) { return box1.score > box2.score; });
     } else {
-        std::sort(bboxes.begin(), bboxes.end(), [](const auto& box1, const auto& box2) { return box1.score > box2.score; });
+        // stable like forward_list::sort, so ties keep the decoder order
+        std::stable_sort(bboxes.begin(), bboxes.end(), [](const auto& box1, const auto& box2) { return box1.score > box2.score; });
     }
 
     for (auto it = bboxes.begin(); it != bboxes.end(); ++it) {
@@ -53,7 +54,8 @@ void nms(std::forward_list<ma_bbox_ext_t>& bboxes, float threshold_iou, float th
     nms_impl(bboxes, threshold_iou, threshold_score, soft_nms, multi_target);
 }
 
-void nms(std::forward_list<ma_keypoint3f_t>& decodings, const float iou_thr, bool should_nms_cross_classes) {
+template <typename Container>
+static void nms_keypoint_impl(Container& decodings, const float iou_thr, bool should_nms_cross_classes) {
     for (
         auto it = decodings.begin(); it != decodings.end(); ++it) {
         if (it->box.score != 0.0f) {
@@ -68,7 +70,27 @@ void nms(std::forward_list<ma_keypoint3f_t>& decodings, const float iou_thr, boo
             }
         }
     }
-    decodings.remove_if([](const auto& box) { return box.box.score == 0.0f; });
+    if constexpr (std::is_same_v<Container, std::forward_list<ma_keypoint3f_t>>) {
+        decodings.remove_if([](const auto& box) { return box.box.score == 0.0f; });
+    } else {
+        decodings.erase(std::remove_if(decodings.begin(), decodings.end(), [](const auto& box) { return box.box.score == 0.0f; }), decodings.end());
+    }
+}
+
+void nms(std::forward_list<ma_keypoint3f_t>& decodings, const float iou_thr, bool should_nms_cross_classes) {
+    nms_keypoint_impl(decodings, iou_thr, should_nms_cross_classes);
+}
+
+void nms(std::vector<ma_bbox_t>& bboxes, float threshold_iou, float threshold_score, bool soft_nms, bool multi_target) {
+    nms_impl(bboxes, threshold_iou, threshold_score, soft_nms, multi_target);
+}
+
+void nms(std::vector<ma_bbox_ext_t>& bboxes, float threshold_iou, float threshold_score, bool soft_nms, bool multi_target) {
+    nms_impl(bboxes, threshold_iou, threshold_score, soft_nms, multi_target);
+}
+
+void nms(std::vector<ma_keypoint3f_t>& decodings, const float iou_thr, bool should_nms_cross_classes) {
+    nms_keypoint_impl(decodings, iou_thr, should_nms_cross_classes);
 }
 
 }  // namespace ma::utils
\ No newline at end of file
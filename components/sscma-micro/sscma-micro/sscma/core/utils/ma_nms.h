@@ -6,6 +6,7 @@
 #include <forward_list>
 #include <iterator>
 #include <type_traits>
+#include <vector>
 
 #include "../ma_types.h"
 
@@ -35,6 +36,13 @@ void nms(std::forward_list<ma_bbox_ext_t>& bboxes, float threshold_iou, float th
 
 void nms(std::forward_list<ma_keypoint3f_t>& decodings, const float iou_thr, bool should_nms_cross_classes);
 
+// in place on contiguous buffers, no allocation
+void nms(std::vector<ma_bbox_t>& bboxes, float threshold_iou, float threshold_score, bool soft_nms, bool multi_target);
+
+void nms(std::vector<ma_bbox_ext_t>& bboxes, float threshold_iou, float threshold_score, bool soft_nms, bool multi_target);
+
+void nms(std::vector<ma_keypoint3f_t>& decodings, const float iou_thr, bool should_nms_cross_classes);
+
 }  // namespace ma::utils
 
 #endif  // _MA_NMS_H_
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef _MA_SPAN_H_
+#define _MA_SPAN_H_
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace ma {
+
+// non-owning view over contiguous elements, valid until the owner modifies them
+template <typename T> class Span {
+   public:
+    using value_type     = T;
+    using iterator       = T*;
+    using const_iterator = const T*;
+
+    constexpr Span() noexcept : m_data(nullptr), m_size(0) {}
+    constexpr Span(T* data, size_t size) noexcept : m_data(data), m_size(size) {}
+    template <typename U, std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>, bool> = true>
+    Span(std::vector<U>& vector) noexcept : m_data(vector.data()), m_size(vector.size()) {}
+    template <typename U, std::enable_if_t<std::is_convertible_v<const U (*)[], T (*)[]>, bool> = true>
+    Span(const std::vector<U>& vector) noexcept : m_data(vector.data()), m_size(vector.size()) {}
+    template <typename U, std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>, bool> = true>
+    constexpr Span(const Span<U>& other) noexcept : m_data(other.data()), m_size(other.size()) {}
+
+    constexpr T* data() const noexcept { return m_data; }
+    constexpr size_t size() const noexcept { return m_size; }
+    constexpr bool empty() const noexcept { return m_size == 0; }
+
+    constexpr T& operator[](size_t index) const noexcept { return m_data[index]; }
+    constexpr T& front() const noexcept { return m_data[0]; }
+    constexpr T& back() const noexcept { return m_data[m_size - 1]; }
+
+    constexpr T* begin() const noexcept { return m_data; }
+    constexpr T* end() const noexcept { return m_data + m_size; }
+
+   private:
+    T* m_data;
+    size_t m_size;
+};
+
+}  // namespace ma
+
+#endif  // _MA_SPAN_H_
@@ -151,6 +151,7 @@ public:
 
     bool fetch(void** msg, ma_tick_t timeout = Tick::waitForever);
     bool post(void* msg, ma_tick_t timeout = Tick::waitForever);
+    size_t count();
 
 private:
     MessageBox(const MessageBox&)            = delete;
@@ -298,6 +298,13 @@ bool MessageBox::post(void* msg, ma_tick_t timeout) {
     return true;
 }
 
+size_t MessageBox::count() {
+    if (xPortIsInsideInterrupt()) {
+        return uxQueueMessagesWaitingFromISR(m_mbox);
+    }
+    return uxQueueMessagesWaiting(m_mbox);
+}
+
 }  // namespace ma
 
 #endif
\ No newline at end of file
@@ -417,6 +417,11 @@ bool MessageBox::post(void* msg, ma_tick_t timeout) {
     return true;
 }
 
+size_t MessageBox::count() {
+    Guard guard(m_mutex);
+    return m_mbox.count;
+}
+
 // Timer::Timer(uint32_t ms, void (*fn)(ma_timer_t*, void*), void* arg, bool oneshot) noexcept {
 //     pthread_condattr_t cattr;
 //     pthread_condattr_init(&cattr);
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "core/ma_common.h"
+#include "core/utils/ma_span.hpp"
 #include "porting/ma_sensor.h"
 
 namespace ma {
@@ -256,6 +257,38 @@ public:
      */
     virtual ma_err_t write(const std::forward_list<ma_keypoint3f_t>& value) = 0;
 
+    /*!
+     * @brief Encoder type for write Span<const ma_class_t> value, without copying the results.
+     *
+     * @param[in] value Span<const ma_class_t> typed value to write.
+     * @retval MA_OK on success
+     */
+    virtual ma_err_t write(Span<const ma_class_t> value) = 0;
+
+    /*!
+     * @brief Encoder type for write Span<const ma_point_t> value, without copying the results.
+     *
+     * @param[in] value Span<const ma_point_t> typed value to write.
+     * @retval MA_OK on success
+     */
+    virtual ma_err_t write(Span<const ma_point_t> value) = 0;
+
+    /*!
+     * @brief Encoder type for write Span<const ma_bbox_t> value, without copying the results.
+     *
+     * @param[in] value Span<const ma_bbox_t> typed value to write.
+     * @retval MA_OK on success
+     */
+    virtual ma_err_t write(Span<const ma_bbox_t> value) = 0;
+
+    /*!
+     * @brief Encoder type for write Span<const ma_keypoint3f_t> value, without copying the results.
+     *
+     * @param[in] value Span<const ma_keypoint3f_t> typed value to write.
+     * @retval MA_OK on success
+     */
+    virtual ma_err_t write(Span<const ma_keypoint3f_t> value) = 0;
+
     /*!
      * @brief Encoder type for write std::forward_list<ma_model_t> value.
      *
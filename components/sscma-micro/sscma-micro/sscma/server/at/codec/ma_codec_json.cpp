@@ -291,7 +291,7 @@ ma_err_t EncoderJSON::write(ma_perf_t value) {
     return MA_OK;
 }
 
-ma_err_t EncoderJSON::write(const std::forward_list<ma_class_t>& value) {
+template <typename Range> ma_err_t EncoderJSON::writeClasses(const Range& value) {
     if (cJSON_GetObjectItem(m_data, "classes") != nullptr) {
         return MA_EEXIST;
     }
@@ -312,7 +312,15 @@ ma_err_t EncoderJSON::write(const std::forward_list<ma_class_t>& value) {
     return MA_OK;
 }
 
-ma_err_t EncoderJSON::write(const std::forward_list<ma_keypoint3f_t>& value) {
+ma_err_t EncoderJSON::write(const std::forward_list<ma_class_t>& value) {
+    return writeClasses(value);
+}
+
+ma_err_t EncoderJSON::write(Span<const ma_class_t> value) {
+    return writeClasses(value);
+}
+
+template <typename Range> ma_err_t EncoderJSON::writeKeypoints(const Range& value) {
     cJSON* array = cJSON_CreateArray();
     cJSON_ReplaceItemInObjectCaseSensitive(m_root, "keypoints", array);
     if (array == nullptr) {
@@ -352,6 +360,14 @@ ma_err_t EncoderJSON::write(const std::forward_list<ma_keypoint3f_t>& value) {
     return MA_OK;
 }
 
+ma_err_t EncoderJSON::write(const std::forward_list<ma_keypoint3f_t>& value) {
+    return writeKeypoints(value);
+}
+
+ma_err_t EncoderJSON::write(Span<const ma_keypoint3f_t> value) {
+    return writeKeypoints(value);
+}
+
 
 ma_err_t EncoderJSON::write(const in4_info_t& value) {
     if (cJSON_GetObjectItem(m_data, "in4_info") != nullptr) {
@@ -440,7 +456,7 @@ ma_err_t EncoderJSON::write(int algo_id, int cat, int input_from, int tscore, in
 }
 
 
-ma_err_t EncoderJSON::write(const std::forward_list<ma_point_t>& value) {
+template <typename Range> ma_err_t EncoderJSON::writePoints(const Range& value) {
 
     if (cJSON_GetObjectItem(m_data, "points") != nullptr) {
         return MA_EEXIST;
@@ -462,7 +478,15 @@ ma_err_t EncoderJSON::write(const std::forward_list<ma_point_t>& value) {
     }
     return MA_OK;
 }
-ma_err_t EncoderJSON::write(const std::forward_list<ma_bbox_t>& value) {
+
+ma_err_t EncoderJSON::write(const std::forward_list<ma_point_t>& value) {
+    return writePoints(value);
+}
+
+ma_err_t EncoderJSON::write(Span<const ma_point_t> value) {
+    return writePoints(value);
+}
+template <typename Range> ma_err_t EncoderJSON::writeBoxes(const Range& value) {
     if (cJSON_GetObjectItem(m_data, "boxes") != nullptr) {
         return MA_EEXIST;
     }
@@ -489,6 +513,14 @@ ma_err_t EncoderJSON::write(const std::forward_list<ma_bbox_t>& value) {
     return MA_OK;
 }
 
+ma_err_t EncoderJSON::write(const std::forward_list<ma_bbox_t>& value) {
+    return writeBoxes(value);
+}
+
+ma_err_t EncoderJSON::write(Span<const ma_bbox_t> value) {
+    return writeBoxes(value);
+}
+
 ma_err_t EncoderJSON::write(const std::vector<ma_model_t>& value) {
     cJSON* array = cJSON_AddArrayToObject(m_data, "models");
     if (array == nullptr) {
@@ -49,6 +49,11 @@ public:
     ma_err_t write(const std::forward_list<ma_bbox_t>& value) override;
     ma_err_t write(const std::forward_list<ma_keypoint3f_t>& value) override;
 
+    ma_err_t write(Span<const ma_class_t> value) override;
+    ma_err_t write(Span<const ma_point_t> value) override;
+    ma_err_t write(Span<const ma_bbox_t> value) override;
+    ma_err_t write(Span<const ma_keypoint3f_t> value) override;
+
     ma_err_t write(const std::vector<ma_model_t>& value) override;
 
 
@@ -73,6 +78,12 @@ public:
     const size_t size() const override;
 
 private:
+    // shared by the list and span writers
+    template <typename Range> ma_err_t writeClasses(const Range& value);
+    template <typename Range> ma_err_t writePoints(const Range& value);
+    template <typename Range> ma_err_t writeBoxes(const Range& value);
+    template <typename Range> ma_err_t writeKeypoints(const Range& value);
+
     cJSON* m_root;
     cJSON* m_data;
     Mutex m_mutex;
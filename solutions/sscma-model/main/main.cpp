@@ -1,4 +1,5 @@
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <numeric>
@@ -66,29 +67,111 @@ void drawMaskOnImage(int cls, cv::Mat& targetImage, const std::vector<uint8_t>&
         throw std::runtime_error("Mask data size is incorrect.");
     }
 
-    cv::Mat maskImage(maskHeight, maskWidth, CV_8UC1, cv::Scalar(0));
+    cv::Mat maskImage(maskHeight, maskWidth, CV_8UC1);
+    ma::utils::MaskTracer::unpack(maskData.data(), maskWidth, maskHeight, maskImage.data, maskImage.step);
 
-    for (int i = 0; i < maskHeight; ++i) {
-        for (int j = 0; j < maskWidth; ++j) {
-            if (maskData[i * maskWidth / 8 + j / 8] & (1 << (j % 8))) {
+    cv::Mat scaledMaskImage;
+    cv::resize(maskImage, scaledMaskImage, cv::Size(targetImage.cols, targetImage.rows), 0, 0, cv::INTER_LINEAR);
+
+    cv::Mat blended;
+    cv::addWeighted(targetImage, 1.0 - alpha, cv::Mat(targetImage.size(), targetImage.type(), ColorPalette::getColor(cls)), alpha, 0.0, blended);
+    blended.copyTo(targetImage, scaledMaskImage);
+}
+
+// previous contour path of the node: per pixel unpack, cv::findContours, longest contour
+static void legacyContour(const ma_segm2f_t& result, int width, int height, std::vector<uint16_t>& contour) {
+    cv::Mat maskImage(result.mask.height, result.mask.width, CV_8UC1, cv::Scalar(0));
+    for (int i = 0; i < result.mask.height; ++i) {
+        for (int j = 0; j < result.mask.width; ++j) {
+            if (result.mask.data[i * result.mask.width / 8 + j / 8] & (1 << (j % 8))) {
                 maskImage.at<uchar>(i, j) = 255;
             }
         }
     }
 
-    cv::Mat scaledMaskImage;
-    cv::resize(maskImage, scaledMaskImage, cv::Size(targetImage.cols, targetImage.rows), 0, 0, cv::INTER_LINEAR);
+    std::vector<std::vector<cv::Point>> contours;
+    std::vector<cv::Vec4i> hierarchy;
+    cv::findContours(maskImage, contours, hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    auto maxContour = std::max_element(contours.begin(), contours.end(), [](std::vector<cv::Point>& a, std::vector<cv::Point>& b) { return a.size() < b.size(); });
+    if (maxContour != contours.end()) {
+        float w_scale = static_cast<float>(width) / result.mask.width;
+        float h_scale = static_cast<float>(height) / result.mask.height;
+        for (auto& c : *maxContour) {
+            contour.push_back(static_cast<uint16_t>(c.x * w_scale));
+            contour.push_back(static_cast<uint16_t>(c.y * h_scale));
+        }
+    }
+}
 
-    for (int i = 0; i < scaledMaskImage.rows; ++i) {
-        for (int j = 0; j < scaledMaskImage.cols; ++j) {
-            cv::Vec3b& targetPixel = targetImage.at<cv::Vec3b>(i, j);
-            uchar maskPixel        = scaledMaskImage.at<uchar>(i, j);
-            if (maskPixel > 0) {
-                cv::Vec3b maskColor(ColorPalette::getColor(cls)[0], ColorPalette::getColor(cls)[1], ColorPalette::getColor(cls)[2]);
-                targetPixel = (1.0 - alpha) * targetPixel + alpha * maskColor;
+static void benchMasks(ma::Span<const ma_segm2f_t> results, int width, int height, int iterations) {
+    ma::utils::MaskTracer tracer;
+    std::vector<uint16_t> legacy, traced;
+    size_t masks = 0, mismatches = 0;
+
+    for (const auto& result : results) {
+        legacy.clear();
+        traced.clear();
+        legacyContour(result, width, height, legacy);
+        tracer.largest(result.mask.data.data(), result.mask.width, result.mask.height, static_cast<float>(width) / result.mask.width, static_cast<float>(height) / result.mask.height, 0.0f, traced);
+        mismatches += legacy != traced;
+        masks++;
+    }
+    if (masks == 0) {
+        MA_LOGW(TAG, "bench: no mask");
+        return;
+    }
+
+    auto measure = [&](auto&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < iterations; ++n) {
+            for (const auto& result : results) {
+                fn(result);
+            }
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / (iterations * masks);
+    };
+
+    cv::Mat unpacked(results.front().mask.height, results.front().mask.width, CV_8UC1);
+    double unpack_loop = measure([&](const ma_segm2f_t& result) {
+        for (int i = 0; i < result.mask.height; ++i) {
+            for (int j = 0; j < result.mask.width; ++j) {
+                unpacked.at<uchar>(i, j) = (result.mask.data[i * result.mask.width / 8 + j / 8] & (1 << (j % 8))) ? 255 : 0;
             }
         }
+    });
+    double unpack_lut = measure([&](const ma_segm2f_t& result) {
+        ma::utils::MaskTracer::unpack(result.mask.data.data(), result.mask.width, result.mask.height, unpacked.data, unpacked.step);
+    });
+    double contour_legacy = measure([&](const ma_segm2f_t& result) {
+        legacy.clear();
+        legacyContour(result, width, height, legacy);
+    });
+    double contour_traced = measure([&](const ma_segm2f_t& result) {
+        traced.clear();
+        tracer.largest(result.mask.data.data(), result.mask.width, result.mask.height, static_cast<float>(width) / result.mask.width, static_cast<float>(height) / result.mask.height, 0.0f, traced);
+    });
+    double contour_simplified = measure([&](const ma_segm2f_t& result) {
+        traced.clear();
+        tracer.largest(result.mask.data.data(), result.mask.width, result.mask.height, static_cast<float>(width) / result.mask.width, static_cast<float>(height) / result.mask.height, 1.0f, traced);
+    });
+
+    printf("bench: %zu masks %dx%d, %d iterations, %zu contour mismatches\n", masks, results.front().mask.width, results.front().mask.height, iterations, mismatches);
+    printf("  unpack   at<>: %8.2f us  lut: %8.2f us\n", unpack_loop, unpack_lut);
+    printf("  contour  findContours: %8.2f us  tracer: %8.2f us  tracer eps=1: %8.2f us\n", contour_legacy, contour_traced, contour_simplified);
+}
+
+// decoding of the output tensors left by the last inference, without the engine
+static void benchPostprocess(ma::Model* model, int iterations) {
+    model->replayPostprocess();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; ++n) {
+        model->replayPostprocess();
     }
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    printf("bench: %s postprocess, %d iterations: %8.2f us\n", model->getName(), iterations, elapsed / iterations);
 }
 
 int main(int argc, char** argv) {
@@ -96,10 +179,14 @@ int main(int argc, char** argv) {
     if (argc < 3) {
         printf("Usage:\n");
         printf("   %s cvimodel image.jpg image_detected.jpg\n", argv[0]);
+        printf("   %s cvimodel image.jpg image_detected.jpg --bench [iterations]\n", argv[0]);
         printf("ex: %s yolo11.cvimodel cat.jpg out.jpg \n", argv[0]);
         exit(-1);
     }
 
+    bool bench     = argc >= 5 && strcmp(argv[4], "--bench") == 0;
+    int iterations = argc >= 6 ? atoi(argv[5]) : 100;
+
     ma_err_t ret = MA_OK;
     auto* engine = new ma::engine::EngineCVI();
     ret          = engine->init();
@@ -152,7 +239,7 @@ int main(int argc, char** argv) {
         ma::model::Classifier* classifier = static_cast<ma::model::Classifier*>(model);
         classifier->setConfig(MA_MODEL_CFG_OPT_THRESHOLD, 0.1f);
         classifier->run(&img);
-        auto _results = classifier->getResults();
+        auto _results = classifier->getResultSpan();
         for (auto result : _results) {
             char content[100];
             sprintf(content, "%d(%.3f)", result.target, result.score);
@@ -162,7 +249,7 @@ int main(int argc, char** argv) {
     } else if (model->getOutputType() == MA_OUTPUT_TYPE_KEYPOINT) {
         ma::model::PoseDetector* detector = static_cast<ma::model::PoseDetector*>(model);
         detector->run(&img);
-        auto _results = detector->getResults();
+        auto _results = detector->getResultSpan();
         for (auto result : _results) {
             printf("x: %f, y: %f, w: %f, h: %f, score: %f target: %d\n", result.box.x, result.box.y, result.box.w, result.box.h, result.box.score, result.box.target);
             for (auto pt : result.pts) {
@@ -184,7 +271,7 @@ int main(int argc, char** argv) {
     } else if (model->getOutputType() == MA_OUTPUT_TYPE_SEGMENT) {
         ma::model::Segmentor* segmenter = static_cast<ma::model::Segmentor*>(model);
         segmenter->run(&img);
-        auto _results = segmenter->getResults();
+        auto _results = segmenter->getResultSpan();
         for (auto result : _results) {
             printf("x: %f, y: %f, w: %f, h: %f, score: %f target: %d\n", result.box.x, result.box.y, result.box.w, result.box.h, result.box.score, result.box.target);
             float x1 = (result.box.x - result.box.w / 2.0) * image.cols;
@@ -200,10 +287,13 @@ int main(int argc, char** argv) {
 
             drawMaskOnImage(result.box.target, image, result.mask.data, result.mask.width, result.mask.height);
         }
+        if (bench) {
+            benchMasks(_results, image.cols, image.rows, iterations);
+        }
     } else if (model->getOutputType() == MA_OUTPUT_TYPE_BBOX) {
         ma::model::Detector* detector = static_cast<ma::model::Detector*>(model);
         detector->run(&img);
-        auto _results = detector->getResults();
+        auto _results = detector->getResultSpan();
         for (auto result : _results) {
             // cx, cy, w, h
             float x1 = (result.x - result.w / 2.0) * image.cols;
@@ -224,6 +314,10 @@ int main(int argc, char** argv) {
     auto perf = model->getPerf();
     MA_LOGI(TAG, "pre: %ldms, infer: %ldms, post: %ldms", perf.preprocess, perf.inference, perf.postprocess);
 
+    if (bench) {
+        benchPostprocess(model, iterations);
+    }
+
     cv::cvtColor(image, image, cv::COLOR_RGB2BGR);
 
     if (argc >= 4) {
@@ -3,10 +3,12 @@
 #pragma message("OpenCV version: " CV_VERSION)
 #pragma message("OpenCV include path: " CVAUX_STR(OPENCV_INCLUDE_DIRS))
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <limits>    // Pour std::numeric_limits
 #include <optional>  // Ajout pour std::optional
+#include <sstream>
 #include <string>
 #include <syslog.h>
 #include <unistd.h>  // Pour read(STDIN_FILENO, ...)
@@ -29,6 +31,7 @@
 #include "node/label_mapper.h"  // S'assurer que le header est inclus
 #include "node/led.h"
 #include "node/server.h"
+#include "node/stats.h"
 
 // Inclure les en-têtes nécessaires pour la réinitialisation VPSS
 extern "C" {
@@ -62,6 +65,14 @@ struct AppArguments {
     bool show_version       = false;
     bool error              = false;
     std::string error_message;
+    // --bench
+    std::string bench_flow;
+    std::string bench_source;
+    std::string bench_stubs;
+    std::string bench_output;
+    int bench_duration = 30;
+    int bench_warmup   = 5;
+    bool bench_capture = false;
 };
 
 // Ajouter une fonction pour nettoyer et réinitialiser les ressources système
@@ -119,6 +130,10 @@ void shutdownApplication(NodeServer* server) {
     // Arrêter le serveur
     if (server) {
         server->stop();
+        // Écrire les réglages encore en attente
+        if (server->getStorage()) {
+            server->getStorage()->sync();
+        }
     }
 
     // Réinitialiser les ressources système
@@ -259,6 +274,13 @@ void show_help() {
               << "  -c, --config <file>  Configuration file, default is " << MA_NODE_CONFIG_FILE << "\\n"
               << "  --start              Start the service\\n"
               << "  --daemon             Run in daemon mode\\n"
+              << "  --bench <flow>       Run the nodes of a flow without MQTT and report their statistics as JSON\\n"
+              << "    --duration <s>     Measured time, default 30\\n"
+              << "    --warmup <s>       Time before the measure, default 5\\n"
+              << "    --source <path>    Replay pictures (directory or file) or an .h264 stream in the camera\\n"
+              << "    --stub <types>     Comma separated node types replaced by null stand-ins, e.g. model\\n"
+              << "    --capture          Keep requesting captures from the image preprocessors\\n"
+              << "    --output <file>    Write the report to a file instead of stdout\\n"
               << std::endl;
 }
 
@@ -294,6 +316,28 @@ AppArguments parseArguments(int argc, char** argv) {
         } else if (arg == "--daemon") {
             args.daemon        = true;
             args.start_service = true;  // --daemon implique --start
+        } else if (arg == "--capture") {
+            args.bench_capture = true;
+        } else if (arg == "--bench" || arg == "--source" || arg == "--stub" || arg == "--output" || arg == "--duration" || arg == "--warmup") {
+            if (i + 1 >= argc) {
+                args.error         = true;
+                args.error_message = "Error: Missing argument for " + arg;
+                return args;
+            }
+            std::string value = argv[++i];
+            if (arg == "--bench") {
+                args.bench_flow = value;
+            } else if (arg == "--source") {
+                args.bench_source = value;
+            } else if (arg == "--stub") {
+                args.bench_stubs = value;
+            } else if (arg == "--output") {
+                args.bench_output = value;
+            } else if (arg == "--duration") {
+                args.bench_duration = std::max(1, atoi(value.c_str()));
+            } else {
+                args.bench_warmup = std::max(0, atoi(value.c_str()));
+            }
         } else {
             args.error         = true;
             args.error_message = "Error: Unknown option " + arg;
@@ -302,7 +346,7 @@ AppArguments parseArguments(int argc, char** argv) {
     }
 
     // Si aucune action n'est spécifiée (start, help, version), afficher l'aide par défaut
-    if (!args.start_service && !args.show_help && !args.show_version) {
+    if (!args.start_service && args.bench_flow.empty() && !args.show_help && !args.show_version) {
         args.show_help = true;
     }
 
@@ -414,11 +458,13 @@ std::string selectLabelInteractive(const ma::node::LabelMapper& labelMapper) {
 }
 
 void performCapture(ImagePreProcessorNode* imagePreProcessor, std::string& selectedLabel) {
+    // la demande est datée avant la frame VPSS qu'elle déclenche, qui sinon serait jugée périmée
+    if (imagePreProcessor) {
+        imagePreProcessor->requestCapture(selectedLabel.c_str());
+    }
     capture_requested.store(true);
     // Thread::sleep(Tick::fromMilliseconds(2));
     if (imagePreProcessor) {
-        // enable frame capture from camera object
-        imagePreProcessor->requestCapture(selectedLabel.c_str());
         // MA_LOGI(TAG, "Capture Requested");
         while (!imagePreProcessor->isCaptureDone()) {
             Thread::sleep(Tick::fromMilliseconds(10));
@@ -426,6 +472,28 @@ void performCapture(ImagePreProcessorNode* imagePreProcessor, std::string& selec
     }
 }
 
+// Capture en rafale : le préprocesseur allume le flash lui-même au milieu de la rafale et garde la
+// frame la plus nette parmi les mieux exposées, à la place du délai fixe pre_capture_delay_ms
+void performBurstCapture(ImagePreProcessorNode* imagePreProcessor, std::string& selectedLabel, const FlashConfig& flashCfg) {
+    // la rafale est armée avant la première frame qu'elle déclenche, qui sinon serait libérée hors capture
+    if (imagePreProcessor) {
+        bool flash = flashCfg.enabled || flashCfg.dataset_mode_enabled;
+        imagePreProcessor->requestBurst(selectedLabel, flashCfg.burst_frames, flash, flashCfg.dataset_mode_enabled, flashCfg.flash_intensity);
+    }
+    capture_requested.store(true);
+    if (imagePreProcessor) {
+        // marge pour le traitement des frames retenues après l'échéance de la rafale
+        ma_tick_t deadline = imagePreProcessor->burstDeadline() + Tick::fromSeconds(10);
+        while (!imagePreProcessor->isCaptureDone()) {
+            if (Tick::current() >= deadline) {
+                MA_LOGW(TAG, "Burst capture did not complete, giving up");
+                break;
+            }
+            Thread::sleep(Tick::fromMilliseconds(10));
+        }
+    }
+}
+
 // Fonction pour exécuter la boucle principale de l'application
 void runMainLoop(const std::string& config_file, ImagePreProcessorNode* imagePreProcessor, AIConfig* aiCfg) {
     bool running                         = true;
@@ -443,6 +511,13 @@ void runMainLoop(const std::string& config_file, ImagePreProcessorNode* imagePre
             } else {
                 FlashConfig currentFlashConfig = readFlashConfigFromFile(config_file.c_str());
 
+                if (currentFlashConfig.burst_enabled) {
+                    MA_LOGI(TAG, "Burst capture of %d frames...", currentFlashConfig.burst_frames);
+                    performBurstCapture(imagePreProcessor, selectedLabel, currentFlashConfig);
+                    Thread::sleep(Tick::fromMilliseconds(100));
+                    continue;
+                }
+
                 if (currentFlashConfig.enabled || currentFlashConfig.dataset_mode_enabled) {
                     MA_LOGI(TAG, "Flash enabled for the capture...");
                     Led::controlLed("white", true, currentFlashConfig.flash_intensity);
@@ -544,6 +619,138 @@ void ApplyInferenceOnImages(ImagePreProcessorNode* imagePreProcessor, AIConfig*
     }
 }
 
+// Camera "source" replaying a recording, the kind is guessed from the path
+json benchmarkSource(const std::string& path) {
+    std::string ext = path.size() > 5 ? path.substr(path.size() - 5) : path;
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext == ".h264" || (ext.size() >= 4 && ext.substr(ext.size() - 4) == ".264")) {
+        return json::object({{"type", "h264"}, {"path", path}});
+    }
+    return json::object({{"type", "images"}, {"path", path}});
+}
+
+// Benchmark mode: the nodes of a flow are created like at startup but without MQTT (the server is
+// never started, the node responses are dropped), the types listed in --stub are replaced by null
+// stand-ins and the camera can replay a recording. After the warm-up the node statistics are reset,
+// then collected for the duration and written as JSON.
+int runBenchmark(const AppArguments& args) {
+    json flow;
+    std::ifstream flowifs(args.bench_flow.c_str());
+    try {
+        flowifs >> flow;
+    } catch (const json::parse_error& e) {
+        MA_LOGE(TAG, "Failed to parse %s: %s", args.bench_flow.c_str(), e.what());
+        return 1;
+    }
+    if (!flow.contains("nodes") || !flow["nodes"].is_array()) {
+        MA_LOGE(TAG, "No nodes in %s", args.bench_flow.c_str());
+        return 1;
+    }
+
+    std::vector<std::string> stubs;
+    std::stringstream ss(args.bench_stubs);
+    for (std::string type; std::getline(ss, type, ',');) {
+        if (!type.empty()) {
+            stubs.push_back(type);
+        }
+    }
+
+    NodeStats::enable(true);
+
+    StorageFile* config = new StorageFile();
+    config->init(args.config_file.c_str());
+
+    NodeServer server("bench");
+    server.setStorage(config);
+
+    std::vector<ImagePreProcessorNode*> preprocessors;
+    for (auto& elem : flow["nodes"]) {
+        if (!elem.contains("id") || !elem.contains("type")) {
+            continue;
+        }
+        std::string id   = elem["id"].get<std::string>();
+        std::string type = elem["type"].get<std::string>();
+
+        json cdata;
+        cdata["config"] = elem.contains("config") ? elem["config"] : json::object();
+        if (std::find(stubs.begin(), stubs.end(), type) != stubs.end()) {
+            type = "null";
+        }
+        if (type == "camera" && !args.bench_source.empty()) {
+            cdata["config"]["source"] = benchmarkSource(args.bench_source);
+        }
+        cdata["type"] = type;
+        if (elem.contains("deps")) {
+            cdata["dependencies"] = elem["deps"];
+        }
+
+        MA_TRY {
+            NodeFactory::create(id, type, cdata, &server);
+        }
+        MA_CATCH(Exception & e) {
+            MA_LOGE(TAG, "benchmark: failed to create %s(%s): %s", type.c_str(), id.c_str(), e.what());
+            NodeFactory::clear();
+            return 1;
+        }
+        if (auto nd = NodeFactory::find(id)) {
+            nd->onControl("enabled", json(true));
+            if (type == "image_preprocessor") {
+                preprocessors.push_back(static_cast<ImagePreProcessorNode*>(nd));
+            }
+        }
+    }
+
+    auto run = [&](int seconds, bool sample) {
+        ma_tick_t end = Tick::current() + Tick::fromSeconds(seconds);
+        while (Tick::current() < end) {
+            for (auto preprocessor : preprocessors) {
+                if (args.bench_capture && !preprocessor->isCaptureRequested()) {
+                    preprocessor->requestCapture("BENCH");
+                    capture_requested.store(true);
+                }
+            }
+            if (sample) {
+                NodeStats::sample();
+            }
+            Thread::sleep(Tick::fromMilliseconds(10));
+        }
+    };
+
+    MA_LOGI(TAG, "benchmark: %d s warm-up, %d s measure", args.bench_warmup, args.bench_duration);
+    run(args.bench_warmup, false);
+    NodeStats::reset();
+    ma_tick_t begin = Tick::current();
+    run(args.bench_duration, true);
+    double seconds = Tick::toMilliseconds(Tick::current() - begin) / 1000.0;
+
+    json report = json::object({
+        {"version", PROJECT_VERSION},
+        {"flow", args.bench_flow},
+        {"source", args.bench_source},
+        {"stubs", stubs},
+        {"duration", seconds},
+        {"nodes", NodeStats::report(seconds)},
+        {"rss_kb", ma::engine::MappedModel::currentRss()},
+        {"rss_peak_kb", ma::engine::MappedModel::peakRss()},
+    });
+
+    NodeFactory::clear();
+    NodeStats::enable(false);
+
+    if (args.bench_output.empty()) {
+        std::cout << report.dump(4) << std::endl;
+    } else {
+        std::ofstream out(args.bench_output.c_str());
+        out << report.dump(4) << std::endl;
+        if (!out.good()) {
+            MA_LOGE(TAG, "Failed to write %s", args.bench_output.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 // Fonction pour démarrer le service principal
 int startService(const std::string& config_file, bool daemon) {
     // Réinitialiser les ressources système au démarrage pour éviter les conflits
@@ -560,6 +767,8 @@ int startService(const std::string& config_file, bool daemon) {
     }
 
     StorageFile* config = new StorageFile();
+    // the nodes store their settings one key at a time, write them to flash in batches
+    config->setWriteBehind(Tick::fromMilliseconds(500));
     config->init(config_file.c_str());
 
     MA_LOGI(TAG, "starting the service...");
@@ -664,7 +873,9 @@ int main(int argc, char** argv) {
     }
 
     int exit_code = 0;
-    if (args.start_service) {
+    if (!args.bench_flow.empty()) {
+        exit_code = runBenchmark(args);
+    } else if (args.start_service) {
         exit_code = startService(args.config_file, args.daemon);
     }
     // Si start_service n'est pas vrai (et qu'il n'y a pas eu d'erreur ou de demande d'aide/version),
@@ -26,6 +26,19 @@ std::vector<::cv::Scalar> AIModelProcessor::ColorPalette::getPalette() {
 AIModelProcessor::AIModelProcessor(LabelMapper* labelMapper) : engine_(nullptr), model_(nullptr), detector_(nullptr), modelLoaded_(false), detectionThreshold_(0.5f), label_mapper_(labelMapper) {}
 
 AIModelProcessor::~AIModelProcessor() {
+    release();
+}
+
+void AIModelProcessor::release() {
+    if (engine_ != nullptr) {
+        // bloquant tant qu'une inférence de ce moteur est en file ou en cours sur le TPU
+        ma_err_t ret = ma::engine::EngineScheduler::getInstance()->detach(engine_);
+        if (ret != MA_OK) {
+            MA_LOGE(TAG, "Engine still in use (%d), not released", ret);
+            return;
+        }
+    }
+
     if (model_ != nullptr) {
         ma::ModelFactory::remove(model_);
         model_    = nullptr;
@@ -36,13 +49,12 @@ AIModelProcessor::~AIModelProcessor() {
         delete engine_;
         engine_ = nullptr;
     }
+    modelLoaded_ = false;
 }
 
 ma_err_t AIModelProcessor::initEngine() {
     Profiler p("AI: initEngine");
-    if (engine_ != nullptr) {
-        delete engine_;
-    }
+    release();
 
     engine_      = new ma::engine::EngineCVI();
     ma_err_t ret = engine_->init();
@@ -73,6 +85,9 @@ ma_err_t AIModelProcessor::loadModel(const std::string& modelPath) {
 
     MA_LOGI(TAG, "Model loaded successfully, model type: %d", model_->getType());
 
+    // Partager le TPU avec les autres modèles via l'ordonnanceur (priorité par défaut)
+    ma::engine::EngineScheduler::getInstance()->attach(engine_, modelPath);
+
     if (model_->getInputType() != MA_INPUT_TYPE_IMAGE) {
         MA_LOGE(TAG, "Model input type not supported, expected image input");
         return MA_FAILED;
@@ -193,11 +208,11 @@ ma_err_t AIModelProcessor::runDetection(::cv::Mat& image, bool convertRgbToBgr)
 
     // Exécuter la détection
     detector_->run(&img);
-    results_ = detector_->getResults();
+    auto detections = detector_->getResultSpan();
+    results_.assign(detections.begin(), detections.end());
 
     // Afficher les résultats dans la console
-    // Compter le nombre d'éléments dans la forward_list
-    size_t count = std::distance(results_.begin(), results_.end());
+    size_t count = results_.size();
     MA_LOGI(TAG, "Detection results: %zu objects found", count);
 
     for (const auto& result : results_) {
@@ -213,12 +228,7 @@ ma_err_t AIModelProcessor::runDetection(::cv::Mat& image, bool convertRgbToBgr)
 }
 
 std::vector<ma_bbox_t> AIModelProcessor::getDetectionResults() const {
-    // Convertir la forward_list en vector pour l'interface publique
-    std::vector<ma_bbox_t> resultVector;
-    for (const auto& bbox : results_) {
-        resultVector.push_back(bbox);
-    }
-    return resultVector;
+    return results_;
 }
 
 void AIModelProcessor::drawDetectionResults(::cv::Mat& image, bool convertBGR) {
@@ -1,6 +1,5 @@
 #pragma once
 #include "label_mapper.h"
-#include <forward_list>
 #include <opencv2/opencv.hpp>
 #include <sscma.h>
 #include <string>
@@ -43,10 +42,13 @@ private:
         static const std::vector<::cv::Scalar> palette;
     };
 
+    // Attend la fin des inférences en cours sur le moteur avant de libérer le modèle et le moteur
+    void release();
+
     ma::engine::EngineCVI* engine_;
     ma::Model* model_;
     ma::model::Detector* detector_;
-    std::forward_list<ma_bbox_t> results_;  // Modification de vector à forward_list
+    std::vector<ma_bbox_t> results_;  // Tampon contigu, capacité conservée d'une image à l'autre
     bool modelLoaded_;
     float detectionThreshold_;
 
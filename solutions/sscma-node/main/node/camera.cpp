@@ -1,8 +1,10 @@
 #include "camera.h"
+#include "camera_sim.h"
 #include "node/capture_flag.h"
 #include <alsa/asoundlib.h>  // Added ALSA header
 
 #include "profiler.h"
+#include "stats.h"
 
 namespace ma::node {
 
@@ -23,11 +25,17 @@ CameraNode::CameraNode(std::string id)
       frame_(60),
       thread_(nullptr),
       thread_audio_(nullptr),
-      transport_(nullptr) {
+      transport_(nullptr),
+      simulator_(nullptr) {
     for (int i = 0; i < CHN_MAX; i++) {
-        channels_[i].configured = false;
-        channels_[i].enabled    = false;
-        channels_[i].format     = MA_PIXEL_FORMAT_H264;
+        channels_[i].configured  = false;
+        channels_[i].enabled     = false;
+        channels_[i].format      = MA_PIXEL_FORMAT_H264;
+        channels_[i].crop_x      = 0;
+        channels_[i].crop_y      = 0;
+        channels_[i].crop_width  = 0;
+        channels_[i].crop_height = 0;
+        channels_[i].rotation    = 0;
     }
     channels_.shrink_to_fit();
 }
@@ -65,6 +73,8 @@ int CameraNode::vencCallback(void* pData, void* pArgs) {
         return CVI_SUCCESS;
     }
 
+    // the packs of a saved stream are stored back to back (see _Data_Save in venc.c), so the
+    // frames below reference them instead of copying
     VENC_STREAM_S* pstStream = (VENC_STREAM_S*)pData;
     VENC_PACK_S* ppack;
 
@@ -72,9 +82,8 @@ int CameraNode::vencCallback(void* pData, void* pArgs) {
         videoFrame* frame = nullptr;
         ppack             = &pstStream->pstPack[i];
         if (VencChn == CHN_H264 && isKeyFrame(ppack->DataType.enH264EType)) {
-            int cnt    = 0;
-            int offset = 0;
-            int size   = 0;
+            int cnt  = 0;
+            int size = 0;
             for (int j = i; j < pstStream->u32PackCount; j++) {
                 size += pstStream->pstPack[j].u32Len - pstStream->pstPack[j].u32Offset;
                 cnt++;
@@ -90,6 +99,11 @@ int CameraNode::vencCallback(void* pData, void* pArgs) {
                 i += 1;
                 cnt = 1;
             }
+            // img.data references pack i, the size must only cover the packs from there on
+            size = 0;
+            for (int j = i; j < i + cnt; j++) {
+                size += pstStream->pstPack[j].u32Len - pstStream->pstPack[j].u32Offset;
+            }
             frame                      = new videoFrame();
             frame->chn                 = VencChn;
             frame->timestamp           = Tick::current();
@@ -99,13 +113,12 @@ int CameraNode::vencCallback(void* pData, void* pArgs) {
             frame->img.size            = size;
             frame->img.key             = true;
             frame->img.physical        = false;
-            frame->img.data            = new uint8_t[size];
+            frame->img.data            = pstStream->pstPack[i].pu8Addr + pstStream->pstPack[i].u32Offset;
             frame->fps                 = channels_[VencChn].fps;
+            frame->stream              = pstStream;
             channels_[VencChn].dropped = false;
             for (int j = i; j < i + cnt; j++) {
-                memcpy(frame->img.data + offset, pstStream->pstPack[j].pu8Addr + pstStream->pstPack[j].u32Offset, pstStream->pstPack[j].u32Len - pstStream->pstPack[j].u32Offset);
-                frame->blocks.push_back({frame->img.data + offset, pstStream->pstPack[j].u32Len - pstStream->pstPack[j].u32Offset});
-                offset += pstStream->pstPack[j].u32Len - pstStream->pstPack[j].u32Offset;
+                frame->blocks.push_back({pstStream->pstPack[j].pu8Addr + pstStream->pstPack[j].u32Offset, pstStream->pstPack[j].u32Len - pstStream->pstPack[j].u32Offset});
             }
             i += (cnt - 1);
         } else {
@@ -121,19 +134,15 @@ int CameraNode::vencCallback(void* pData, void* pArgs) {
             frame->img.size     = ppack->u32Len - ppack->u32Offset;
             frame->img.key      = false;
             frame->img.physical = false;
-            frame->img.data     = new uint8_t[ppack->u32Len - ppack->u32Offset];
+            frame->img.data     = ppack->pu8Addr + ppack->u32Offset;
             frame->fps          = channels_[VencChn].fps;
+            frame->stream       = pstStream;
             frame->blocks.push_back({frame->img.data, ppack->u32Len - ppack->u32Offset});
-            memcpy(frame->img.data, ppack->pu8Addr + ppack->u32Offset, ppack->u32Len - ppack->u32Offset);
         }
         if (frame != nullptr) {
-            frame->ref(channels_[VencChn].msgboxes.size());
-            for (auto& msgbox : channels_[VencChn].msgboxes) {
-                if (!msgbox->post(frame, Tick::fromMilliseconds(static_cast<int>(1000.0 / channels_[VencChn].fps)))) {
-                    frame->release();
-                    channels_[VencChn].dropped = true;
-                }
-            }
+            // the stream is recycled once the last frame referencing it is released
+            app_ipcam_Venc_Stream_Ref(pstStream);
+            publish(VencChn, frame, Tick::fromMilliseconds(static_cast<int>(1000.0 / channels_[VencChn].fps)));
         }
     }
 
@@ -204,14 +213,34 @@ int CameraNode::vpssCallback(void* pData, void* pArgs) {
 
     frame->timestamp = Tick::current();
     frame->fps       = channels_[pstVencChnCfg->VencChn].fps;
-    frame->ref(channels_[pstVencChnCfg->VencChn].msgboxes.size());
-    for (auto& msgbox : channels_[pstVencChnCfg->VencChn].msgboxes) {
-        if (!msgbox->post(frame, Tick::fromMilliseconds(5))) {
+    publish(pstVencChnCfg->VencChn, frame, Tick::fromMilliseconds(5));
+    Thread::exitCritical();
+    return CVI_SUCCESS;
+}
+
+// hands a frame to the consumers of its channel, after a drop H.264 resumes at the next key frame
+void CameraNode::publish(int chn, videoFrame* frame, ma_tick_t timeout) {
+    if (!started_ || !enabled_ || channels_[chn].msgboxes.empty()) {
+        frame->release();
+        return;
+    }
+    if (chn == CHN_H264) {
+        if (frame->img.key) {
+            channels_[chn].dropped = false;
+        } else if (channels_[chn].dropped) {
             frame->release();
+            return;
+        }
+    }
+
+    frame->ref(channels_[chn].msgboxes.size());
+    for (auto& msgbox : channels_[chn].msgboxes) {
+        if (!msgbox->post(frame, timeout)) {
+            frame->release();
+            channels_[chn].dropped = true;
+            NodeStats::drop(msgbox);
         }
     }
-    Thread::exitCritical();
-    return CVI_SUCCESS;
 }
 
 int CameraNode::vencCallbackStub(void* pData, void* pArgs, void* pUserData) {
@@ -223,6 +252,12 @@ int CameraNode::vpssCallbackStub(void* pData, void* pArgs, void* pUserData) {
     return reinterpret_cast<CameraNode*>(pUserData)->vpssCallback(pData, pArgs);
 }
 
+void CameraNode::simulatorCallbackStub(void* user, int chn, videoFrame* frame, bool realtime) {
+    CameraNode* node = reinterpret_cast<CameraNode*>(user);
+    // unpaced replays wait for the consumers instead of dropping
+    node->publish(chn, frame, realtime ? Tick::fromMilliseconds(1000 / node->channels_[chn].fps) : Tick::fromSeconds(1));
+}
+
 void CameraNode::threadEntry() {
     videoFrame* frame = nullptr;
     ma_tick_t last    = Tick::current();
@@ -456,7 +491,15 @@ void CameraNode::configureDefaultChannels() {
 ma_err_t CameraNode::onCreate(const json& config) {
     Guard guard(mutex_);
 
-    if (initVideo() != 0) {
+    // a recorded source replaces the sensor, see camera_sim.h
+    if (config.contains("source")) {
+        simulator_ = new CameraSimulator();
+        if (simulator_->open(config["source"]) != MA_OK) {
+            delete simulator_;
+            simulator_ = nullptr;
+            MA_THROW(Exception(MA_EINVAL, "Invalid camera source"));
+        }
+    } else if (initVideo() != 0) {
         MA_THROW(Exception(MA_EIO, "Not found camera device"));
     }
 
@@ -510,6 +553,25 @@ ma_err_t CameraNode::onCreate(const json& config) {
     applyResolutionConfig(CHN_JPEG, config, "jpeg_resolution");
     applyResolutionConfig(CHN_RAW, config, "raw_resolution");
 
+    if (simulator_ != nullptr) {
+        for (int chn = 0; chn < CHN_AUDIO; chn++) {
+            if (!simulator_->provides(chn)) {
+                continue;
+            }
+            if (simulator_->width() > 0 && simulator_->height() > 0) {
+                channels_[chn].width  = simulator_->width();
+                channels_[chn].height = simulator_->height();
+            }
+            if (simulator_->fps() > 0) {
+                channels_[chn].fps = simulator_->fps();
+            }
+            if (chn == CHN_RAW) {
+                channels_[chn].format = simulator_->format();
+            }
+        }
+        audio_ = 0;
+    }
+
     // Déterminer le canal à attacher (par défaut RAW)
     int attach_channel = CHN_RAW;
     if (config.contains("attach_channel") && config["attach_channel"].is_string()) {
@@ -617,6 +679,11 @@ ma_err_t CameraNode::onDestroy() {
         thread_ = nullptr;
     }
 
+    if (simulator_ != nullptr) {
+        delete simulator_;
+        simulator_ = nullptr;
+    }
+
     if (transport_ != nullptr) {
         transport_->deInit();
         delete transport_;
@@ -652,46 +719,57 @@ ma_err_t CameraNode::onStart() {
         }
     }
 
-    if (light_ == 0) {
-        Led::controlLed("white", false);
-    } else {
-        Led::controlLed("white", true);
-    }
-
-    for (int i = 0; i < CHN_MAX; i++) {
-        if (i == CHN_AUDIO) {
-            continue;
-        }
-        video_ch_param_t param;
-        switch (channels_[i].format) {
-            case MA_PIXEL_FORMAT_JPEG:
-                param.format = VIDEO_FORMAT_JPEG;
-                break;
-            case MA_PIXEL_FORMAT_H264:
-                param.format = VIDEO_FORMAT_H264;
-                break;
-            case MA_PIXEL_FORMAT_H265:
-                param.format = VIDEO_FORMAT_H265;
-                break;
-            case MA_PIXEL_FORMAT_RGB888:
-                param.format = VIDEO_FORMAT_RGB888;
-                break;
-            case MA_PIXEL_FORMAT_YUV422:
-                param.format = VIDEO_FORMAT_NV21;
-                break;
-            default:
-                break;
+    if (simulator_ == nullptr) {
+        if (light_ == 0) {
+            Led::controlLed("white", false);
+        } else {
+            Led::controlLed("white", true);
         }
-        param.width  = channels_[i].width;
-        param.height = channels_[i].height;
-        param.fps    = channels_[i].fps;
-        MA_LOGI(TAG, "start channel %d format %d width %d height %d fps %d", i, param.format, param.width, param.height, param.fps);
-        if (channels_[i].enabled) {
-            setupVideo(static_cast<video_ch_index_t>(i), &param);
-            if (i == CHN_RAW) {
-                registerVideoFrameHandler(static_cast<video_ch_index_t>(i), 0, vpssCallbackStub, this);
-            } else {
-                registerVideoFrameHandler(static_cast<video_ch_index_t>(i), 0, vencCallbackStub, this);
+
+        for (int i = 0; i < CHN_MAX; i++) {
+            if (i == CHN_AUDIO) {
+                continue;
+            }
+            video_ch_param_t param;
+            switch (channels_[i].format) {
+                case MA_PIXEL_FORMAT_JPEG:
+                    param.format = VIDEO_FORMAT_JPEG;
+                    break;
+                case MA_PIXEL_FORMAT_H264:
+                    param.format = VIDEO_FORMAT_H264;
+                    break;
+                case MA_PIXEL_FORMAT_H265:
+                    param.format = VIDEO_FORMAT_H265;
+                    break;
+                case MA_PIXEL_FORMAT_RGB888:
+                    param.format = VIDEO_FORMAT_RGB888;
+                    break;
+                case MA_PIXEL_FORMAT_YUV422:
+                    param.format = VIDEO_FORMAT_NV21;
+                    break;
+                default:
+                    break;
+            }
+            param.width  = channels_[i].width;
+            param.height = channels_[i].height;
+            param.fps    = channels_[i].fps;
+            MA_LOGI(TAG, "start channel %d format %d width %d height %d fps %d", i, param.format, param.width, param.height, param.fps);
+            if (channels_[i].enabled) {
+                setupVideo(static_cast<video_ch_index_t>(i), &param);
+                // the VPSS rotates clockwise
+                video_ch_transform_t transform = {
+                    .crop_x      = channels_[i].crop_x,
+                    .crop_y      = channels_[i].crop_y,
+                    .crop_width  = static_cast<uint32_t>(channels_[i].crop_width),
+                    .crop_height = static_cast<uint32_t>(channels_[i].crop_height),
+                    .rotation    = static_cast<video_rotation_t>(((360 - channels_[i].rotation) % 360) / 90),
+                };
+                setupVideoTransform(static_cast<video_ch_index_t>(i), &transform);
+                if (i == CHN_RAW) {
+                    registerVideoFrameHandler(static_cast<video_ch_index_t>(i), 0, vpssCallbackStub, this);
+                } else {
+                    registerVideoFrameHandler(static_cast<video_ch_index_t>(i), 0, vencCallbackStub, this);
+                }
             }
         }
     }
@@ -732,6 +810,26 @@ ma_err_t CameraNode::config(int chn, int32_t width, int32_t height, int32_t fps,
     return MA_OK;
 }
 
+ma_err_t CameraNode::transform(int chn, int32_t x, int32_t y, int32_t width, int32_t height, int32_t rotation) {
+    Guard guard(mutex_);
+    if (chn < 0 || chn >= CHN_MAX || chn == CHN_AUDIO) {
+        return MA_EINVAL;
+    }
+    rotation = ((rotation % 360) + 360) % 360;
+    if (rotation % 90 != 0 || x < 0 || y < 0 || width < 0 || height < 0) {
+        return MA_EINVAL;
+    }
+    channels_[chn].crop_x      = x;
+    channels_[chn].crop_y      = y;
+    channels_[chn].crop_width  = width;
+    channels_[chn].crop_height = height;
+    channels_[chn].rotation    = rotation;
+
+    MA_LOGI(TAG, "transform channel %d crop %d,%d %dx%d rotation %d", chn, x, y, width, height, rotation);
+
+    return MA_OK;
+}
+
 ma_err_t CameraNode::attach(int chn, MessageBox* msgbox) {
     Guard guard(mutex_);
     if (channels_[chn].enabled) {
@@ -758,6 +856,14 @@ ma_err_t CameraNode::detach(int chn, MessageBox* msgbox) {
 REGISTER_NODE_SINGLETON("camera", CameraNode);
 
 void CameraNode::_startCameraSequence() {
+    if (simulator_ != nullptr) {
+        MA_LOGI(TAG, "start simulated video");
+        if (simulator_->start(channels_, &CameraNode::simulatorCallbackStub, this) != MA_OK) {
+            MA_LOGE(TAG, "failed to start the camera source");
+        }
+        server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", "enabled"}, {"code", MA_OK}, {"data", enabled_.load()}}));
+        return;
+    }
     Thread::enterCritical();
     Thread::sleep(Tick::fromMilliseconds(100));
     MA_LOGI(TAG, "start video");
@@ -768,6 +874,12 @@ void CameraNode::_startCameraSequence() {
 }
 
 void CameraNode::_stopCameraSequence() {
+    if (simulator_ != nullptr) {
+        MA_LOGI(TAG, "stop simulated video");
+        simulator_->stop();
+        server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", "enabled"}, {"code", MA_OK}, {"data", enabled_.load()}}));
+        return;
+    }
     Thread::enterCritical();
     MA_LOGI(TAG, "stop video");
     Thread::sleep(Tick::fromMilliseconds(100));
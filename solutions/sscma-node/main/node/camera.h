@@ -24,6 +24,13 @@ typedef struct {
     bool configured;
     bool enabled;
     bool dropped;
+    // region of the sensor frame taken before scaling, 0 width for the whole frame
+    int32_t crop_x;
+    int32_t crop_y;
+    int32_t crop_width;
+    int32_t crop_height;
+    // degrees counter clockwise applied after the crop, width/height are the rotated size
+    int32_t rotation;
     std::vector<MessageBox*> msgboxes;
 } channel;
 
@@ -42,21 +49,25 @@ public:
 
 class videoFrame : public Frame {
 public:
-    videoFrame() : Frame() {
+    videoFrame() : Frame(), stream(nullptr) {
         memset(&img, 0, sizeof(img));
     }
     inline void release() override {
         if (ref_cnt.load(std::memory_order_relaxed) == 0 || ref_cnt.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-            if (img.data) {
+            if (stream) {
+                app_ipcam_Venc_Stream_Release(stream);
+            } else if (img.data) {
                 delete[] img.data;
-                img.data = nullptr;
             }
+            img.data = nullptr;
             delete this;
         }
     }
     std::vector<std::pair<void*, size_t>> blocks;
     ma_img_t img;
     int fps;
+    // encoded frames: img.data and blocks point into this pooled encoder stream
+    VENC_STREAM_S* stream;
 };
 
 class audioFrame : public Frame {
@@ -76,6 +87,8 @@ public:
     size_t size;
 };
 
+class CameraSimulator;
+
 class CameraNode : public Node {
 
 public:
@@ -90,6 +103,8 @@ public:
     ma_err_t onDestroy() override;
 
     ma_err_t config(int chn, int32_t width = -1, int32_t height = -1, int32_t fps = -1, ma_pixel_format_t format = MA_PIXEL_FORMAT_UNKNOWN, bool enabled = true);
+    // crop and rotation done by the VPSS (or the simulator) for a channel, before its scaling
+    ma_err_t transform(int chn, int32_t x, int32_t y, int32_t width, int32_t height, int32_t rotation = 0);
     ma_err_t attach(int chn, MessageBox* msgbox);
     ma_err_t detach(int chn, MessageBox* msgbox);
 
@@ -102,12 +117,14 @@ protected:
     int vpssCallback(void* pData, void* pArgs);
     static int vencCallbackStub(void* pData, void* pArgs, void* pUserData);
     static int vpssCallbackStub(void* pData, void* pArgs, void* pUserData);
+    static void simulatorCallbackStub(void* user, int chn, videoFrame* frame, bool realtime);
 
 private:
     void _startCameraSequence();  // Added private function declaration
     void _stopCameraSequence();   // Added private function declaration
     void applyResolutionConfig(int chn, const json& config, const std::string& groupName);
     void configureDefaultChannels();
+    void publish(int chn, videoFrame* frame, ma_tick_t timeout);
 
     std::vector<channel> channels_;
     uint32_t count_;
@@ -120,6 +137,7 @@ private:
     Thread* thread_audio_;
     MessageBox frame_;
     TransportWebSocket* transport_;
+    CameraSimulator* simulator_;
 };
 
 }  // namespace ma::node
\ No newline at end of file
@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+
+#include "camera_sim.h"
+
+namespace ma::node {
+
+static constexpr char TAG[] = "ma::node::camera::sim";
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    data.resize(file.tellg());
+    file.seekg(0);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), data.size()));
+}
+
+static bool isImage(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp";
+}
+
+static bool isJpeg(const std::string& path) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".jpg" || ext == ".jpeg";
+}
+
+// software counterpart of the VPSS channel transform: crop, rotation, then scaling
+static ::cv::Mat transformImage(const ::cv::Mat& image, const channel& chn) {
+    ::cv::Mat out = image;
+    if (chn.crop_width > 0 && chn.crop_height > 0) {
+        ::cv::Rect roi = ::cv::Rect(chn.crop_x, chn.crop_y, chn.crop_width, chn.crop_height) & ::cv::Rect(0, 0, image.cols, image.rows);
+        if (roi.area() > 0) {
+            out = image(roi);
+        }
+    }
+    ::cv::Mat rotated;
+    switch (chn.rotation) {
+        case 90:
+            ::cv::rotate(out, rotated, ::cv::ROTATE_90_COUNTERCLOCKWISE);
+            out = rotated;
+            break;
+        case 180:
+            ::cv::rotate(out, rotated, ::cv::ROTATE_180);
+            out = rotated;
+            break;
+        case 270:
+            ::cv::rotate(out, rotated, ::cv::ROTATE_90_CLOCKWISE);
+            out = rotated;
+            break;
+        default:
+            break;
+    }
+    ::cv::Mat scaled;
+    ::cv::resize(out, scaled, ::cv::Size(chn.width, chn.height));
+    return scaled;
+}
+
+static bool transformed(const channel& chn) {
+    return (chn.crop_width > 0 && chn.crop_height > 0) || chn.rotation != 0;
+}
+
+CameraSimulator::CameraSimulator()
+    : width_(0),
+      height_(0),
+      fps_(0),
+      format_(MA_PIXEL_FORMAT_RGB888),
+      loop_(true),
+      realtime_(true),
+      count_(0),
+      sink_(nullptr),
+      user_(nullptr),
+      thread_(nullptr),
+      running_(false) {}
+
+CameraSimulator::~CameraSimulator() {
+    stop();
+}
+
+ma_err_t CameraSimulator::open(const json& config) {
+    if (!config.is_object() || !config.contains("type") || !config["type"].is_string() || !config.contains("path") || !config["path"].is_string()) {
+        MA_LOGE(TAG, "source needs a type and a path");
+        return MA_EINVAL;
+    }
+
+    type_ = config["type"].get<std::string>();
+    path_ = config["path"].get<std::string>();
+
+    if (config.contains("width") && config["width"].is_number()) {
+        width_ = config["width"].get<int32_t>();
+    }
+    if (config.contains("height") && config["height"].is_number()) {
+        height_ = config["height"].get<int32_t>();
+    }
+    if (config.contains("fps") && config["fps"].is_number()) {
+        fps_ = config["fps"].get<int32_t>();
+    }
+    if (config.contains("format") && config["format"].is_string()) {
+        std::string format = config["format"].get<std::string>();
+        if (format == "rgb888") {
+            format_ = MA_PIXEL_FORMAT_RGB888;
+        } else if (format == "yuv422") {
+            format_ = MA_PIXEL_FORMAT_YUV422;
+        } else {
+            MA_LOGE(TAG, "unsupported raw format %s", format.c_str());
+            return MA_EINVAL;
+        }
+    }
+    if (config.contains("loop") && config["loop"].is_boolean()) {
+        loop_ = config["loop"].get<bool>();
+    }
+    if (config.contains("realtime") && config["realtime"].is_boolean()) {
+        realtime_ = config["realtime"].get<bool>();
+    }
+
+    ma_err_t ret = MA_EINVAL;
+    if (type_ == "images") {
+        ret = loadImages();
+    } else if (type_ == "raw") {
+        ret = loadRaw();
+    } else if (type_ == "h264") {
+        ret = loadH264();
+    } else {
+        MA_LOGE(TAG, "unsupported source type %s", type_.c_str());
+    }
+
+    if (ret == MA_OK) {
+        MA_LOGI(TAG, "source %s %s: %zu frames", type_.c_str(), path_.c_str(), type_ == "images" ? files_.size() : count_);
+    }
+
+    return ret;
+}
+
+// the pictures are only listed here, they are decoded at start once the channel geometry is final
+ma_err_t CameraSimulator::loadImages() {
+    std::error_code ec;
+
+    files_.clear();
+    if (std::filesystem::is_directory(path_, ec)) {
+        for (const auto& entry : std::filesystem::directory_iterator(path_, ec)) {
+            if (entry.is_regular_file(ec) && isImage(entry.path())) {
+                files_.push_back(entry.path().string());
+            }
+        }
+        std::sort(files_.begin(), files_.end());
+    } else if (std::filesystem::is_regular_file(path_, ec) && isImage(path_)) {
+        files_.push_back(path_);
+    }
+
+    if (files_.empty()) {
+        MA_LOGE(TAG, "no image found in %s", path_.c_str());
+        return MA_ENOENT;
+    }
+
+    return MA_OK;
+}
+
+ma_err_t CameraSimulator::loadRaw() {
+    std::vector<uint8_t> data;
+
+    if (width_ <= 0 || height_ <= 0) {
+        MA_LOGE(TAG, "raw source needs its width and height");
+        return MA_EINVAL;
+    }
+    if (!readFile(path_, data)) {
+        MA_LOGE(TAG, "failed to read %s", path_.c_str());
+        return MA_ENOENT;
+    }
+
+    size_t size = static_cast<size_t>(width_) * height_ * (format_ == MA_PIXEL_FORMAT_RGB888 ? 3 : 2);
+    count_      = data.size() / size;
+    if (count_ == 0) {
+        MA_LOGE(TAG, "%s is smaller than one %dx%d frame", path_.c_str(), width_, height_);
+        return MA_EINVAL;
+    }
+    if (data.size() % size != 0) {
+        MA_LOGW(TAG, "%s: %zu trailing bytes ignored", path_.c_str(), data.size() % size);
+    }
+
+    samples_[CHN_RAW].resize(count_);
+    for (size_t i = 0; i < count_; i++) {
+        samples_[CHN_RAW][i].data.assign(data.begin() + i * size, data.begin() + (i + 1) * size);
+        samples_[CHN_RAW][i].key = true;
+    }
+
+    return MA_OK;
+}
+
+// splits the stream on its start codes, parameter sets and SEI are grouped with the next slice
+ma_err_t CameraSimulator::loadH264() {
+    std::vector<uint8_t> data;
+    std::vector<size_t> starts;
+
+    if (!readFile(path_, data)) {
+        MA_LOGE(TAG, "failed to read %s", path_.c_str());
+        return MA_ENOENT;
+    }
+
+    for (size_t i = 0; i + 3 <= data.size(); i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            starts.push_back(i > 0 && data[i - 1] == 0 ? i - 1 : i);
+            i += 2;
+        }
+    }
+    if (starts.empty()) {
+        MA_LOGE(TAG, "%s is not an Annex B stream", path_.c_str());
+        return MA_EINVAL;
+    }
+    starts.push_back(data.size());
+
+    Sample sample = {{}, {}, false};
+    for (size_t n = 0; n + 1 < starts.size(); n++) {
+        size_t begin = starts[n];
+        size_t end   = starts[n + 1];
+        size_t head  = begin + (data[begin + 2] == 1 ? 3 : 4);
+        int type     = head < end ? data[head] & 0x1f : 0;
+
+        sample.nals.push_back({sample.data.size(), end - begin});
+        sample.data.insert(sample.data.end(), data.begin() + begin, data.begin() + end);
+        // 5: IDR slice, 7: SPS, 8: PPS
+        sample.key |= type == 5 || type == 7 || type == 8;
+        if (type == 1 || type == 5) {
+            samples_[CHN_H264].push_back(std::move(sample));
+            sample = {{}, {}, false};
+        }
+    }
+
+    count_ = samples_[CHN_H264].size();
+    if (count_ == 0) {
+        MA_LOGE(TAG, "no slice found in %s", path_.c_str());
+        return MA_EINVAL;
+    }
+
+    return MA_OK;
+}
+
+bool CameraSimulator::provides(int chn) const {
+    if (type_ == "images") {
+        return chn == CHN_RAW || chn == CHN_JPEG;
+    }
+    if (type_ == "raw") {
+        return chn == CHN_RAW;
+    }
+    return chn == CHN_H264;
+}
+
+int32_t CameraSimulator::width() const {
+    return width_;
+}
+
+int32_t CameraSimulator::height() const {
+    return height_;
+}
+
+int32_t CameraSimulator::fps() const {
+    return fps_;
+}
+
+ma_pixel_format_t CameraSimulator::format() const {
+    return format_;
+}
+
+ma_err_t CameraSimulator::start(const std::vector<channel>& channels, Sink sink, void* user) {
+    if (running_) {
+        return MA_OK;
+    }
+
+    channels_ = channels;
+    sink_     = sink;
+    user_     = user;
+
+    if (type_ == "raw") {
+        const channel& raw = channels_[CHN_RAW];
+        if (raw.enabled && (raw.width != width_ || raw.height != height_ || raw.format != format_)) {
+            MA_LOGE(TAG, "raw channel %dx%d does not match the %dx%d dump", raw.width, raw.height, width_, height_);
+            return MA_EINVAL;
+        }
+        if (raw.enabled && transformed(raw)) {
+            MA_LOGW(TAG, "raw dumps are replayed as recorded, the channel crop and rotation are ignored");
+        }
+    }
+
+    // decoded and scaled once, a replayed frame then costs one copy like a VPSS frame does
+    if (type_ == "images") {
+        const channel& raw  = channels_[CHN_RAW];
+        const channel& jpeg = channels_[CHN_JPEG];
+
+        if (raw.enabled && raw.format != MA_PIXEL_FORMAT_RGB888) {
+            MA_LOGE(TAG, "images are only replayed as rgb888 on the raw channel");
+            return MA_ENOTSUP;
+        }
+
+        samples_[CHN_RAW].clear();
+        samples_[CHN_JPEG].clear();
+        for (const auto& file : files_) {
+            ::cv::Mat image = ::cv::imread(file, ::cv::IMREAD_COLOR);
+            if (image.empty()) {
+                MA_LOGW(TAG, "skipping %s", file.c_str());
+                continue;
+            }
+            if (raw.enabled) {
+                ::cv::Mat rgb = transformImage(image, raw);
+                ::cv::cvtColor(rgb, rgb, ::cv::COLOR_BGR2RGB);
+                samples_[CHN_RAW].push_back({std::vector<uint8_t>(rgb.data, rgb.data + rgb.total() * rgb.elemSize()), {}, true});
+            }
+            if (jpeg.enabled) {
+                Sample sample = {{}, {}, true};
+                if (transformed(jpeg) || !isJpeg(file) || image.cols != jpeg.width || image.rows != jpeg.height || !readFile(file, sample.data)) {
+                    ::cv::imencode(".jpg", transformImage(image, jpeg), sample.data, {::cv::IMWRITE_JPEG_QUALITY, 90});
+                }
+                samples_[CHN_JPEG].push_back(std::move(sample));
+            }
+        }
+        count_ = std::max(samples_[CHN_RAW].size(), samples_[CHN_JPEG].size());
+        if (count_ == 0) {
+            MA_LOGE(TAG, "no image decoded from %s", path_.c_str());
+            return MA_EINVAL;
+        }
+    }
+
+    thread_ = new Thread("camera#sim", &CameraSimulator::threadEntryStub, this);
+    if (thread_ == nullptr) {
+        return MA_ENOMEM;
+    }
+
+    running_ = true;
+    if (!thread_->start(this)) {
+        running_ = false;
+        delete thread_;
+        thread_ = nullptr;
+        return MA_EIO;
+    }
+
+    return MA_OK;
+}
+
+void CameraSimulator::stop() {
+    running_ = false;
+    if (thread_ != nullptr) {
+        thread_->join();
+        delete thread_;
+        thread_ = nullptr;
+    }
+}
+
+videoFrame* CameraSimulator::makeFrame(int chn, size_t index, ma_tick_t timestamp) {
+    const Sample& sample = samples_[chn][index];
+    videoFrame* frame    = new videoFrame();
+
+    frame->chn          = chn;
+    frame->timestamp    = timestamp;
+    frame->img.width    = channels_[chn].width;
+    frame->img.height   = channels_[chn].height;
+    frame->img.format   = channels_[chn].format;
+    frame->img.size     = sample.data.size();
+    frame->img.key      = sample.key;
+    frame->img.physical = false;
+    frame->img.data     = new uint8_t[sample.data.size()];
+    frame->fps          = channels_[chn].fps;
+    memcpy(frame->img.data, sample.data.data(), sample.data.size());
+
+    if (sample.nals.empty()) {
+        frame->blocks.push_back({frame->img.data, frame->img.size});
+    }
+    for (const auto& nal : sample.nals) {
+        frame->blocks.push_back({frame->img.data + nal.first, nal.second});
+    }
+
+    return frame;
+}
+
+void CameraSimulator::threadEntry() {
+    int32_t fps = fps_;
+    for (int chn = 0; fps <= 0 && chn < CHN_AUDIO; chn++) {
+        if (channels_[chn].enabled && provides(chn)) {
+            fps = channels_[chn].fps;
+        }
+    }
+    fps = fps > 0 ? fps : 30;
+
+    const ma_tick_t period = Tick::fromMicroseconds(1000000 / fps);
+    const ma_tick_t origin = Tick::current();
+
+    for (uint64_t n = 0; running_; n++) {
+        if (!loop_ && n >= count_) {
+            MA_LOGI(TAG, "end of %s after %zu frames", path_.c_str(), count_);
+            break;
+        }
+
+        // timestamps follow the nominal rate, the pacing does not drift with the delivery time
+        ma_tick_t timestamp = origin + n * period;
+        if (realtime_) {
+            ma_tick_t now = Tick::current();
+            if (timestamp > now) {
+                Thread::sleep(timestamp - now);
+            }
+        }
+
+        for (int chn = 0; chn < CHN_AUDIO; chn++) {
+            if (channels_[chn].enabled && !samples_[chn].empty()) {
+                sink_(user_, chn, makeFrame(chn, n % samples_[chn].size(), timestamp), realtime_);
+            }
+        }
+    }
+}
+
+void CameraSimulator::threadEntryStub(void* obj) {
+    reinterpret_cast<CameraSimulator*>(obj)->threadEntry();
+}
+
+}  // namespace ma::node
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "camera.h"
+
+namespace ma::node {
+
+/**
+ * Stand-in for the VI/VPSS/VENC pipeline, replaying recorded input on the camera channels so a
+ * graph can be exercised and timed without a sensor:
+ * - "images": a picture, or a directory of them in name order, decoded once and served as RGB888
+ *   on the RAW channel and as JPEG on the JPEG channel, both at the channel geometry after the
+ *   channel crop and rotation, done in software as the VPSS would;
+ * - "raw": a dump of back to back frames of the RAW channel geometry and format;
+ * - "h264": an Annex B elementary stream on the H264 channel, one access unit per frame with the
+ *   SPS/PPS/SEI in front of the IDR, like the encoder callback does.
+ * Frame n is stamped start + n / fps whatever its delivery time, so runs are reproducible. With
+ * realtime off the frames are posted as fast as the consumers take them.
+ */
+class CameraSimulator {
+public:
+    using Sink = void (*)(void* user, int chn, videoFrame* frame, bool realtime);
+
+    CameraSimulator();
+    ~CameraSimulator();
+
+    ma_err_t open(const json& config);
+    ma_err_t start(const std::vector<channel>& channels, Sink sink, void* user);
+    void stop();
+
+    // channels the source can feed and the geometry of its frames, 0 when it has none
+    bool provides(int chn) const;
+    int32_t width() const;
+    int32_t height() const;
+    int32_t fps() const;
+    ma_pixel_format_t format() const;
+
+protected:
+    void threadEntry();
+    static void threadEntryStub(void* obj);
+
+private:
+    struct Sample {
+        std::vector<uint8_t> data;
+        std::vector<std::pair<size_t, size_t>> nals;
+        bool key;
+    };
+
+    ma_err_t loadImages();
+    ma_err_t loadRaw();
+    ma_err_t loadH264();
+    videoFrame* makeFrame(int chn, size_t index, ma_tick_t timestamp);
+
+    std::string type_;
+    std::string path_;
+    int32_t width_;
+    int32_t height_;
+    int32_t fps_;
+    ma_pixel_format_t format_;
+    bool loop_;
+    bool realtime_;
+
+    std::vector<std::string> files_;
+    std::vector<Sample> samples_[CHN_MAX];
+    size_t count_;
+
+    std::vector<channel> channels_;
+    Sink sink_;
+    void* user_;
+    Thread* thread_;
+    std::atomic<bool> running_;
+};
+
+}  // namespace ma::node
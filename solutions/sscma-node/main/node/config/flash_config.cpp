@@ -49,6 +49,14 @@ FlashConfig readFlashConfigFromFile(const std::string& filename) {
                         config.disable_red_led_blinking = flash_config["disable_red_led_blinking"];
                     }
 
+                    if (flash_config.contains("burst_enabled") && flash_config["burst_enabled"].is_boolean()) {
+                        config.burst_enabled = flash_config["burst_enabled"];
+                    }
+
+                    if (flash_config.contains("burst_frames") && flash_config["burst_frames"].is_number()) {
+                        config.burst_frames = flash_config["burst_frames"];
+                    }
+
                     /* MA_LOGI(TAG,
                             "Paramètres du flash chargés: enabled:%s, pre=%d ms, duration=%d ms, intensity=%d, disable_red=%s",
                             config.enabled ? "true" : "false",
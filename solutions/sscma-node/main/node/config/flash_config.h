@@ -15,6 +15,8 @@ struct FlashConfig {
     int flash_duration_ms         = 100;    // Durée en ms du flash de confirmation (LED bleue)
     int flash_intensity           = 255;    // Intensité du flash (0-255, -1 = maximum)
     bool disable_red_led_blinking = true;   // Désactiver le clignotement de la LED rouge
+    bool burst_enabled            = false;  // Capture en rafale autour de l'allumage du flash au lieu du délai fixe
+    int burst_frames              = 8;      // Nombre de frames de la rafale (la moitié sans flash en mode dataset)
 };
 
 /**
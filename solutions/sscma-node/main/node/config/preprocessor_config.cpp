@@ -34,6 +34,7 @@ PreprocessorConfig readPreprocessorConfigFromFile(const std::string& nodeId, con
                 config.enable_resize       = reader.getNodeConfigBool(nodeId, "enable_resize", config.enable_resize);
                 config.enable_denoising    = reader.getNodeConfigBool(nodeId, "enable_denoising", config.enable_denoising);
                 config.enable_ccw_rotation = reader.getNodeConfigBool(nodeId, "enable_ccw_rotation", config.enable_ccw_rotation);
+                config.hardware_transform  = reader.getNodeConfigBool(nodeId, "hardware_transform", config.hardware_transform);
                 config.width               = reader.getNodeConfigInt(nodeId, "width", config.width);
                 config.height              = reader.getNodeConfigInt(nodeId, "height", config.height);
                 config.debug               = reader.getNodeConfigBool(nodeId, "debug", config.debug);
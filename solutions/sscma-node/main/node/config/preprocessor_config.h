@@ -12,6 +12,7 @@ struct PreprocessorConfig {
     bool enable_resize         = true;    // Indicateur pour activer le redimensionnement
     bool enable_denoising      = false;   // Indicateur pour activer le débruitage
     bool enable_ccw_rotation   = false;   // Indicateur pour activer le débruitage
+    bool hardware_transform    = false;   // Crop, rotation et redimensionnement faits par le VPSS
     int width                  = 640;     // Largeur de sortie par défaut
     int height                 = 640;     // Hauteur de sortie par défaut
     bool debug                 = false;   // Mode debug
@@ -48,6 +48,36 @@ namespace ma::node {
     return raw_image;
 }
 
+bool FrameUtils::scoreFrame(videoFrame* frame, double& brightness, double& sharpness) {
+    Profiler p("scoreFrame");
+    ::cv::Mat grey;
+
+    if (frame->img.format == MA_PIXEL_FORMAT_JPEG) {
+        // libjpeg décode directement à l'échelle 1/4, sans passer par la pleine résolution
+        ::cv::Mat buffer(1, frame->img.size, CV_8UC1, frame->img.data);
+        grey = ::cv::imdecode(buffer, ::cv::IMREAD_REDUCED_GRAYSCALE_4);
+    } else if (frame->img.format == MA_PIXEL_FORMAT_RGB888) {
+        ::cv::Mat rgb(frame->img.height, frame->img.width, CV_8UC3, frame->img.data);
+        ::cv::Mat small;
+        ::cv::resize(rgb, small, ::cv::Size(), 0.25, 0.25, ::cv::INTER_NEAREST);
+        ::cv::cvtColor(small, grey, ::cv::COLOR_RGB2GRAY);
+    }
+
+    if (grey.empty()) {
+        MA_LOGW(TAG, "Format d'image non supporté pour le score: %d", frame->img.format);
+        return false;
+    }
+
+    ::cv::Mat laplacian;
+    ::cv::Laplacian(grey, laplacian, CV_16S);
+    ::cv::Scalar mean, stddev;
+    ::cv::meanStdDev(laplacian, mean, stddev);
+
+    brightness = ::cv::mean(grey)[0];
+    sharpness  = stddev[0] * stddev[0];
+    return true;
+}
+
 bool FrameUtils::prepareAndPublishOutputFrame(const ::cv::Mat& output_image, videoFrame* input_frame, MessageBox& output_frame, int output_width, int output_height) {
     // Créer une nouvelle frame pour l'image traitée
     videoFrame* output_frame_ptr = new videoFrame();
@@ -9,5 +9,8 @@ class FrameUtils {
 public:
     static ::cv::Mat convertFrameToMat(videoFrame* frame);
     static bool prepareAndPublishOutputFrame(const ::cv::Mat& output_image, videoFrame* input_frame, MessageBox& output_frame, int output_width, int output_height);
+    // Mesures rapides sur un aperçu en niveaux de gris au quart de la résolution : niveau moyen pour
+    // l'exposition, variance du Laplacien pour la netteté
+    static bool scoreFrame(videoFrame* frame, double& brightness, double& sharpness);
 };
 }  // namespace ma::node
\ No newline at end of file
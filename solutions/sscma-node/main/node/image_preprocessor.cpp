@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <stdexcept>
@@ -7,6 +8,7 @@
 #include <unistd.h>
 
 #include "FlowConfigReader.h"
+#include "capture_flag.h"
 #include "config/ai_config.h"
 #include "config/barcode_config.h"
 #include "config/crop_config.h"
@@ -20,13 +22,17 @@
 #include "label_mapper.h"
 #include "led.h"
 #include "profiler.h"
+#include "stats.h"
 
 namespace ma::node {
 
 // Suppression ou remplacement de la définition de CURRENT_CHANNEL
-#define RES_WIDTH  1920  // Configuration pour résolution 1080p
-#define RES_HEIGHT 1080  // Configuration pour résolution 1080p
-#define FPS        10    // FPS standard pour 1080p
+#define RES_WIDTH         1920  // Configuration pour résolution 1080p
+#define RES_HEIGHT        1080  // Configuration pour résolution 1080p
+#define FPS               10    // FPS standard pour 1080p
+#define TRANSFORM_WAIT_MS 300   // Attente maximale de la frame VPSS d'une capture
+#define BURST_WAIT_MS     2000  // Attente de la première frame d'une rafale
+#define BURST_FRAME_MS    200   // Attente de chaque frame suivante
 
 static constexpr char TAG[] = "ma::node::image_preprocessor";
 
@@ -118,6 +124,7 @@ ImagePreProcessorNode::ImagePreProcessorNode(std::string id)
       debug_(false),
       saved_image_count_(0),
       capture_requested_(false),
+      capture_requested_at_(0),
       capture_in_progress_(false),
       capture_done_(false),
       tube_type_("OTHER"),
@@ -128,7 +135,19 @@ ImagePreProcessorNode::ImagePreProcessorNode(std::string id)
       flash_duration_ms_(200),
       pre_capture_delay_ms_(100),
       disable_red_led_blinking_(false),
+      burst_active_(false),
+      burst_frames_(0),
+      burst_dark_(0),
+      burst_count_(0),
+      burst_intensity_(-1),
+      burst_flash_(false),
+      burst_keep_dark_(false),
+      burst_peak_(0.0),
+      burst_start_(0),
+      burst_flash_at_(0),
+      burst_deadline_(0),
       channel_(0),
+      hardware_transform_(false),
       ai_processor_(nullptr),
       ai_model_path_(""),
       enable_ai_detection_(false) {
@@ -161,14 +180,24 @@ void ImagePreProcessorNode::threadEntry() {
     MA_LOGI(TAG, "ImagePreProcessorNode.threadEntry: started_ = %s", started_ ? "true" : "false");
 
     while (started_) {
+        if (burst_active_.load() && Tick::current() >= burst_deadline_) {
+            MA_LOGW(TAG, "Burst timed out with %d/%d frames", burst_count_, burst_frames_);
+            selectBurst(last_debug);
+        }
+        if (hardware_transform_ && !isCaptureRequested()) {
+            releaseTransformedFrames();
+        }
         if (!fetchAndValidateFrame(frame)) {
             thread_->sleep(Tick::fromMilliseconds(2));
             continue;
         }
 
+        NodeStats::Scope scope(id_, frame->timestamp);
         bool should_process = isCaptureRequested();
 
-        if (should_process) {
+        if (should_process && burst_active_.load()) {
+            collectBurstFrame(frame, last_debug);
+        } else if (should_process) {
             processCaptureRequest(frame, last_debug, tube_type_);
         } else {
             handleNoCaptureRequested(frame);
@@ -193,8 +222,33 @@ bool ImagePreProcessorNode::fetchAndValidateFrame(videoFrame*& frame) {
     return true;
 }
 
+// Attend la frame du canal transformé par le VPSS produite pour la capture en cours, les frames
+// antérieures à la demande sont libérées et jamais réutilisées pour une capture suivante
+videoFrame* ImagePreProcessorNode::fetchTransformedFrame(ma_tick_t since, ma_tick_t timeout) {
+    ma_tick_t deadline = Tick::current() + timeout;
+    videoFrame* frame  = nullptr;
+    while (true) {
+        ma_tick_t now = Tick::current();
+        if (!transformed_frame_.fetch(reinterpret_cast<void**>(&frame), now < deadline ? deadline - now : 0)) {
+            return nullptr;
+        }
+        if (frame->timestamp >= since) {
+            return frame;
+        }
+        frame->release();
+    }
+}
+
+// Libère les frames VPSS reçues hors capture
+void ImagePreProcessorNode::releaseTransformedFrames() {
+    videoFrame* frame = nullptr;
+    while (transformed_frame_.fetch(reinterpret_cast<void**>(&frame), 0)) {
+        frame->release();
+    }
+}
+
 // Nouvelle méthode privée : processCaptureRequest
-void ImagePreProcessorNode::processCaptureRequest(videoFrame* frame, ma_tick_t& last_debug, std::string tubeType) {
+void ImagePreProcessorNode::processCaptureRequest(videoFrame* frame, ma_tick_t& last_debug, std::string tubeType, bool hardware_frame) {
     Profiler p("processCaptureRequest");
     MA_LOGI(TAG, "ImagePreProcessorNode.threadEntry: User requested capture into %s, processing frame...", tubeType.c_str());
 
@@ -231,18 +285,29 @@ void ImagePreProcessorNode::processCaptureRequest(videoFrame* frame, ma_tick_t&
 
     /*MA_LOGI(TAG, "Configuration chargée: save_raw=%s, enable_resize=%s, enable_denoising=%s", save_raw ? "true" : "false", enable_resize_ ? "true" : "false", enable_denoising_ ? "true" : "false");*/
 
-    // Lecture dynamique des paramètres de crop
-    ma::CropConfig cropCfg = ma::readCropConfigFromFile();
-    if (cropCfg.enabled) {
-        MA_LOGI(TAG, "Cropping enabled - Region [%d,%d] to [%d,%d]", cropCfg.xmin, cropCfg.ymin, cropCfg.xmax, cropCfg.ymax);
-        cropped_image = ImageUtils::cropImage(raw_image, cropCfg.xmin, cropCfg.ymin, cropCfg.xmax, cropCfg.ymax);
-    } else {
-        cropped_image = raw_image.clone();
+    // Image IA déjà recadrée, tournée et redimensionnée par le VPSS
+    videoFrame* transformed = nullptr;
+    if (hardware_transform_ && enable_resize_ && hardware_frame) {
+        transformed = fetchTransformedFrame(capture_requested_at_, Tick::fromMilliseconds(TRANSFORM_WAIT_MS));
+        if (transformed == nullptr) {
+            MA_LOGW(TAG, "Pas de frame VPSS pour cette capture après %d ms, recadrage logiciel", TRANSFORM_WAIT_MS);
+        }
     }
 
-    if (preprocessorCfg.enable_ccw_rotation) {
-        MA_LOGI(TAG, "Rotation CCW enabled - Rotating image 90° counter clockwise");
-        cropped_image = ImageUtils::rotate90CCW(cropped_image);
+    if (transformed == nullptr) {
+        // Lecture dynamique des paramètres de crop
+        ma::CropConfig cropCfg = ma::readCropConfigFromFile();
+        if (cropCfg.enabled) {
+            MA_LOGI(TAG, "Cropping enabled - Region [%d,%d] to [%d,%d]", cropCfg.xmin, cropCfg.ymin, cropCfg.xmax, cropCfg.ymax);
+            cropped_image = ImageUtils::cropImage(raw_image, cropCfg.xmin, cropCfg.ymin, cropCfg.xmax, cropCfg.ymax);
+        } else {
+            cropped_image = raw_image.clone();
+        }
+
+        if (preprocessorCfg.enable_ccw_rotation) {
+            MA_LOGI(TAG, "Rotation CCW enabled - Rotating image 90° counter clockwise");
+            cropped_image = ImageUtils::rotate90CCW(cropped_image);
+        }
     }
 
     if (barcodeConfig.enabled) {
@@ -275,7 +340,12 @@ void ImagePreProcessorNode::processCaptureRequest(videoFrame* frame, ma_tick_t&
     }
 
     ::cv::Mat output_image;
-    if (enable_resize_) {
+    if (transformed != nullptr) {
+        MA_LOGI(TAG, "Resizing done by the VPSS - %dx%d", transformed->img.width, transformed->img.height);
+        // le VPSS sort du RGB, le chemin logiciel du BGR
+        ::cv::cvtColor(FrameUtils::convertFrameToMat(transformed), output_image, ::cv::COLOR_RGB2BGR);
+        transformed->release();
+    } else if (enable_resize_) {
         MA_LOGI(TAG, "Resizing enabled - applying resizing to %dx%d", output_width_, output_height_);
         output_image = ImageUtils::resizeImage(cropped_image, output_width_, output_height_);
     } else {
@@ -345,6 +415,123 @@ void ImagePreProcessorNode::processCaptureRequest(videoFrame* frame, ma_tick_t&
     setCaptureDone();
 }
 
+void ImagePreProcessorNode::requestBurst(std::string tubeType, int frames, bool flash, bool keep_dark, int intensity) {
+    burst_frames_    = std::min(std::max(frames, 2), 16);
+    burst_dark_      = keep_dark ? burst_frames_ / 2 : 0;
+    burst_count_     = 0;
+    burst_intensity_ = intensity;
+    burst_flash_     = flash;
+    burst_keep_dark_ = keep_dark;
+    burst_peak_      = 0.0;
+    burst_start_     = Tick::current();
+    burst_flash_at_  = 0;
+    burst_deadline_  = burst_start_ + Tick::fromMilliseconds(BURST_WAIT_MS + burst_frames_ * BURST_FRAME_MS);
+    burst_active_.store(true);
+    requestCapture(tubeType);
+}
+
+// Reçoit une frame de la rafale : le flash est allumé après les frames sans flash du mode dataset, puis
+// chaque frame est notée et seule la meilleure de chaque catégorie est gardée, les autres sont libérées
+// tout de suite pour ne pas bloquer les buffers de l'encodeur
+void ImagePreProcessorNode::collectBurstFrame(videoFrame* frame, ma_tick_t& last_debug) {
+    // frame déjà en file avant la demande
+    if (frame->timestamp < burst_start_) {
+        if (channel_ == CHN_RAW) {
+            capture_requested.store(true);
+        }
+        frame->release();
+        return;
+    }
+
+    if (burst_flash_ && burst_flash_at_ == 0 && burst_count_ >= burst_dark_) {
+        Led::controlLed("white", true, burst_intensity_);
+        burst_flash_at_ = Tick::current();
+    }
+    burst_count_++;
+
+    // le canal RAW n'envoie qu'une frame par demande à la caméra, chaque frame de la rafale est redemandée
+    if (channel_ == CHN_RAW && burst_count_ < burst_frames_) {
+        capture_requested.store(true);
+    }
+
+    BurstShot shot;
+    shot.frame = frame;
+    if (!FrameUtils::scoreFrame(frame, shot.brightness, shot.sharpness)) {
+        shot.brightness = 0.0;
+        shot.sharpness  = 0.0;
+    }
+
+    // une frame horodatée avant l'allumage a été exposée sans flash
+    bool lit = !burst_flash_ || (burst_flash_at_ != 0 && frame->timestamp > burst_flash_at_);
+    MA_LOGD(TAG, "Burst frame %d/%d: %s, brightness %.1f, sharpness %.1f", burst_count_, burst_frames_, lit ? "lit" : "dark", shot.brightness, shot.sharpness);
+
+    if (lit) {
+        // les frames prises pendant la montée du flash sont sous-exposées : seules celles à 90% de
+        // la luminosité maximale sont candidates, la plus nette l'emporte
+        burst_peak_     = std::max(burst_peak_, shot.brightness);
+        double floor    = burst_peak_ * 0.9;
+        BurstShot& best = burst_lit_;
+        bool replace    = best.frame == nullptr || best.brightness < floor || (shot.brightness >= floor && shot.sharpness > best.sharpness);
+        if (replace) {
+            std::swap(best, shot);
+        }
+    } else if (burst_keep_dark_ && (burst_unlit_.frame == nullptr || shot.sharpness > burst_unlit_.sharpness)) {
+        std::swap(burst_unlit_, shot);
+    }
+    if (shot.frame != nullptr) {
+        shot.frame->release();
+    }
+
+    if (burst_count_ >= burst_frames_) {
+        selectBurst(last_debug);
+    }
+}
+
+void ImagePreProcessorNode::selectBurst(ma_tick_t& last_debug) {
+    MA_LOGI(TAG,
+            "Burst of %d frames in %.0f ms - selected lit brightness %.1f sharpness %.1f, dark sharpness %.1f",
+            burst_count_,
+            static_cast<double>(Tick::toMilliseconds(Tick::current() - burst_start_)),
+            burst_lit_.brightness,
+            burst_lit_.sharpness,
+            burst_unlit_.sharpness);
+
+    // la frame IA du VPSS ne correspond pas à la frame retenue, le chemin logiciel la remplace
+    releaseTransformedFrames();
+
+    BurstShot lit   = burst_lit_;
+    BurstShot unlit = burst_unlit_;
+    burst_lit_      = BurstShot();
+    burst_unlit_    = BurstShot();
+
+    if (lit.frame != nullptr) {
+        processCaptureRequest(lit.frame, last_debug, tube_type_, false);
+    }
+    if (unlit.frame != nullptr) {
+        processCaptureRequest(unlit.frame, last_debug, tube_type_, false);
+    }
+    if (lit.frame == nullptr) {
+        // sans frame éclairée retenue, processCaptureRequest n'a pas éteint le flash
+        Led::controlLed("white", false);
+    }
+    setCaptureDone();
+    burst_active_.store(false);
+}
+
+void ImagePreProcessorNode::releaseBurst() {
+    if (burst_lit_.frame != nullptr) {
+        burst_lit_.frame->release();
+    }
+    if (burst_unlit_.frame != nullptr) {
+        burst_unlit_.frame->release();
+    }
+    burst_lit_   = BurstShot();
+    burst_unlit_ = BurstShot();
+    if (burst_active_.exchange(false)) {
+        setCaptureDone();
+    }
+}
+
 // Nouvelle méthode privée : handleNoCaptureRequested
 void ImagePreProcessorNode::handleNoCaptureRequested(videoFrame* frame) {
     frame->release();
@@ -430,6 +617,12 @@ ma_err_t ImagePreProcessorNode::onCreate(const json& config) {
         MA_LOGW(TAG, "attach_channel non spécifié dans la configuration, utilisation du canal JPEG (1) par défaut");
     }
 
+    hardware_transform_ = preprocessorCfg.hardware_transform;
+    if (hardware_transform_ && channel_ == CHN_RAW) {
+        MA_LOGW(TAG, "hardware_transform utilise le canal RAW, il ne peut pas être le canal attaché");
+        hardware_transform_ = false;
+    }
+
     // Création du thread de traitement
     thread_ = new Thread((type_ + "#" + id_).c_str(), &ImagePreProcessorNode::threadEntryStub, this);
     if (thread_ == nullptr) {
@@ -588,6 +781,22 @@ ma_err_t ImagePreProcessorNode::onStart() {
         return MA_ENOTSUP;
     }
     camera_->attach(channel_, &input_frame_);  // Attachement au canal configuré
+    NodeStats::watch(id_, &input_frame_);
+
+    if (hardware_transform_) {
+        // Le crop et la rotation sont programmés dans le VPSS au démarrage de la caméra
+        ma::CropConfig cropCfg                 = ma::readCropConfigFromFile();
+        ma::PreprocessorConfig preprocessorCfg = ma::readPreprocessorConfigFromFile(id_);
+        int32_t rotation                       = preprocessorCfg.enable_ccw_rotation ? 90 : 0;
+        camera_->config(CHN_RAW, output_width_, output_height_, FPS, MA_PIXEL_FORMAT_RGB888);
+        if (cropCfg.enabled) {
+            camera_->transform(CHN_RAW, cropCfg.xmin, cropCfg.ymin, cropCfg.xmax - cropCfg.xmin, cropCfg.ymax - cropCfg.ymin, rotation);
+        } else {
+            camera_->transform(CHN_RAW, 0, 0, 0, 0, rotation);
+        }
+        camera_->attach(CHN_RAW, &transformed_frame_);
+        MA_LOGI(TAG, "ImagePreProcessorNode.onStart: AI frames %dx%d from the VPSS on channel %d", output_width_, output_height_, CHN_RAW);
+    }
 
     MA_LOGI(TAG, "ImagePreProcessorNode.onStart: camera attached to channel %d, starting thread", channel_);
     started_ = true;
@@ -615,8 +824,18 @@ ma_err_t ImagePreProcessorNode::onStop() {
     // Détacher de la caméra
     if (camera_ != nullptr) {
         camera_->detach(channel_, &input_frame_);  // Utiliser le canal configuré
+        if (hardware_transform_) {
+            camera_->detach(CHN_RAW, &transformed_frame_);
+        }
         camera_ = nullptr;
     }
+    NodeStats::unwatch(&input_frame_);
+
+    releaseBurst();
+
+    if (hardware_transform_) {
+        releaseTransformedFrames();
+    }
 
     return MA_OK;
 }
@@ -26,7 +26,8 @@ public:
 
     // Nouvelle méthode pour demander une capture d'image
     void requestCapture(std::string tubeType) {
-        tube_type_ = tubeType;
+        tube_type_            = tubeType;
+        capture_requested_at_ = Tick::current();
         capture_requested_.store(true);
         capture_in_progress_.store(true);
         capture_done_.store(false);
@@ -41,8 +42,16 @@ public:
         return (capture_requested_.load() || capture_in_progress_.load()) && !capture_done_.load();
     }
 
+    // Rafale de frames consécutives autour de l'allumage du flash, seule la meilleure est traitée
+    void requestBurst(std::string tubeType, int frames, bool flash, bool keep_dark, int intensity);
+
     bool isCaptureDone() const {
-        return capture_done_.load();
+        return capture_done_.load() && !burst_active_.load();
+    }
+
+    // Au-delà, la rafale est traitée avec les frames déjà reçues
+    ma_tick_t burstDeadline() const {
+        return burst_deadline_;
     }
 
     void setCaptureInProgress() {
@@ -76,8 +85,13 @@ protected:
 
     // Méthodes privées pour découpage logique de threadEntry
     bool fetchAndValidateFrame(videoFrame*& frame);
-    void processCaptureRequest(videoFrame* frame, ma_tick_t& last_debug, std::string tubeType);
+    videoFrame* fetchTransformedFrame(ma_tick_t since, ma_tick_t timeout);
+    void releaseTransformedFrames();
+    void processCaptureRequest(videoFrame* frame, ma_tick_t& last_debug, std::string tubeType, bool hardware_frame = true);
     void handleNoCaptureRequested(videoFrame* frame);
+    void collectBurstFrame(videoFrame* frame, ma_tick_t& last_debug);
+    void selectBurst(ma_tick_t& last_debug);
+    void releaseBurst();
 
 protected:
     int32_t output_width_;   // Largeur cible (640 par défaut)
@@ -90,6 +104,7 @@ protected:
     bool debug_;                             // Mode debug pour afficher des informations supplémentaires
     int saved_image_count_;                  // Compteur pour les images sauvegardées
     std::atomic<bool> capture_requested_;    // Nouveau flag pour indiquer si la capture est demandée par l'utilisateur
+    ma_tick_t capture_requested_at_;         // Les frames VPSS plus anciennes que la demande sont périmées
     std::atomic<bool> capture_in_progress_;  // Flag pour indiquer si le traitement est en cours
     std::atomic<bool> capture_done_;         // Flag pour indiquer si le traitement est terminé
     std::string tube_type_;
@@ -106,10 +121,35 @@ protected:
     unsigned int pre_capture_delay_ms_;  // Délai avant capture
     bool disable_red_led_blinking_;      // Désactiver le clignotement de la LED rouge
 
+    // Rafale : seules la meilleure frame éclairée et la meilleure frame sans flash sont gardées
+    struct BurstShot {
+        videoFrame* frame = nullptr;
+        double brightness = 0.0;
+        double sharpness  = 0.0;
+    };
+    std::atomic<bool> burst_active_;
+    int burst_frames_;          // Nombre de frames de la rafale
+    int burst_dark_;            // Frames prises avant l'allumage du flash
+    int burst_count_;           // Frames déjà reçues
+    int burst_intensity_;       // Intensité du flash pendant la rafale
+    bool burst_flash_;          // Allumer le flash pendant la rafale
+    bool burst_keep_dark_;      // Traiter aussi la meilleure frame sans flash (mode dataset)
+    double burst_peak_;         // Luminosité maximale des frames éclairées
+    ma_tick_t burst_start_;     // Les frames plus anciennes que la demande sont ignorées
+    ma_tick_t burst_flash_at_;  // Allumage du flash, 0 tant qu'il est éteint
+    ma_tick_t burst_deadline_;  // Une frame manquante ne bloque pas la capture
+    BurstShot burst_lit_;
+    BurstShot burst_unlit_;
+
 
     // Nouveau membre pour stocker le canal à utiliser
     int channel_;
 
+    // Canal RAW recadré, tourné et redimensionné par le VPSS pour l'IA, le canal attaché reste en
+    // pleine résolution pour les ROI des codes-barres
+    bool hardware_transform_;
+    MessageBox transformed_frame_;
+
     // Nouveau membre pour le traitement AI
     AIModelProcessor* ai_processor_;
     std::string ai_model_path_;
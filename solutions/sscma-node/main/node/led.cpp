@@ -1,6 +1,6 @@
 #include "led.h"
 
-#include <fstream>
+#include <fcntl.h>
 #include <stdexcept>
 #include <unistd.h>
 
@@ -8,47 +8,185 @@ namespace ma::node {
 
 static constexpr char LED_TAG[] = "ma::node::led";
 
-Led::Led(const std::string& led_name) : path("/sys/class/leds/" + led_name + "/") {}
+LedController::LedController(const std::string& root) : root_(root), signal_(0), scheduler_(nullptr), scheduling_(false) {
+    if (!root_.empty() && root_.back() != '/') {
+        root_ += '/';
+    }
+    scheduler_ = new Thread("led", schedulerEntryStub);
+    MA_ASSERT(scheduler_);
+}
 
-void Led::write(const std::string& attr, const std::string& value) {
-    std::ofstream fs(path + attr);
-    if (!fs.is_open()) {
-        MA_LOGW(LED_TAG, "Impossible d'ouvrir %s%s", path.c_str(), attr.c_str());
-        return;
+LedController::~LedController() {
+    stop();
+    for (auto& led : leds_) {
+        for (auto& fd : led.second.fds) {
+            ::close(fd.second);
+        }
     }
-    fs << value;
+    delete scheduler_;
 }
 
-int Led::getMaxBrightness() {
-    std::ifstream fs(path + "max_brightness");
-    if (!fs.is_open()) {
-        MA_LOGW(LED_TAG, "Impossible de lire max_brightness pour %s", path.c_str());
-        return 255;  // Valeur par défaut si non disponible
+LedController& LedController::instance() {
+    static LedController controller;
+    return controller;
+}
+
+int LedController::descriptor(Handle& handle, const std::string& led_name, const std::string& attr) {
+    auto it = handle.fds.find(attr);
+    if (it != handle.fds.end()) {
+        return it->second;
     }
-    int max = 255;
-    fs >> max;
-    return max;
+    // max_brightness est en lecture seule dans sysfs, l'ouvrir en écriture échoue
+    int flags = attr == "max_brightness" ? O_RDONLY : O_WRONLY;
+    int fd    = ::open((root_ + led_name + "/" + attr).c_str(), flags | O_CLOEXEC);
+    if (fd < 0) {
+        MA_LOGW(LED_TAG, "Impossible d'ouvrir %s%s/%s", root_.c_str(), led_name.c_str(), attr.c_str());
+        return -1;
+    }
+    handle.fds[attr] = fd;
+    return fd;
 }
 
-void Led::turnOn(int intensity) {
-    write("trigger", "none");  // désactive tout trigger
+bool LedController::writeLocked(const std::string& led_name, const std::string& attr, const std::string& value) {
+    Handle& handle = leds_[led_name];
+    int fd         = descriptor(handle, led_name, attr);
+    if (fd < 0) {
+        return false;
+    }
+    // sysfs ignore la troncature, un dossier ordinaire garderait sinon la fin d'une valeur plus longue
+    int truncated = ::ftruncate(fd, 0);
+    (void)truncated;
+    if (::pwrite(fd, value.data(), value.size(), 0) != static_cast<ssize_t>(value.size())) {
+        // le descripteur est rouvert au prochain appel
+        MA_LOGW(LED_TAG, "Échec d'écriture de %s dans %s%s/%s", value.c_str(), root_.c_str(), led_name.c_str(), attr.c_str());
+        ::close(fd);
+        handle.fds.erase(attr);
+        return false;
+    }
+    if (attr == "trigger") {
+        handle.trigger = value;
+    }
+    return true;
+}
 
+int LedController::maxBrightnessLocked(const std::string& led_name) {
+    Handle& handle = leds_[led_name];
+    if (handle.max_brightness < 0) {
+        char buf[16] = {0};
+        int fd       = descriptor(handle, led_name, "max_brightness");
+        int max      = fd < 0 || ::pread(fd, buf, sizeof(buf) - 1, 0) <= 0 ? 0 : atoi(buf);
+        if (max <= 0) {
+            MA_LOGW(LED_TAG, "Impossible de lire max_brightness pour %s", led_name.c_str());
+            max = 255;  // Valeur par défaut si non disponible
+        }
+        handle.max_brightness = max;
+    }
+    return handle.max_brightness;
+}
+
+bool LedController::setLocked(const std::string& led_name, bool turn_on, int intensity) {
+    if (!turn_on) {
+        return writeLocked(led_name, "brightness", "0");
+    }
+    // désactive tout trigger, une seule fois
+    if (leds_[led_name].trigger != "none" && !writeLocked(led_name, "trigger", "none")) {
+        return false;
+    }
     // Si l'intensité n'est pas spécifiée, utiliser la valeur maximale
     if (intensity < 0) {
-        intensity = getMaxBrightness();
+        intensity = maxBrightnessLocked(led_name);
+    }
+    return writeLocked(led_name, "brightness", std::to_string(intensity));
+}
+
+bool LedController::write(const std::string& led_name, const std::string& attr, const std::string& value) {
+    Guard guard(mutex_);
+    return writeLocked(led_name, attr, value);
+}
+
+int LedController::maxBrightness(const std::string& led_name) {
+    Guard guard(mutex_);
+    return maxBrightnessLocked(led_name);
+}
+
+bool LedController::set(const std::string& led_name, bool turn_on, int intensity) {
+    Guard guard(mutex_);
+    leds_[led_name].off_at = 0;
+    return setLocked(led_name, turn_on, intensity);
+}
+
+bool LedController::flash(const std::string& led_name, int intensity, unsigned int duration_ms) {
+    Guard guard(mutex_);
+    if (!setLocked(led_name, true, intensity)) {
+        return false;
+    }
+    leds_[led_name].off_at = Tick::current() + Tick::fromMilliseconds(duration_ms);
+    if (!scheduling_.exchange(true)) {
+        scheduler_->start(this);
+    }
+    signal_.signal();
+    return true;
+}
+
+void LedController::stop() {
+    if (scheduling_.exchange(false)) {
+        signal_.signal();
+        scheduler_->join();
+    }
+}
+
+void LedController::schedulerEntry() {
+    while (true) {
+        bool scheduling = scheduling_.load();
+        ma_tick_t wait  = Tick::fromMilliseconds(100);
+        {
+            Guard guard(mutex_);
+            ma_tick_t now = Tick::current();
+            for (auto& led : leds_) {
+                ma_tick_t off_at = led.second.off_at;
+                if (off_at == 0) {
+                    continue;
+                }
+                // à l'arrêt les flashs en attente sont éteints tout de suite
+                if (off_at <= now || !scheduling) {
+                    led.second.off_at = 0;
+                    setLocked(led.first, false);
+                } else if (off_at - now < wait) {
+                    wait = off_at - now;
+                }
+            }
+        }
+        if (!scheduling) {
+            break;
+        }
+        signal_.wait(wait);
     }
+}
 
-    write("brightness", std::to_string(intensity));
+void LedController::schedulerEntryStub(void* obj) {
+    reinterpret_cast<LedController*>(obj)->schedulerEntry();
+}
+
+Led::Led(const std::string& led_name) : name(led_name) {}
+
+void Led::write(const std::string& attr, const std::string& value) {
+    LedController::instance().write(name, attr, value);
+}
+
+int Led::getMaxBrightness() {
+    return LedController::instance().maxBrightness(name);
+}
+
+void Led::turnOn(int intensity) {
+    LedController::instance().set(name, true, intensity);
 }
 
 void Led::turnOff() {
-    write("brightness", "0");
+    LedController::instance().set(name, false);
 }
 
 void Led::flash(int intensity, unsigned int delay_ms) {
-    turnOn(intensity);
-    usleep(delay_ms * 1000);
-    turnOff();
+    LedController::instance().flash(name, intensity, delay_ms);
 }
 
 // Implémentation des nouvelles méthodes statiques
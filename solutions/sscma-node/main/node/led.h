@@ -2,15 +2,90 @@
 
 #include <string>
 #include <atomic>
+#include <map>
 #include "node.h"
 
 namespace ma::node {
 
+/**
+ * @brief Accès aux LEDs par des descripteurs sysfs gardés ouverts
+ *
+ * Chaque attribut est ouvert une seule fois puis réécrit en place, max_brightness est lu à la
+ * première utilisation et le trigger "none" n'est écrit qu'une fois. Les flashs minutés sont
+ * éteints par un thread dédié, l'appelant ne dort jamais.
+ */
+class LedController {
+public:
+    /**
+     * @brief Constructeur
+     * @param root Dossier des LEDs, un dossier ordinaire peut remplacer sysfs pour les tests
+     */
+    explicit LedController(const std::string& root = "/sys/class/leds/");
+    ~LedController();
+
+    /**
+     * @brief Contrôleur partagé sur /sys/class/leds/
+     */
+    static LedController& instance();
+
+    /**
+     * @brief Écrit une valeur dans un attribut de la LED
+     * @return True si l'écriture a réussi
+     */
+    bool write(const std::string& led_name, const std::string& attr, const std::string& value);
+
+    /**
+     * @brief Luminosité maximale de la LED, lue une seule fois (255 si illisible)
+     */
+    int maxBrightness(const std::string& led_name);
+
+    /**
+     * @brief Allume ou éteint la LED, un flash en attente sur cette LED est annulé
+     * @param intensity Intensité de la lumière (-1 pour utiliser la valeur maximale)
+     */
+    bool set(const std::string& led_name, bool turn_on, int intensity = -1);
+
+    /**
+     * @brief Allume la LED et programme son extinction sans bloquer l'appelant
+     * @param intensity Intensité de la lumière (-1 pour utiliser la valeur maximale)
+     * @param duration_ms Durée en millisecondes
+     */
+    bool flash(const std::string& led_name, int intensity, unsigned int duration_ms);
+
+    /**
+     * @brief Éteint les flashs en attente et arrête le thread d'extinction
+     */
+    void stop();
+
+private:
+    struct Handle {
+        std::map<std::string, int> fds;  // Descripteurs ouverts par attribut
+        int max_brightness = -1;         // -1 tant que non lu
+        std::string trigger;             // Dernier trigger écrit
+        ma_tick_t off_at = 0;            // Extinction programmée, 0 si aucune
+    };
+
+    int descriptor(Handle& handle, const std::string& led_name, const std::string& attr);
+    bool writeLocked(const std::string& led_name, const std::string& attr, const std::string& value);
+    bool setLocked(const std::string& led_name, bool turn_on, int intensity = -1);
+    int maxBrightnessLocked(const std::string& led_name);
+
+    void schedulerEntry();
+    static void schedulerEntryStub(void* obj);
+
+    std::string root_;
+    std::map<std::string, Handle> leds_;
+    Mutex mutex_;
+    Semaphore signal_;
+    Thread* scheduler_;
+    std::atomic<bool> scheduling_;
+};
+
 /**
  * @brief Classe pour contrôler les LEDs de la ReCamera
  * 
  * Cette classe permet d'allumer, éteindre et faire clignoter les LEDs
- * en accédant aux fichiers du système dans /sys/class/leds/
+ * en accédant aux fichiers du système dans /sys/class/leds/ par le LedController partagé
  */
 class Led {
 public:
@@ -45,7 +120,7 @@ public:
     void turnOff();
     
     /**
-     * @brief Fait clignoter la LED
+     * @brief Fait clignoter la LED, l'extinction est programmée et l'appel rend la main tout de suite
      * @param intensity Intensité de la lumière (-1 pour utiliser la valeur maximale)
      * @param delay_ms Durée en millisecondes
      */
@@ -69,7 +144,7 @@ public:
     static bool controlAllLeds(bool turn_on, int intensity = -1);
     
     /**
-     * @brief Fait clignoter une LED spécifique
+     * @brief Fait clignoter une LED spécifique sans bloquer l'appelant
      * @param led_name Nom de la LED (ex: "white", "red", "blue")
      * @param intensity Intensité de la lumière (-1 pour utiliser la valeur maximale)
      * @param duration_ms Durée en millisecondes
@@ -78,7 +153,7 @@ public:
     static bool flashLed(const std::string& led_name, int intensity = -1, unsigned int duration_ms = 200);
 
 private:
-    std::string path; // Chemin vers les fichiers de contrôle de la LED
+    std::string name; // Nom de la LED dans /sys/class/leds/
 };
 
 } // namespace ma::node
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "model.h"
+#include "stats.h"
 
 using namespace ma::engine;
 using namespace ma::model;
@@ -14,6 +15,50 @@ static constexpr char TAG[] = "ma::node::model";
 
 #define DEFAULT_MODEL "/userdata/MODEL/model.cvimodel"
 
+// compact encoding of the invoke events on the websocket, see docs/sscma-node-protocol.md
+#define BINARY_MAGIC "MB"
+#define BINARY_VERSION 1
+#define BINARY_KIND_LABELS 1
+#define BINARY_KIND_RESULT 2
+#define BINARY_FLAG_TRACKS 0x01
+#define BINARY_FLAG_IMAGE 0x02
+
+static inline void put8(std::string& packet, uint8_t value) {
+    packet.push_back(static_cast<char>(value));
+}
+
+static inline void put16(std::string& packet, uint16_t value) {
+    packet.push_back(static_cast<char>(value & 0xFF));
+    packet.push_back(static_cast<char>(value >> 8));
+}
+
+static inline void put32(std::string& packet, uint32_t value) {
+    put16(packet, value & 0xFFFF);
+    put16(packet, value >> 16);
+}
+
+static void putHeader(std::string& packet, uint8_t kind, uint32_t count, uint16_t width, uint16_t height, uint16_t items, uint8_t type, uint8_t flags) {
+    packet.append(BINARY_MAGIC, 2);
+    put8(packet, BINARY_VERSION);
+    put8(packet, kind);
+    put32(packet, count);
+    put16(packet, width);
+    put16(packet, height);
+    put16(packet, items);
+    put8(packet, type);
+    put8(packet, flags);
+}
+
+// [x, y, w, h, score, target] as filled by fillReply
+static void putBox(std::string& packet, const json& box) {
+    for (int i = 0; i < 4; i++) {
+        put16(packet, static_cast<uint16_t>(box[i].get<int16_t>()));
+    }
+    put8(packet, static_cast<uint8_t>(box[4].get<int8_t>()));
+    put8(packet, 0);
+    put16(packet, box[5].get<uint16_t>());
+}
+
 ModelNode::ModelNode(std::string id)
     : Node("model", id),
       uri_(""),
@@ -25,16 +70,395 @@ ModelNode::ModelNode(std::string id)
       algorithm_(0),
       engine_(nullptr),
       model_(nullptr),
+      pipeline_(nullptr),
+      cascade_(nullptr),
+      cascade_engine_(nullptr),
+      cascade_max_(16),
+      cascade_padding_(0.0f),
+      cascade_width_(0),
+      cascade_height_(0),
+      ttfi_start_(0),
+      simplify_(0.0f),
       thread_(nullptr),
       raw_frame_(1),
       jpeg_frame_(1),
       websocket_(true),
+      encoding_("json"),
+      labels_generation_(0),
       transport_(nullptr),
       camera_(nullptr) {}
 
 ModelNode::~ModelNode() {
     onDestroy();
 }
+
+ma_err_t ModelNode::invoke(Model* model, const ma_img_t* img) {
+    switch (model->getOutputType()) {
+        case MA_OUTPUT_TYPE_BBOX:
+            return static_cast<Detector*>(model)->run(img);
+        case MA_OUTPUT_TYPE_CLASS:
+            return static_cast<Classifier*>(model)->run(img);
+        case MA_OUTPUT_TYPE_KEYPOINT:
+            return static_cast<PoseDetector*>(model)->run(img);
+        case MA_OUTPUT_TYPE_SEGMENT:
+            return static_cast<Segmentor*>(model)->run(img);
+        default:
+            return MA_ENOTSUP;
+    }
+}
+
+void ModelNode::classify(const videoFrame* source, const std::vector<ma_bbox_t>& bboxes, json& reply) {
+    const ma_img_t* input = static_cast<const ma_img_t*>(cascade_->getInput());
+    const int cols        = source->img.width;
+    const int rows        = source->img.height;
+
+    if (source->img.format != MA_PIXEL_FORMAT_RGB888 || source->img.data == nullptr) {
+        return;
+    }
+
+    ::cv::Mat frame(rows, cols, CV_8UC3, source->img.data);
+
+    cascade_crop_.resize(input->width * input->height * 3);
+    ::cv::Mat crop(input->height, input->width, CV_8UC3, cascade_crop_.data());
+
+    ma_img_t img = {
+        .size     = static_cast<uint32_t>(cascade_crop_.size()),
+        .width    = input->width,
+        .height   = input->height,
+        .format   = MA_PIXEL_FORMAT_RGB888,
+        .rotate   = MA_PIXEL_ROTATE_0,
+        .physical = false,
+        .data     = cascade_crop_.data(),
+    };
+
+    Classifier* classifier     = static_cast<Classifier*>(cascade_);
+    reply["data"]["cascade"]   = json::array();
+    reply["data"]["cascade_perf"] = json::array();
+
+    // all the crops of the frame go through the secondary model back to back
+    for (size_t i = 0; i < bboxes.size(); ++i) {
+        if (i >= static_cast<size_t>(cascade_max_)) {
+            reply["data"]["cascade"].push_back(json::array());
+            reply["data"]["cascade_perf"].push_back(json::array());
+            continue;
+        }
+
+        const ma_bbox_t& box = bboxes[i];
+        float w              = box.w * (1.0f + cascade_padding_);
+        float h              = box.h * (1.0f + cascade_padding_);
+        int x1               = std::clamp(static_cast<int>((box.x - w / 2) * cols), 0, cols - 1);
+        int y1               = std::clamp(static_cast<int>((box.y - h / 2) * rows), 0, rows - 1);
+        int x2               = std::clamp(static_cast<int>((box.x + w / 2) * cols), x1 + 1, cols);
+        int y2               = std::clamp(static_cast<int>((box.y + h / 2) * rows), y1 + 1, rows);
+
+        ::cv::resize(frame(::cv::Rect(x1, y1, x2 - x1, y2 - y1)), crop, crop.size(), 0, 0, ::cv::INTER_LINEAR);
+
+        ma_err_t err     = classifier->run(&img);
+        const auto _perf = classifier->getPerf();
+        // one perf entry per box, even when the classifier found nothing
+        reply["data"]["cascade_perf"].push_back({_perf.preprocess, _perf.inference, _perf.postprocess});
+
+        if (err != MA_OK || classifier->getResultSpan().empty()) {
+            reply["data"]["cascade"].push_back(json::array());
+            continue;
+        }
+
+        const auto& result = classifier->getResultSpan().front();
+        reply["data"]["cascade"].push_back({static_cast<int8_t>(result.score * 100), result.target});
+
+        // the secondary label refines the detector one
+        if (i < reply["data"]["labels"].size()) {
+            if (cascade_labels_.size() > result.target) {
+                reply["data"]["labels"][i] = cascade_labels_[result.target];
+            } else {
+                reply["data"]["labels"][i] = std::string("N/A-" + std::to_string(result.target));
+            }
+        }
+    }
+}
+
+void ModelNode::fillReply(Model* model, json& reply, int32_t width, int32_t height, const videoFrame* source) {
+
+    if (ttfi_start_ != 0) {
+        MA_LOGI(TAG, "time to first inference: %u ms, peak rss %zu kB", Tick::toMilliseconds(Tick::current() - ttfi_start_), MappedModel::peakRss());
+        ttfi_start_ = 0;
+    }
+
+    reply["data"]["labels"] = json::array();
+
+    if (model->getOutputType() == MA_OUTPUT_TYPE_BBOX) {
+        Detector* detector     = static_cast<Detector*>(model);
+        auto _results          = detector->getResultSpan();
+        reply["data"]["boxes"] = json::array();
+        // the tracker updates the boxes in place, keep a copy with retained capacity
+        std::vector<ma_bbox_t>& _bboxes = bboxes_;
+        _bboxes.assign(_results.begin(), _results.end());
+        if (trace_) {
+            auto tracks             = tracker_.inplace_update(_bboxes);
+            reply["data"]["tracks"] = tracks;
+            for (int i = 0; i < _bboxes.size(); i++) {
+                reply["data"]["boxes"].push_back({static_cast<int16_t>(_bboxes[i].x * width),
+                                                  static_cast<int16_t>(_bboxes[i].y * height),
+                                                  static_cast<int16_t>(_bboxes[i].w * width),
+                                                  static_cast<int16_t>(_bboxes[i].h * height),
+                                                  static_cast<int8_t>(_bboxes[i].score * 100),
+                                                  _bboxes[i].target});
+                if (labels_.size() > _bboxes[i].target) {
+                    reply["data"]["labels"].push_back(labels_[_bboxes[i].target]);
+                } else {
+                    reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(_bboxes[i].target)));
+                }
+                if (counting_) {
+                    counter_.update(tracks[i], _bboxes[i].x * 100, _bboxes[i].y * 100);
+                }
+            }
+            if (counting_ && _bboxes.size() == 0) {
+                counter_.update(-1, 0, 0);
+            }
+        } else {
+            for (int i = 0; i < _bboxes.size(); i++) {
+                reply["data"]["boxes"].push_back({static_cast<int16_t>(_bboxes[i].x * width),
+                                                  static_cast<int16_t>(_bboxes[i].y * height),
+                                                  static_cast<int16_t>(_bboxes[i].w * width),
+                                                  static_cast<int16_t>(_bboxes[i].h * height),
+                                                  static_cast<int8_t>(_bboxes[i].score * 100),
+                                                  _bboxes[i].target});
+                if (labels_.size() > _bboxes[i].target) {
+                    reply["data"]["labels"].push_back(labels_[_bboxes[i].target]);
+                } else {
+                    reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(_bboxes[i].target)));
+                }
+            }
+        }
+        if (cascade_ != nullptr && source != nullptr) {
+            classify(source, _bboxes, reply);
+        }
+        if (counting_) {
+            reply["data"]["counts"] = counter_.get();
+            reply["data"]["lines"]  = json::array();
+            reply["data"]["lines"].push_back(counter_.getSplitter());
+        }
+    } else if (model->getOutputType() == MA_OUTPUT_TYPE_CLASS) {
+        Classifier* classifier   = static_cast<Classifier*>(model);
+        auto _results            = classifier->getResultSpan();
+        reply["data"]["classes"] = json::array();
+        for (auto& result : _results) {
+            reply["data"]["classes"].push_back({static_cast<int8_t>(result.score * 100), result.target});
+            if (labels_.size() > result.target) {
+                reply["data"]["labels"].push_back(labels_[result.target]);
+            } else {
+                reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(result.target)));
+            }
+        }
+    } else if (model->getOutputType() == MA_OUTPUT_TYPE_KEYPOINT) {
+        PoseDetector* pose_detector = static_cast<PoseDetector*>(model);
+        auto _results               = pose_detector->getResultSpan();
+        reply["data"]["keypoints"]  = json::array();
+        for (auto& result : _results) {
+            json pts = json::array();
+            for (auto& pt : result.pts) {
+                pts.push_back({static_cast<int16_t>(pt.x * width), static_cast<int16_t>(pt.y * height), static_cast<int8_t>(pt.z * 100)});
+            }
+            json box = {static_cast<int16_t>(result.box.x * width),
+                        static_cast<int16_t>(result.box.y * height),
+                        static_cast<int16_t>(result.box.w * width),
+                        static_cast<int16_t>(result.box.h * height),
+                        static_cast<int8_t>(result.box.score * 100),
+                        result.box.target};
+            if (labels_.size() > result.box.target) {
+                reply["data"]["labels"].push_back(labels_[result.box.target]);
+            } else {
+                reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(result.box.target)));
+            }
+            reply["data"]["keypoints"].push_back({box, pts});
+        }
+    } else if (model->getOutputType() == MA_OUTPUT_TYPE_SEGMENT) {
+        Segmentor* segmentor      = static_cast<Segmentor*>(model);
+        auto _results             = segmentor->getResultSpan();
+        reply["data"]["segments"] = json::array();
+        for (auto& result : _results) {
+            json box = {static_cast<int16_t>(result.box.x * width),
+                        static_cast<int16_t>(result.box.y * height),
+                        static_cast<int16_t>(result.box.w * width),
+                        static_cast<int16_t>(result.box.h * height),
+                        static_cast<int8_t>(result.box.score * 100),
+                        result.box.target};
+            if (labels_.size() > result.box.target) {
+                reply["data"]["labels"].push_back(labels_[result.box.target]);
+            } else {
+                reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(result.box.target)));
+            }
+
+            std::vector<uint16_t> contour;
+            if (result.mask.width > 0 && result.mask.height > 0) {
+                mask_tracer_.largest(result.mask.data.data(),
+                                     result.mask.width,
+                                     result.mask.height,
+                                     static_cast<float>(width) / result.mask.width,
+                                     static_cast<float>(height) / result.mask.height,
+                                     simplify_,
+                                     contour);
+            }
+            reply["data"]["segments"].push_back({box, contour});
+        }
+    }
+
+    const auto _perf = model->getPerf();
+
+    reply["data"]["perf"].push_back({_perf.preprocess, _perf.inference, _perf.postprocess});
+}
+
+void ModelNode::encodeLabels(std::string& packet) {
+    uint8_t type = static_cast<uint8_t>(model_->getOutputType() >> 8);
+    uint16_t items = static_cast<uint16_t>(std::min<size_t>(labels_.size(), UINT16_MAX));
+
+    packet.clear();
+    putHeader(packet, BINARY_KIND_LABELS, 0, 0, 0, items, type, 0);
+    for (uint16_t i = 0; i < items; i++) {
+        uint8_t length = static_cast<uint8_t>(std::min<size_t>(labels_[i].size(), UINT8_MAX));
+        put8(packet, length);
+        packet.append(labels_[i].data(), length);
+    }
+}
+
+void ModelNode::encodeResult(const json& reply, const videoFrame* jpeg, std::string& packet) {
+    const json& data = reply["data"];
+    uint8_t type     = static_cast<uint8_t>(model_->getOutputType() >> 8);
+    const char* key  = "boxes";
+    switch (model_->getOutputType()) {
+        case MA_OUTPUT_TYPE_CLASS:
+            key = "classes";
+            break;
+        case MA_OUTPUT_TYPE_KEYPOINT:
+            key = "keypoints";
+            break;
+        case MA_OUTPUT_TYPE_SEGMENT:
+            key = "segments";
+            break;
+        default:
+            break;
+    }
+    static const json empty = json::array();
+    const json& results     = data.contains(key) ? data[key] : empty;
+    bool tracks             = data.contains("tracks") && data["tracks"].size() == results.size();
+    uint8_t flags           = (tracks ? BINARY_FLAG_TRACKS : 0) | (jpeg != nullptr ? BINARY_FLAG_IMAGE : 0);
+
+    packet.clear();
+    putHeader(packet,
+              BINARY_KIND_RESULT,
+              data["count"].get<uint32_t>(),
+              data["resolution"][0].get<uint16_t>(),
+              data["resolution"][1].get<uint16_t>(),
+              static_cast<uint16_t>(results.size()),
+              type,
+              flags);
+
+    const json& perf = data["perf"][0];
+    for (int i = 0; i < 3; i++) {
+        put16(packet, static_cast<uint16_t>(std::min<int64_t>(perf[i].get<int64_t>(), UINT16_MAX)));
+    }
+
+    for (const auto& result : results) {
+        switch (model_->getOutputType()) {
+            case MA_OUTPUT_TYPE_CLASS:
+                put8(packet, static_cast<uint8_t>(result[0].get<int8_t>()));
+                put8(packet, 0);
+                put16(packet, result[1].get<uint16_t>());
+                break;
+            case MA_OUTPUT_TYPE_KEYPOINT:
+                putBox(packet, result[0]);
+                put16(packet, static_cast<uint16_t>(result[1].size()));
+                for (const auto& pt : result[1]) {
+                    put16(packet, static_cast<uint16_t>(pt[0].get<int16_t>()));
+                    put16(packet, static_cast<uint16_t>(pt[1].get<int16_t>()));
+                    put8(packet, static_cast<uint8_t>(pt[2].get<int8_t>()));
+                    put8(packet, 0);
+                }
+                break;
+            case MA_OUTPUT_TYPE_SEGMENT:
+                putBox(packet, result[0]);
+                put16(packet, static_cast<uint16_t>(result[1].size()));
+                for (const auto& value : result[1]) {
+                    put16(packet, value.get<uint16_t>());
+                }
+                break;
+            default:
+                putBox(packet, result);
+                break;
+        }
+    }
+
+    if (tracks) {
+        for (const auto& track : data["tracks"]) {
+            put32(packet, static_cast<uint32_t>(track.get<int32_t>()));
+        }
+    }
+
+    if (jpeg != nullptr) {
+        put32(packet, jpeg->img.size);
+        packet.append(reinterpret_cast<const char*>(jpeg->img.data), jpeg->img.size);
+    }
+}
+
+void ModelNode::publish(json& reply, videoFrame* jpeg) {
+    if (websocket_ && transport_->wants("binary")) {
+        // the label table goes out once per model, and again when a client joins
+        uint32_t generation = transport_->generation();
+        if (generation != labels_generation_) {
+            encodeLabels(packet_);
+            transport_->send(packet_.data(), packet_.size(), "binary", false);
+            labels_generation_ = generation;
+        }
+        encodeResult(reply, jpeg, packet_);
+        transport_->send(packet_.data(), packet_.size(), "binary");
+    }
+
+    bool text = websocket_ && transport_->wants("json");
+    if (debug_ && jpeg != nullptr && (text || output_)) {
+        char* base64   = new char[4 * ((jpeg->img.size + 2) / 3 + 2)];
+        int base64_len = 4 * ((jpeg->img.size + 2) / 3 + 2);
+        ma::utils::base64_encode(jpeg->img.data, jpeg->img.size, base64, &base64_len);
+        reply["data"]["image"] = std::string(base64, base64_len);
+        delete[] base64;
+    } else {
+        reply["data"]["image"] = "";
+    }
+
+    if (text) {
+        std::string payload = reply.dump();
+        transport_->send(payload.c_str(), payload.size(), "json");
+    }
+    if (!output_) {
+        reply["data"]["image"] = "";
+    }
+    server_->response(id_, reply);
+}
+
+void ModelNode::onPipelineDone(Model* model, ma_err_t err, void* ctx) {
+    Invocation* invocation = static_cast<Invocation*>(ctx);
+
+    if (invocation->raw != nullptr) {
+        invocation->raw->release();
+        invocation->raw = nullptr;
+    }
+
+    if (err == MA_OK) {
+        fillReply(model, invocation->reply, invocation->width, invocation->height);
+        publish(invocation->reply, invocation->jpeg);
+        // the frame is measured from its submit to its completion, not the enqueue alone
+        if (invocation->submitted != 0) {
+            NodeStats::record(id_, invocation->timestamp, invocation->submitted);
+        }
+    } else if (err != MA_EBUSY) {
+        MA_LOGW(TAG, "pipelined invoke %d failed: %d", invocation->reply["data"]["count"].get<int32_t>(), err);
+    }
+
+    if (invocation->jpeg != nullptr) {
+        invocation->jpeg->release();
+    }
+    delete invocation;
+}
+
 void ModelNode::threadEntry() {
 
     ma_err_t err     = MA_OK;
@@ -66,6 +490,7 @@ void ModelNode::threadEntry() {
 
         Thread::enterCritical();
 
+        NodeStats::Scope scope(id_, raw->timestamp);
         ma_tick_t start = Tick::current();
 
         json reply = json::object({{"type", MA_MSG_TYPE_EVT}, {"name", "invoke"}, {"code", MA_OK}, {"data", {{"count", ++count_}}}});
@@ -87,167 +512,53 @@ void ModelNode::threadEntry() {
         };
 
         tensor.data.data = reinterpret_cast<void*>(raw->img.data);
-        engine_->setInput(0, tensor);
-        model_->setPreprocessDone([this, raw](void* ctx) { raw->release(); });
-
-        reply["data"]["labels"] = json::array();
-
-        if (model_->getOutputType() == MA_OUTPUT_TYPE_BBOX) {
-            Detector* detector     = static_cast<Detector*>(model_);
-            err                    = detector->run(nullptr);
-            auto _results          = detector->getResults();
-            reply["data"]["boxes"] = json::array();
-            std::vector<ma_bbox_t> _bboxes;
-            _bboxes.assign(_results.begin(), _results.end());
-            if (trace_) {
-                auto tracks             = tracker_.inplace_update(_bboxes);
-                reply["data"]["tracks"] = tracks;
-                for (int i = 0; i < _bboxes.size(); i++) {
-                    reply["data"]["boxes"].push_back({static_cast<int16_t>(_bboxes[i].x * width),
-                                                      static_cast<int16_t>(_bboxes[i].y * height),
-                                                      static_cast<int16_t>(_bboxes[i].w * width),
-                                                      static_cast<int16_t>(_bboxes[i].h * height),
-                                                      static_cast<int8_t>(_bboxes[i].score * 100),
-                                                      _bboxes[i].target});
-                    if (labels_.size() > _bboxes[i].target) {
-                        reply["data"]["labels"].push_back(labels_[_bboxes[i].target]);
-                    } else {
-                        reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(_bboxes[i].target)));
-                    }
-                    if (counting_) {
-                        counter_.update(tracks[i], _bboxes[i].x * 100, _bboxes[i].y * 100);
-                    }
-                }
-                if (counting_ && _bboxes.size() == 0) {
-                    counter_.update(-1, 0, 0);
-                }
-            } else {
-                for (int i = 0; i < _bboxes.size(); i++) {
-                    reply["data"]["boxes"].push_back({static_cast<int16_t>(_bboxes[i].x * width),
-                                                      static_cast<int16_t>(_bboxes[i].y * height),
-                                                      static_cast<int16_t>(_bboxes[i].w * width),
-                                                      static_cast<int16_t>(_bboxes[i].h * height),
-                                                      static_cast<int8_t>(_bboxes[i].score * 100),
-                                                      _bboxes[i].target});
-                    if (labels_.size() > _bboxes[i].target) {
-                        reply["data"]["labels"].push_back(labels_[_bboxes[i].target]);
-                    } else {
-                        reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(_bboxes[i].target)));
-                    }
+
+        if (pipeline_ != nullptr) {
+            // preprocess here, inference and postprocess overlap on the pipeline workers
+            Model* lane = pipeline_->acquire(Tick::fromSeconds(2));
+            if (lane == nullptr) {
+                raw->release();
+                if (debug_) {
+                    jpeg->release();
                 }
+                Thread::exitCritical();
+                continue;
             }
-            if (counting_) {
-                reply["data"]["counts"] = counter_.get();
-                reply["data"]["lines"]  = json::array();
-                reply["data"]["lines"].push_back(counter_.getSplitter());
-            }
-        } else if (model_->getOutputType() == MA_OUTPUT_TYPE_CLASS) {
-            Classifier* classifier   = static_cast<Classifier*>(model_);
-            err                      = classifier->run(nullptr);
-            auto _results            = classifier->getResults();
-            reply["data"]["classes"] = json::array();
-            for (auto& result : _results) {
-                reply["data"]["classes"].push_back({static_cast<int8_t>(result.score * 100), result.target});
-                if (labels_.size() > result.target) {
-                    reply["data"]["labels"].push_back(labels_[result.target]);
-                } else {
-                    reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(result.target)));
-                }
+            Invocation* invocation = new Invocation{raw, debug_ ? jpeg : nullptr, width, height, std::move(reply), raw->timestamp, scope.release()};
+            lane->getEngine()->setInput(0, tensor);
+            lane->setUserCtx(invocation);
+            err = invoke(lane);
+            if (err != MA_OK) {
+                MA_LOGW(TAG, "pipelined invoke failed: %d", err);
+                onPipelineDone(lane, MA_EBUSY, invocation);
+                pipeline_->release(lane);
             }
-        } else if (model_->getOutputType() == MA_OUTPUT_TYPE_KEYPOINT) {
-            PoseDetector* pose_detector = static_cast<PoseDetector*>(model_);
-            err                         = pose_detector->run(nullptr);
-            auto _results               = pose_detector->getResults();
-            reply["data"]["keypoints"]  = json::array();
-            for (auto& result : _results) {
-                json pts = json::array();
-                for (auto& pt : result.pts) {
-                    pts.push_back({static_cast<int16_t>(pt.x * width), static_cast<int16_t>(pt.y * height), static_cast<int8_t>(pt.z * 100)});
-                }
-                json box = {static_cast<int16_t>(result.box.x * width),
-                            static_cast<int16_t>(result.box.y * height),
-                            static_cast<int16_t>(result.box.w * width),
-                            static_cast<int16_t>(result.box.h * height),
-                            static_cast<int8_t>(result.box.score * 100),
-                            result.box.target};
-                if (labels_.size() > result.box.target) {
-                    reply["data"]["labels"].push_back(labels_[result.box.target]);
-                } else {
-                    reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(result.box.target)));
-                }
-                reply["data"]["keypoints"].push_back({box, pts});
-            }
-        } else if (model_->getOutputType() == MA_OUTPUT_TYPE_SEGMENT) {
-            Segmentor* segmentor      = static_cast<Segmentor*>(model_);
-            err                       = segmentor->run(nullptr);
-            auto _results             = segmentor->getResults();
-            reply["data"]["segments"] = json::array();
-            for (auto& result : _results) {
-                json box = {static_cast<int16_t>(result.box.x * width),
-                            static_cast<int16_t>(result.box.y * height),
-                            static_cast<int16_t>(result.box.w * width),
-                            static_cast<int16_t>(result.box.h * height),
-                            static_cast<int8_t>(result.box.score * 100),
-                            result.box.target};
-                if (labels_.size() > result.box.target) {
-                    reply["data"]["labels"].push_back(labels_[result.box.target]);
-                } else {
-                    reply["data"]["labels"].push_back(std::string("N/A-" + std::to_string(result.box.target)));
-                }
-
-                ::cv::Mat maskImage(result.mask.height, result.mask.width, CV_8UC1, ::cv::Scalar(0));
-
-                for (int i = 0; i < result.mask.height; ++i) {
-                    for (int j = 0; j < result.mask.width; ++j) {
-                        if (result.mask.data[i * result.mask.width / 8 + j / 8] & (1 << (j % 8))) {
-                            maskImage.at<uchar>(i, j) = 255;
-                        }
-                    }
-                }
-
-                std::vector<std::vector<::cv::Point>> contours;
-                std::vector<::cv::Vec4i> hierarchy;
-                ::cv::findContours(maskImage, contours, hierarchy, ::cv::RETR_EXTERNAL, ::cv::CHAIN_APPROX_SIMPLE);
-
-                auto maxContour = std::max_element(contours.begin(), contours.end(), [](std::vector<::cv::Point>& a, std::vector<::cv::Point>& b) { return a.size() < b.size(); });
+        } else {
+            if (cascade_ == nullptr) {
+                engine_->setInput(0, tensor);
+                model_->setPreprocessDone([this, raw](void* ctx) { raw->release(); });
 
-                std::vector<uint16_t> contour;
-                if (maxContour != contours.end()) {
-                    contour.reserve(maxContour->size() * 2);
-                    float w_scale = width / result.mask.width;
-                    float h_scale = height / result.mask.height;
-                    for (auto& c : *maxContour) {
-                        contour.push_back(static_cast<uint16_t>(c.x * w_scale));
-                        contour.push_back(static_cast<uint16_t>(c.y * h_scale));
-                    }
+                err = invoke(model_);
+                fillReply(model_, reply, width, height);
+            } else {
+                // the crops are taken from this frame, keep it until the secondary model is done
+                model_->setPreprocessDone(nullptr);
+                if (cascade_width_ != 0) {
+                    // full resolution frame, scaled down to the detector input by the preprocess
+                    err = invoke(model_, &raw->img);
+                } else {
+                    engine_->setInput(0, tensor);
+                    err = invoke(model_);
                 }
-                reply["data"]["segments"].push_back({box, contour});
+                fillReply(model_, reply, width, height, raw);
+                raw->release();
             }
-        }
+            publish(reply, debug_ ? jpeg : nullptr);
 
-
-        const auto _perf = model_->getPerf();
-
-        reply["data"]["perf"].push_back({_perf.preprocess, _perf.inference, _perf.postprocess});
-
-        if (debug_) {
-            char* base64   = new char[4 * ((jpeg->img.size + 2) / 3 + 2)];
-            int base64_len = 4 * ((jpeg->img.size + 2) / 3 + 2);
-            ma::utils::base64_encode(jpeg->img.data, jpeg->img.size, base64, &base64_len);
-            reply["data"]["image"] = std::string(base64, base64_len);
-            delete[] base64;
-            jpeg->release();
-        } else {
-            reply["data"]["image"] = "";
-        }
-
-        if (websocket_) {
-            transport_->send(reinterpret_cast<const char*>(reply.dump().c_str()), reply.dump().size());
-        }
-        if (!output_) {
-            reply["data"]["image"] = "";
+            if (debug_) {
+                jpeg->release();
+            }
         }
-        server_->response(id_, reply);
 
         ma_tick_t end = Tick::current();
         if (debug_ && (end - start < Tick::fromMilliseconds(100))) {
@@ -258,6 +569,47 @@ void ModelNode::threadEntry() {
     }
 }
 
+// the scheduler waits for the jobs of the engine still queued or running on the accelerator, an
+// engine it cannot detach is leaked rather than freed under a running job
+static void releaseEngine(Engine*& engine) {
+    if (engine == nullptr) {
+        return;
+    }
+    ma_err_t err = EngineScheduler::getInstance()->detach(engine);
+    if (err == MA_OK) {
+        delete engine;
+    } else {
+        MA_LOGE(TAG, "engine still in use (%d), not released", err);
+    }
+    engine = nullptr;
+}
+
+void ModelNode::releasePipeline() {
+    if (pipeline_ != nullptr) {
+        delete pipeline_;
+        pipeline_ = nullptr;
+    }
+    for (auto engine : lane_engines_) {
+        releaseEngine(engine);
+    }
+    // lanes_[0] is model_, released with the primary engine
+    for (size_t i = 1; i < lanes_.size(); ++i) {
+        delete lanes_[i];
+    }
+    lanes_.clear();
+    lane_engines_.clear();
+}
+
+void ModelNode::releaseCascade() {
+    releaseEngine(cascade_engine_);
+    if (cascade_ != nullptr) {
+        delete cascade_;
+        cascade_ = nullptr;
+    }
+    cascade_labels_.clear();
+    cascade_crop_.clear();
+}
+
 void ModelNode::threadEntryStub(void* obj) {
     reinterpret_cast<ModelNode*>(obj)->threadEntry();
 }
@@ -307,6 +659,8 @@ ma_err_t ModelNode::onCreate(const json& config) {
         labels_ = config["labels"].get<std::vector<std::string>>();
     }
 
+    ttfi_start_ = Tick::current();
+
     MA_TRY {
         engine_ = new EngineDefault();
 
@@ -326,14 +680,76 @@ ma_err_t ModelNode::onCreate(const json& config) {
 
         MA_LOGI(TAG, "model: %s %s", uri_.c_str(), model_->getName());
         {  // extra config
-            if (config.contains("tscore")) {
-                model_->setConfig(MA_MODEL_CFG_OPT_THRESHOLD, config["tscore"].get<float>());
+            if (config.contains("pipeline") && config["pipeline"].is_boolean() && config["pipeline"].get<bool>()) {
+                // each extra engine instance owns the tensors of a frame in flight, three lanes let the
+                // preprocess of frame N+1 and the postprocess of frame N-1 overlap the forward pass of frame N
+                int lanes = 3;
+                if (config.contains("pipeline_lanes") && config["pipeline_lanes"].is_number_integer()) {
+                    lanes = std::max(2, config["pipeline_lanes"].get<int>());
+                }
+                lanes_.push_back(model_);
+                for (int i = 1; i < lanes; ++i) {
+                    Engine* engine = new EngineDefault();
+                    if (engine == nullptr || engine->init() != MA_OK || engine->load(uri_) != MA_OK) {
+                        delete engine;
+                        MA_THROW(Exception(MA_EINVAL, "Pipeline engine load failed"));
+                    }
+                    lane_engines_.push_back(engine);
+                    Model* model = ModelFactory::create(engine, algorithm_);
+                    if (model == nullptr) {
+                        MA_THROW(Exception(MA_ENOTSUP, "Model not supported"));
+                    }
+                    lanes_.push_back(model);
+                }
             }
-            if (config.contains("tiou")) {
-                model_->setConfig(MA_MODEL_CFG_OPT_NMS, config["tiou"].get<float>());
+            if (config.contains("cascade") && config["cascade"].is_object()) {
+                const json& cascade = config["cascade"];
+                if (model_->getOutputType() != MA_OUTPUT_TYPE_BBOX || !lanes_.empty()) {
+                    MA_THROW(Exception(MA_ENOTSUP, "Cascade requires a detector without pipeline"));
+                }
+                if (!cascade.contains("uri") || !cascade["uri"].is_string() || access(cascade["uri"].get<std::string>().c_str(), R_OK) != 0) {
+                    MA_THROW(Exception(MA_ENOENT, "Cascade model file not found"));
+                }
+                std::string uri = cascade["uri"].get<std::string>();
+                cascade_engine_ = new EngineDefault();
+                if (cascade_engine_ == nullptr || cascade_engine_->init() != MA_OK || cascade_engine_->load(uri) != MA_OK) {
+                    MA_THROW(Exception(MA_EINVAL, "Cascade engine load failed"));
+                }
+                cascade_ = ModelFactory::create(cascade_engine_, cascade.value("algorithm", 0));
+                if (cascade_ == nullptr || cascade_->getOutputType() != MA_OUTPUT_TYPE_CLASS) {
+                    MA_THROW(Exception(MA_ENOTSUP, "Cascade model must be a classifier"));
+                }
+                if (cascade.contains("tscore") && cascade["tscore"].is_number()) {
+                    cascade_->setConfig(MA_MODEL_CFG_OPT_THRESHOLD, cascade["tscore"].get<float>());
+                }
+                if (cascade.contains("labels") && cascade["labels"].is_array()) {
+                    cascade_labels_ = cascade["labels"].get<std::vector<std::string>>();
+                }
+                if (cascade.contains("max") && cascade["max"].is_number_integer()) {
+                    cascade_max_ = cascade["max"].get<int32_t>();
+                }
+                if (cascade.contains("padding") && cascade["padding"].is_number()) {
+                    cascade_padding_ = cascade["padding"].get<float>();
+                }
+                // the crops come from the full resolution sensor frame unless a resolution is given
+                cascade_width_  = 1920;
+                cascade_height_ = 1080;
+                if (cascade.contains("resolution") && cascade["resolution"].is_array() && cascade["resolution"].size() == 2) {
+                    cascade_width_  = cascade["resolution"][0].get<int32_t>();
+                    cascade_height_ = cascade["resolution"][1].get<int32_t>();
+                }
+                MA_LOGI(TAG, "cascade: %s %s", uri.c_str(), cascade_->getName());
             }
-            if (config.contains("topk")) {
-                model_->setConfig(MA_MODEL_CFG_OPT_TOPK, config["tiou"].get<float>());
+            for (auto model : lanes_.empty() ? std::vector<Model*>{model_} : lanes_) {
+                if (config.contains("tscore")) {
+                    model->setConfig(MA_MODEL_CFG_OPT_THRESHOLD, config["tscore"].get<float>());
+                }
+                if (config.contains("tiou")) {
+                    model->setConfig(MA_MODEL_CFG_OPT_NMS, config["tiou"].get<float>());
+                }
+                if (config.contains("topk")) {
+                    model->setConfig(MA_MODEL_CFG_OPT_TOPK, config["tiou"].get<float>());
+                }
             }
             if (config.contains("debug")) {
                 output_ = config["debug"].get<bool>();
@@ -341,6 +757,9 @@ ma_err_t ModelNode::onCreate(const json& config) {
             if (config.contains("websocket") && config["websocket"].is_boolean()) {
                 websocket_ = config["websocket"].get<bool>();
             }
+            if (config.contains("encoding") && config["encoding"].is_string()) {
+                encoding_ = config["encoding"].get<std::string>();
+            }
             if (websocket_ || output_) {
                 debug_ = true;
             }
@@ -353,30 +772,66 @@ ma_err_t ModelNode::onCreate(const json& config) {
             if (config.contains("splitter") && config["splitter"].is_array()) {
                 counter_.setSplitter(config["splitter"].get<std::vector<int16_t>>());
             }
+            if (config.contains("simplify") && config["simplify"].is_number()) {
+                simplify_ = config["simplify"].get<float>();
+            }
         }
 
         if (websocket_) {
-            TransportWebSocket::Config ws_config = {.port = 8090};
+            TransportWebSocket::Config ws_config = {.port = 8090, .encoding = encoding_};
             MA_STORAGE_GET_POD(server_->getStorage(), MA_STORAGE_KEY_WS_PORT, ws_config.port, 8090);
             transport_ = new TransportWebSocket();
             if (transport_ != nullptr) {
                 transport_->init(&ws_config);
             }
-            MA_LOGI(TAG, "camera websocket server started on port %d", ws_config.port);
+            MA_LOGI(TAG, "camera websocket server started on port %d, %s encoding by default", ws_config.port, encoding_.c_str());
         } else {
             transport_ = nullptr;
         }
 
+        {  // share the accelerator with the other models
+            int priority      = 0;
+            uint32_t deadline = 0;
+            if (config.contains("priority") && config["priority"].is_number_integer()) {
+                priority = config["priority"].get<int>();
+            }
+            if (config.contains("deadline") && config["deadline"].is_number_unsigned()) {
+                deadline = config["deadline"].get<uint32_t>();
+            }
+            EngineScheduler::getInstance()->attach(engine_, id_, priority, deadline);
+            for (size_t i = 0; i < lane_engines_.size(); ++i) {
+                EngineScheduler::getInstance()->attach(lane_engines_[i], id_ + "#" + std::to_string(i + 1), priority, deadline);
+            }
+            if (cascade_engine_ != nullptr) {
+                EngineScheduler::getInstance()->attach(cascade_engine_, id_ + "#cascade", priority, deadline);
+            }
+        }
+
+        if (!lanes_.empty()) {
+            for (auto model : lanes_) {
+                model->setPreprocessDone([](void* ctx) {
+                    Invocation* invocation = static_cast<Invocation*>(ctx);
+                    invocation->raw->release();
+                    invocation->raw = nullptr;
+                });
+            }
+            pipeline_ = new ModelPipeline(lanes_, [this](Model* model, ma_err_t err, void* ctx) {
+                Thread::enterCritical();
+                onPipelineDone(model, err, ctx);
+                Thread::exitCritical();
+            });
+            MA_LOGI(TAG, "pipelined mode: %zu lanes", lanes_.size());
+        }
+
         thread_ = new Thread((type_ + "#" + id_).c_str(), &ModelNode::threadEntryStub, this);
         if (thread_ == nullptr) {
             MA_THROW(Exception(MA_ENOMEM, "Not enough memory"));
         }
     }
     MA_CATCH(ma::Exception & e) {
-        if (engine_ != nullptr) {
-            delete engine_;
-            engine_ = nullptr;
-        }
+        releasePipeline();
+        releaseCascade();
+        releaseEngine(engine_);
         if (model_ != nullptr) {
             delete model_;
             model_ = nullptr;
@@ -388,10 +843,9 @@ ma_err_t ModelNode::onCreate(const json& config) {
         MA_THROW(e);
     }
     MA_CATCH(std::exception & e) {
-        if (engine_ != nullptr) {
-            delete engine_;
-            engine_ = nullptr;
-        }
+        releasePipeline();
+        releaseCascade();
+        releaseEngine(engine_);
         if (model_ != nullptr) {
             delete model_;
             model_ = nullptr;
@@ -414,14 +868,31 @@ ma_err_t ModelNode::onControl(const std::string& control, const json& data) {
     Guard guard(mutex_);
     ma_err_t err = MA_OK;
     if (control == "config") {
-        if (data.contains("tscore") && data["tscore"].is_number_float()) {
-            model_->setConfig(MA_MODEL_CFG_OPT_THRESHOLD, data["tscore"].get<float>());
+        for (auto model : lanes_.empty() ? std::vector<Model*>{model_} : lanes_) {
+            if (data.contains("tscore") && data["tscore"].is_number_float()) {
+                model->setConfig(MA_MODEL_CFG_OPT_THRESHOLD, data["tscore"].get<float>());
+            }
+            if (data.contains("tiou") && data["tiou"].is_number_float()) {
+                model->setConfig(MA_MODEL_CFG_OPT_NMS, data["tiou"].get<float>());
+            }
+            if (data.contains("topk") && data["topk"].is_number_integer()) {
+                model->setConfig(MA_MODEL_CFG_OPT_TOPK, data["topk"].get<int32_t>());
+            }
         }
-        if (data.contains("tiou") && data["tiou"].is_number_float()) {
-            model_->setConfig(MA_MODEL_CFG_OPT_NMS, data["tiou"].get<float>());
+        if (data.contains("priority") && data["priority"].is_number_integer()) {
+            uint32_t deadline = data.contains("deadline") && data["deadline"].is_number_unsigned() ? data["deadline"].get<uint32_t>() : 0;
+            EngineScheduler::getInstance()->setPriority(engine_, data["priority"].get<int>(), deadline);
+            for (auto engine : lane_engines_) {
+                EngineScheduler::getInstance()->setPriority(engine, data["priority"].get<int>(), deadline);
+            }
         }
-        if (data.contains("topk") && data["topk"].is_number_integer()) {
-            model_->setConfig(MA_MODEL_CFG_OPT_TOPK, data["topk"].get<int32_t>());
+        if (cascade_ != nullptr && data.contains("cascade") && data["cascade"].is_object()) {
+            if (data["cascade"].contains("tscore") && data["cascade"]["tscore"].is_number_float()) {
+                cascade_->setConfig(MA_MODEL_CFG_OPT_THRESHOLD, data["cascade"]["tscore"].get<float>());
+            }
+            if (data["cascade"].contains("max") && data["cascade"]["max"].is_number_integer()) {
+                cascade_max_ = data["cascade"]["max"].get<int32_t>();
+            }
         }
         if (data.contains("debug") && data["debug"].is_boolean()) {
             debug_ = data["debug"].get<bool>();
@@ -438,6 +909,22 @@ ma_err_t ModelNode::onControl(const std::string& control, const json& data) {
             counter_.setSplitter(data["splitter"].get<std::vector<int16_t>>());
         }
         server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_OK}, {"data", data}}));
+    } else if (control == "websocket") {
+        json stats = transport_ != nullptr ? transport_->stats() : json::array();
+        server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_OK}, {"data", stats}}));
+    } else if (control == "scheduler") {
+        json stats = json::array();
+        for (auto& stat : EngineScheduler::getInstance()->getStats()) {
+            stats.push_back({{"name", stat.name},
+                             {"priority", stat.priority},
+                             {"deadline", stat.deadline},
+                             {"requests", stat.requests},
+                             {"misses", stat.misses},
+                             {"queue", {stat.queue_last, stat.queue_avg, stat.queue_max}},
+                             {"busy", stat.busy},
+                             {"utilisation", stat.utilisation}});
+        }
+        server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_OK}, {"data", stats}}));
     } else if (control == "enabled" && data.is_boolean()) {
         bool enabled = data.get<bool>();
         if (enabled_.load() != enabled) {
@@ -463,10 +950,9 @@ ma_err_t ModelNode::onDestroy() {
         delete thread_;
         thread_ = nullptr;
     }
-    if (engine_ != nullptr) {
-        delete engine_;
-        engine_ = nullptr;
-    }
+    releasePipeline();
+    releaseCascade();
+    releaseEngine(engine_);
     if (model_ != nullptr) {
         delete model_;
         model_ = nullptr;
@@ -509,8 +995,13 @@ ma_err_t ModelNode::onStart() {
         return MA_ENOTSUP;
     }
 
-    camera_->config(CHN_RAW, img->width, img->height, 30, img->format);
+    if (cascade_width_ != 0) {
+        camera_->config(CHN_RAW, cascade_width_, cascade_height_, 30, MA_PIXEL_FORMAT_RGB888);
+    } else {
+        camera_->config(CHN_RAW, img->width, img->height, 30, img->format);
+    }
     camera_->attach(CHN_RAW, &raw_frame_);
+    NodeStats::watch(id_, &raw_frame_);
     if (debug_) {
         camera_->config(CHN_JPEG, img->width, img->height, 30, MA_PIXEL_FORMAT_JPEG);
         camera_->attach(CHN_JPEG, &jpeg_frame_);
@@ -519,6 +1010,10 @@ ma_err_t ModelNode::onStart() {
     MA_LOGI(TAG, "start model: %s(%s)", type_.c_str(), id_.c_str());
     started_ = true;
 
+    if (pipeline_ != nullptr) {
+        pipeline_->start();
+    }
+
     thread_->start(this);
 
     return MA_OK;
@@ -534,6 +1029,9 @@ ma_err_t ModelNode::onStop() {
     if (thread_ != nullptr) {
         thread_->join();
     }
+    if (pipeline_ != nullptr) {
+        pipeline_->stop();
+    }
 
     if (camera_ != nullptr) {
         camera_->detach(CHN_RAW, &raw_frame_);
@@ -542,6 +1040,7 @@ ma_err_t ModelNode::onStop() {
         }
         camera_ = nullptr;
     }
+    NodeStats::unwatch(&raw_frame_);
     return MA_OK;
 }
 
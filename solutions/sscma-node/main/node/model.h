@@ -25,6 +25,27 @@ public:
 
 
 protected:
+    // frame handed over to a pipeline lane, owned by the completion callback
+    struct Invocation {
+        videoFrame* raw;
+        videoFrame* jpeg;
+        int32_t width;
+        int32_t height;
+        json reply;
+        ma_tick_t timestamp;  // capture time of the frame
+        ma_tick_t submitted;  // start of the stats measure, 0 when disabled
+    };
+
+    ma_err_t invoke(Model* model, const ma_img_t* img = nullptr);
+    void fillReply(Model* model, json& reply, int32_t width, int32_t height, const videoFrame* source = nullptr);
+    void classify(const videoFrame* source, const std::vector<ma_bbox_t>& bboxes, json& reply);
+    void publish(json& reply, videoFrame* jpeg);
+    void encodeLabels(std::string& packet);
+    void encodeResult(const json& reply, const videoFrame* jpeg, std::string& packet);
+    void onPipelineDone(Model* model, ma_err_t err, void* ctx);
+    void releasePipeline();
+    void releaseCascade();
+
     void threadEntry();
     static void threadEntryStub(void* obj);
 
@@ -39,6 +60,21 @@ protected:
     int algorithm_;
     Model* model_;
     Engine* engine_;
+    std::vector<Model*> lanes_;
+    std::vector<Engine*> lane_engines_;
+    ModelPipeline* pipeline_;
+    Model* cascade_;
+    Engine* cascade_engine_;
+    std::vector<std::string> cascade_labels_;
+    int32_t cascade_max_;
+    float cascade_padding_;
+    int32_t cascade_width_;
+    int32_t cascade_height_;
+    std::vector<uint8_t> cascade_crop_;
+    ma_tick_t ttfi_start_;
+    utils::MaskTracer mask_tracer_;
+    float simplify_;
+    std::vector<ma_bbox_t> bboxes_;
     BYTETracker tracker_;
     Counter counter_;
     std::vector<std::string> labels_;
@@ -48,6 +84,9 @@ protected:
     MessageBox jpeg_frame_;
     bool websocket_;
     bool output_;
+    std::string encoding_;
+    std::string packet_;
+    uint32_t labels_generation_;
     TransportWebSocket* transport_;
 };
 
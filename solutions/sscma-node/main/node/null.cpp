@@ -0,0 +1,145 @@
+#include "null.h"
+#include "stats.h"
+
+namespace ma::node {
+
+static constexpr char TAG[] = "ma::node::null";
+
+NullNode::NullNode(std::string id) : Node("null", id), channel_(CHN_RAW), delay_(0), camera_(nullptr), frame_(10), thread_(nullptr) {}
+
+NullNode::~NullNode() {
+    onDestroy();
+}
+
+void NullNode::threadEntry() {
+    Frame* frame = nullptr;
+
+    server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", "enabled"}, {"code", MA_OK}, {"data", enabled_.load()}}));
+
+    while (started_) {
+        if (frame_.fetch(reinterpret_cast<void**>(&frame), Tick::fromSeconds(2))) {
+            NodeStats::Scope scope(id_, frame->timestamp);
+            if (enabled_ && delay_ > 0) {
+                Thread::sleep(Tick::fromMilliseconds(delay_));
+            }
+            frame->release();
+        }
+    }
+}
+
+void NullNode::threadEntryStub(void* obj) {
+    reinterpret_cast<NullNode*>(obj)->threadEntry();
+}
+
+ma_err_t NullNode::onCreate(const json& config) {
+    Guard guard(mutex_);
+
+    if (config.contains("attach_channel") && config["attach_channel"].is_string()) {
+        std::string channel = config["attach_channel"].get<std::string>();
+        if (channel == "jpeg" || channel == "jpg") {
+            channel_ = CHN_JPEG;
+        } else if (channel == "h264") {
+            channel_ = CHN_H264;
+        } else {
+            channel_ = CHN_RAW;
+        }
+    }
+    if (config.contains("delay") && config["delay"].is_number()) {
+        delay_ = config["delay"].get<int>();
+    }
+
+    thread_ = new Thread((type_ + "#" + id_).c_str(), threadEntryStub);
+    if (thread_ == nullptr) {
+        MA_THROW(Exception(MA_ENOMEM, "Not enough memory"));
+    }
+
+    MA_LOGI(TAG, "null node on channel %d, delay %dms", channel_, delay_);
+
+    server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", "create"}, {"code", MA_OK}, {"data", ""}}));
+    created_ = true;
+    return MA_OK;
+}
+
+ma_err_t NullNode::onControl(const std::string& control, const json& data) {
+    Guard guard(mutex_);
+    if (control == "enabled" && data.is_boolean()) {
+        enabled_.store(data.get<bool>());
+        server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_OK}, {"data", enabled_.load()}}));
+    } else {
+        server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_ENOTSUP}, {"data", "Not supported"}}));
+    }
+    return MA_OK;
+}
+
+ma_err_t NullNode::onDestroy() {
+    Guard guard(mutex_);
+
+    if (!created_) {
+        return MA_OK;
+    }
+
+    onStop();
+
+    if (thread_ != nullptr) {
+        delete thread_;
+        thread_ = nullptr;
+    }
+
+    created_ = false;
+
+    return MA_OK;
+}
+
+ma_err_t NullNode::onStart() {
+    Guard guard(mutex_);
+    if (started_) {
+        return MA_OK;
+    }
+
+    for (auto& dep : dependencies_) {
+        if (dep.second->type() == "camera") {
+            camera_ = static_cast<CameraNode*>(dep.second);
+            break;
+        }
+    }
+
+    if (camera_ == nullptr) {
+        MA_THROW(Exception(MA_ENOTSUP, "No camera node found"));
+        return MA_ENOTSUP;
+    }
+
+    camera_->config(channel_);
+    camera_->attach(channel_, &frame_);
+    NodeStats::watch(id_, &frame_);
+
+    started_ = true;
+
+    thread_->start(this);
+
+    return MA_OK;
+}
+
+ma_err_t NullNode::onStop() {
+    Guard guard(mutex_);
+    if (!started_) {
+        return MA_OK;
+    }
+
+    started_ = false;
+
+    if (thread_ != nullptr) {
+        thread_->join();
+    }
+
+    if (camera_ != nullptr) {
+        camera_->detach(channel_, &frame_);
+        camera_ = nullptr;
+    }
+    NodeStats::unwatch(&frame_);
+
+    return MA_OK;
+}
+
+REGISTER_NODE("null", NullNode);
+
+}  // namespace ma::node
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "node.h"
+
+#include "camera.h"
+
+namespace ma::node {
+
+// stand-in for a node whose backend is not available, it takes the frames of a camera channel
+// and drops them after an optional delay emulating the processing time
+class NullNode : public Node {
+
+public:
+    NullNode(std::string id);
+    ~NullNode();
+
+    ma_err_t onCreate(const json& config) override;
+    ma_err_t onStart() override;
+    ma_err_t onControl(const std::string& control, const json& data) override;
+    ma_err_t onStop() override;
+    ma_err_t onDestroy() override;
+
+protected:
+    void threadEntry();
+    static void threadEntryStub(void* obj);
+
+protected:
+    int channel_;
+    int delay_;
+    CameraNode* camera_;
+    MessageBox frame_;
+    Thread* thread_;
+};
+
+}  // namespace ma::node
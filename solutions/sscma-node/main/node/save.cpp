@@ -1,7 +1,11 @@
+#include <fcntl.h>
 #include <filesystem>
+#include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <unistd.h>
 
 #include "save.h"
+#include "stats.h"
 
 #ifndef NODE_SAVE_PATH_LOCAL
 #define NODE_SAVE_PATH_LOCAL "/userdata/VIDEO/"
@@ -21,12 +25,52 @@
 
 #define NODE_MIN_AVILABLE_CAPACITY 128 * 1024 * 1024
 
+#ifndef NODE_SAVE_SPACE_REFRESH
+#define NODE_SAVE_SPACE_REFRESH 10
+#endif
+
+#ifndef NODE_SAVE_QUEUE_SIZE
+#define NODE_SAVE_QUEUE_SIZE 8 * 1024 * 1024
+#endif
+
+#ifndef NODE_SAVE_PRERECORD_SIZE
+#define NODE_SAVE_PRERECORD_SIZE 16 * 1024 * 1024
+#endif
+
+#ifndef NODE_SAVE_IO_BUFFER
+#define NODE_SAVE_IO_BUFFER 1024 * 1024
+#endif
+
+#ifndef NODE_SAVE_STALL_THRESHOLD
+#define NODE_SAVE_STALL_THRESHOLD 100
+#endif
+
 namespace ma::node {
 
 static constexpr char TAG[] = "ma::node::save";
 
+static inline size_t frameSize(const Frame* frame) {
+    return frame->chn == CHN_H264 ? static_cast<const videoFrame*>(frame)->img.size : static_cast<const audioFrame*>(frame)->size;
+}
+
 SaveNode::SaveNode(std::string id)
-    : Node("save", id), storage_(NODE_SAVE_PATH_LOCAL), slice_(300), duration_(-1), vcount_(0), acount_(0), camera_(nullptr), frame_(60), thread_(nullptr), avFmtCtx_(nullptr), avStream_(nullptr) {
+    : Node("save", id), storage_(NODE_SAVE_PATH_LOCAL), slice_(300), duration_(-1), vcount_(0), acount_(0), camera_(nullptr), frame_(60), thread_(nullptr), avFmtCtx_(nullptr), avStream_(nullptr), indexed_(0), available_(0), refresh_(0),
+      writer_(nullptr),
+      queueSem_(0),
+      queueCapacity_(NODE_SAVE_QUEUE_SIZE),
+      queueBytes_(0),
+      dropping_(false),
+      queueHighWater_(0),
+      dropped_(0),
+      preRecord_(0),
+      ringCapacity_(NODE_SAVE_PRERECORD_SIZE),
+      ringBytes_(0),
+      ringBase_(0),
+      fd_(-1),
+      ioBuffer_(nullptr),
+      written_(0),
+      stalls_(0),
+      stallMax_(0) {
     // av_log_set_level(AV_LOG_LEVEL);
 }
 
@@ -41,41 +85,68 @@ std::string SaveNode::generateFileName() {
     return oss.str();
 }
 
-bool SaveNode::recycle(uint32_t req_size) {
-    uint64_t avail = std::filesystem::space(storage_).available;
-    req_size += NODE_MIN_AVILABLE_CAPACITY;
-    if (avail < req_size) {
-        std::vector<std::filesystem::directory_entry> files;
-        for (const auto& p : std::filesystem::directory_iterator(storage_)) {
-            if (p.is_regular_file()) {
-                files.push_back(p);
-            }
-        }
-        std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return std::filesystem::last_write_time(a) < std::filesystem::last_write_time(b); });
-        for (const auto& file : files) {
-            if (file.path() == filename_) {
-                // skip the current file
-                continue;
-            }
-            uint64_t size = std::filesystem::file_size(file);
-            MA_TRY {
-                if (std::filesystem::remove(file)) {
-                    MA_LOGI(TAG, "recycle %s", file.path().c_str());
-                    avail += size;
-                    if (avail >= req_size) {
-                        break;
-                    }
-                }
-            }
-            MA_CATCH(Exception & e) {
-                MA_LOGW(TAG, "recycle %s failed: %s", file.path().c_str(), e.what());
+void SaveNode::indexStorage() {
+    std::error_code ec;
+
+    segments_ = {};
+    indexed_  = 0;
+
+    for (const auto& p : std::filesystem::directory_iterator(storage_, ec)) {
+        if (p.is_regular_file(ec) && p.path() != filename_) {
+            uint64_t size = p.file_size(ec);
+            if (ec) {
                 continue;
             }
+            segments_.push({p.last_write_time(ec), size, p.path()});
+            indexed_ += size;
         }
     }
-    return avail >= req_size;
+
+    available_ = std::filesystem::space(storage_, ec).available;
+    refresh_   = Tick::current();
+
+    MA_LOGI(TAG, "indexed %zu files (%lluKB), available: %lluKB", segments_.size(), static_cast<unsigned long long>(indexed_ / 1024), static_cast<unsigned long long>(available_ / 1024));
+}
+
+void SaveNode::indexFile(const std::filesystem::path& path) {
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return;
+    }
+    segments_.push({std::filesystem::last_write_time(path, ec), size, path});
+    indexed_ += size;
 }
 
+bool SaveNode::recycle(uint32_t req_size) {
+    uint64_t required = static_cast<uint64_t>(req_size) + NODE_MIN_AVILABLE_CAPACITY;
+    std::error_code ec;
+
+    // the estimate only drifts low (metadata, other writers), so refresh it before trusting a shortage
+    if (available_ < required || Tick::current() - refresh_ > Tick::fromSeconds(NODE_SAVE_SPACE_REFRESH)) {
+        available_ = std::filesystem::space(storage_, ec).available;
+        refresh_   = Tick::current();
+    }
+
+    while (available_ < required && !segments_.empty()) {
+        Segment segment = segments_.top();
+        segments_.pop();
+        indexed_ -= segment.size;
+        if (std::filesystem::remove(segment.path, ec)) {
+            MA_LOGI(TAG, "recycle %s", segment.path.c_str());
+            available_ += segment.size;
+        } else if (ec) {
+            MA_LOGW(TAG, "recycle %s failed: %s", segment.path.c_str(), ec.message().c_str());
+        }
+    }
+
+    if (available_ < required) {
+        return false;
+    }
+
+    available_ -= req_size;
+    return true;
+}
 
 bool SaveNode::openFile(videoFrame* frame) {
 
@@ -83,7 +154,6 @@ bool SaveNode::openFile(videoFrame* frame) {
         return false;
     }
 
-    AVDictionary* dict = nullptr;
     AVDictionary* opt  = nullptr;
     char value[24]     = {0};
     struct tm* lt;
@@ -139,14 +209,25 @@ bool SaveNode::openFile(videoFrame* frame) {
     memset(value, 0, sizeof(value));
     strftime(value, sizeof(value), "%Y-%m-%d %H:%M:%S", lt);
 
-    av_dict_set(&dict, "truncate", "false", 0);
-    av_dict_set(&dict, "fsync", "false", 0);
     av_dict_set(&avFmtCtx_->metadata, "creation_time", value, 0);
-    if (avio_open2(&avFmtCtx_->pb, filename_.c_str(), AVIO_FLAG_WRITE, nullptr, &dict) < 0) {
+
+    // the muxer writes through a large buffer, so the card sees few big sequential writes
+    fd_ = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
         MA_LOGE(TAG, "could not open %s", filename_.c_str());
         goto err;
     }
-    av_dict_free(&dict);
+    ioBuffer_ = static_cast<uint8_t*>(av_malloc(NODE_SAVE_IO_BUFFER));
+    if (ioBuffer_ == nullptr) {
+        MA_LOGE(TAG, "could not allocate io buffer");
+        goto err;
+    }
+    avFmtCtx_->pb = avio_alloc_context(ioBuffer_, NODE_SAVE_IO_BUFFER, 1, this, nullptr, writePacket, seekPacket);
+    if (avFmtCtx_->pb == nullptr) {
+        MA_LOGE(TAG, "could not allocate io context");
+        goto err;
+    }
+    avFmtCtx_->flags |= AVFMT_FLAG_CUSTOM_IO;
 
     if (avformat_write_header(avFmtCtx_, &opt) < 0) {
         MA_LOGE(TAG, "write header failed");
@@ -157,7 +238,7 @@ bool SaveNode::openFile(videoFrame* frame) {
 err:
     if (avFmtCtx_) {
         if (avFmtCtx_->pb) {
-            avio_closep(&avFmtCtx_->pb);
+            avio_context_free(&avFmtCtx_->pb);
         }
         avformat_free_context(avFmtCtx_);
         avFmtCtx_    = nullptr;
@@ -166,6 +247,14 @@ err:
         filename_    = "";
         av_dict_free(&opt);
     }
+    if (ioBuffer_ != nullptr) {
+        av_free(ioBuffer_);
+        ioBuffer_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
     return false;
 }
 
@@ -176,26 +265,225 @@ void SaveNode::closeFile() {
     av_write_trailer(avFmtCtx_);
 
     if (avFmtCtx_->pb) {
-        avio_closep(&avFmtCtx_->pb);
+        avio_flush(avFmtCtx_->pb);
+        // the context may have swapped its buffer, free the one it holds
+        av_freep(&avFmtCtx_->pb->buffer);
+        avio_context_free(&avFmtCtx_->pb);
+        ioBuffer_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
     }
     avformat_free_context(avFmtCtx_);
     avFmtCtx_ = nullptr;
     avStream_ = nullptr;
+    indexFile(filename_);
+    MA_LOGI(TAG, "closed %s, %s", filename_.c_str(), stats().dump().c_str());
     filename_ = "";
 }
+
+int SaveNode::writePacket(void* opaque, uint8_t* buf, int size) {
+    SaveNode* node  = reinterpret_cast<SaveNode*>(opaque);
+    ma_tick_t start = Tick::current();
+    int done        = 0;
+
+    while (done < size) {
+        ssize_t ret = ::write(node->fd_, buf + done, size - done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return AVERROR(errno);
+        }
+        done += ret;
+    }
+
+    int64_t elapsed = Tick::toMilliseconds(Tick::current() - start);
+    if (elapsed >= NODE_SAVE_STALL_THRESHOLD) {
+        node->stalls_++;
+        MA_LOGW(TAG, "write stalled %lldms (%d bytes)", static_cast<long long>(elapsed), size);
+    }
+    if (elapsed > node->stallMax_.load()) {
+        node->stallMax_.store(elapsed);
+    }
+    node->written_ += size;
+
+    return size;
+}
+
+int64_t SaveNode::seekPacket(void* opaque, int64_t offset, int whence) {
+    SaveNode* node = reinterpret_cast<SaveNode*>(opaque);
+
+    if (whence & AVSEEK_SIZE) {
+        struct stat st;
+        return fstat(node->fd_, &st) == 0 ? st.st_size : AVERROR(errno);
+    }
+
+    off_t ret = lseek(node->fd_, offset, whence & ~AVSEEK_FORCE);
+    return ret < 0 ? AVERROR(errno) : ret;
+}
+
+void SaveNode::enqueue(Frame* frame, bool force) {
+    size_t size = frameSize(frame);
+
+    {
+        Guard guard(queueMutex_);
+        // once full, video is dropped up to the next key frame so the file never references a missing frame
+        if (dropping_ && frame->chn == CHN_H264 && static_cast<videoFrame*>(frame)->img.key) {
+            dropping_ = false;
+        }
+        if (!dropping_ && !force && queueBytes_ + size > queueCapacity_) {
+            dropping_ = true;
+            MA_LOGW(TAG, "writer too slow, %zu bytes queued, dropping up to the next key frame", queueBytes_);
+        }
+        if (dropping_) {
+            dropped_++;
+        } else {
+            queue_.push_back(frame);
+            queueBytes_ += size;
+            if (queueBytes_ > queueHighWater_.load()) {
+                queueHighWater_.store(queueBytes_);
+            }
+            frame = nullptr;
+        }
+    }
+
+    if (frame != nullptr) {
+        frame->release();
+    } else {
+        queueSem_.signal();
+    }
+}
+
+Frame* SaveNode::dequeue(ma_tick_t timeout) {
+    if (!queueSem_.wait(timeout)) {
+        return nullptr;
+    }
+
+    Guard guard(queueMutex_);
+    Frame* frame = queue_.front();
+    queue_.pop_front();
+    queueBytes_ -= frameSize(frame);
+    return frame;
+}
+
+json SaveNode::stats() {
+    size_t queued = 0;
+    {
+        Guard guard(queueMutex_);
+        queued = queueBytes_;
+    }
+    return json::object({{"queued", queued},
+                         {"high_water", queueHighWater_.load()},
+                         {"capacity", queueCapacity_},
+                         {"dropped", dropped_.load()},
+                         {"written", written_.load()},
+                         {"stalls", stalls_.load()},
+                         {"stall_max", stallMax_.load()}});
+}
+
+void SaveNode::ringPush(Frame* frame) {
+    bool key = frame->chn == CHN_H264 && static_cast<videoFrame*>(frame)->img.key;
+
+    // nothing before the first key frame can be decoded
+    if (ringKeys_.empty() && !key) {
+        frame->release();
+        return;
+    }
+    if (key) {
+        ringKeys_.push_back(ringBase_ + ring_.size());
+    }
+    ring_.push_back(frame);
+    ringBytes_ += frameSize(frame);
+
+    // drop whole GOPs while over budget, or while the next GOP alone still covers the pre-record time
+    while (!ringKeys_.empty()) {
+        bool full   = ringBytes_ > ringCapacity_;
+        bool covers = ringKeys_.size() > 1 && frame->timestamp - ring_[ringKeys_[1] - ringBase_]->timestamp >= Tick::fromSeconds(preRecord_);
+        if (!full && !covers) {
+            break;
+        }
+        uint64_t end = ringKeys_.size() > 1 ? ringKeys_[1] : ringBase_ + ring_.size();
+        while (ringBase_ < end) {
+            ringPop();
+        }
+        ringKeys_.pop_front();
+    }
+}
+
+void SaveNode::ringPop() {
+    Frame* frame = ring_.front();
+    ring_.pop_front();
+    ringBytes_ -= frameSize(frame);
+    ringBase_++;
+    frame->release();
+}
+
+void SaveNode::ringFlush() {
+    MA_LOGI(TAG, "pre-record: %zu frames, %zu bytes", ring_.size(), ringBytes_);
+
+    // the references held by the ring move to the writer queue, the ring is already bounded
+    for (auto frame : ring_) {
+        enqueue(frame, true);
+    }
+    ringBase_ += ring_.size();
+    ring_.clear();
+    ringKeys_.clear();
+    ringBytes_ = 0;
+}
+
+void SaveNode::ringClear() {
+    while (!ring_.empty()) {
+        ringPop();
+    }
+    ringKeys_.clear();
+}
+
 void SaveNode::threadEntry() {
+    Frame* frame = nullptr;
+
+    begin_ = Tick::current();
+
+    server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", "enabled"}, {"code", MA_OK}, {"data", enabled_.load()}}));
+
+    // fetch stage: never blocks on the card, the camera callback always finds room in frame_
+    while (started_) {
+        Thread::exitCritical();
+        if (frame_.fetch(reinterpret_cast<void**>(&frame), Tick::fromSeconds(2))) {
+            NodeStats::Scope scope(id_, frame->timestamp);
+            Thread::enterCritical();
+            if (!enabled_) {
+                if (preRecord_ > 0) {
+                    ringPush(frame);
+                } else {
+                    frame->release();
+                }
+                continue;
+            }
+            if (!ring_.empty()) {
+                ringFlush();
+            }
+            enqueue(frame);
+        }
+    }
+}
+
+void SaveNode::writerEntry() {
     ma_tick_t start_  = 0;
     Frame* frame      = nullptr;
     videoFrame* video = nullptr;
     audioFrame* audio = nullptr;
     AVPacket packet   = {0};
-    begin_            = Tick::current();
 
-    server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", "enabled"}, {"code", MA_OK}, {"data", enabled_.load()}}));
-
-    while (started_) {
+    // I/O stage: drains the queue, including what is left once stopped
+    for (;;) {
         Thread::exitCritical();
-        if (frame_.fetch(reinterpret_cast<void**>(&frame), Tick::fromSeconds(2))) {
+        frame = dequeue(Tick::fromMilliseconds(500));
+        if (frame == nullptr && !started_) {
+            break;
+        }
+        if (frame != nullptr) {
             Thread::enterCritical();
             if (!enabled_) {
                 frame->release();
@@ -224,7 +512,6 @@ void SaveNode::threadEntry() {
                         closeFile();
                         if (!openFile(video)) {
                             enabled_ = false;
-                            video->release();
                             server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", "save"}, {"code", MA_ENOMEM}, {"data", "No space left on device"}}));
                             frame->release();
                             continue;
@@ -292,6 +579,10 @@ void SaveNode::threadEntryStub(void* obj) {
     reinterpret_cast<SaveNode*>(obj)->threadEntry();
 }
 
+void SaveNode::writerEntryStub(void* obj) {
+    reinterpret_cast<SaveNode*>(obj)->writerEntry();
+}
+
 ma_err_t SaveNode::onCreate(const json& config) {
     Guard guard(mutex_);
     ma_err_t err = MA_OK;
@@ -330,11 +621,28 @@ ma_err_t SaveNode::onCreate(const json& config) {
 
     slice_ = config["slice"].get<int>();
 
+    if (config.contains("buffer") && config["buffer"].is_number() && config["buffer"].get<int>() > 0) {
+        queueCapacity_ = static_cast<size_t>(config["buffer"].get<int>()) * 1024 * 1024;
+    }
+
+    if (config.contains("prerecord") && config["prerecord"].is_number()) {
+        preRecord_ = std::max(config["prerecord"].get<int>(), 0);
+    }
+
+    if (config.contains("prerecord_buffer") && config["prerecord_buffer"].is_number() && config["prerecord_buffer"].get<int>() > 0) {
+        ringCapacity_ = static_cast<size_t>(config["prerecord_buffer"].get<int>()) * 1024 * 1024;
+    }
+
     thread_ = new Thread((type_ + "#" + id_).c_str(), threadEntryStub);
     if (thread_ == nullptr) {
         MA_THROW(Exception(MA_ENOMEM, "Not enough memory"));
     }
 
+    writer_ = new Thread((type_ + "#" + id_ + "#writer").c_str(), writerEntryStub);
+    if (writer_ == nullptr) {
+        MA_THROW(Exception(MA_ENOMEM, "Not enough memory"));
+    }
+
     std::filesystem::space_info si = std::filesystem::space(storage_);
 
     int64_t available = (si.available - NODE_MIN_AVILABLE_CAPACITY) / 1024;
@@ -365,6 +673,8 @@ ma_err_t SaveNode::onControl(const std::string& control, const json& data) {
             }
         }
         server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_OK}, {"data", enabled_.load()}}));
+    } else if (control == "stats") {
+        server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_OK}, {"data", stats()}}));
     } else {
         server_->response(id_, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", control}, {"code", MA_ENOTSUP}, {"data", "Not supported"}}));
     }
@@ -386,6 +696,11 @@ ma_err_t SaveNode::onDestroy() {
         thread_ = nullptr;
     }
 
+    if (writer_ != nullptr) {
+        delete writer_;
+        writer_ = nullptr;
+    }
+
     created_ = false;
 
     return MA_OK;
@@ -412,11 +727,14 @@ ma_err_t SaveNode::onStart() {
     camera_->config(CHN_H264);
     camera_->attach(CHN_H264, &frame_);
     camera_->attach(CHN_AUDIO, &frame_);
+    NodeStats::watch(id_, &frame_);
 
+    indexStorage();
     recycle();
 
     started_ = true;
 
+    writer_->start(this);
     thread_->start(this);
 
     return MA_OK;
@@ -434,9 +752,29 @@ ma_err_t SaveNode::onStop() {
         thread_->join();
     }
 
+    if (writer_ != nullptr) {
+        writer_->join();
+    }
+
+    {
+        Guard guard(queueMutex_);
+        for (auto frame : queue_) {
+            frame->release();
+        }
+        queue_.clear();
+        queueBytes_ = 0;
+        dropping_   = false;
+    }
+    // consume the signals of the frames released above
+    while (queueSem_.wait(0)) {
+    }
+
+    ringClear();
+
     if (camera_ != nullptr) {
         camera_->detach(CHN_H264, &frame_);
         camera_->detach(CHN_AUDIO, &frame_);
+        NodeStats::unwatch(&frame_);
     }
 
 
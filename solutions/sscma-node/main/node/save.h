@@ -8,6 +8,12 @@ extern "C" {
 #include <libavutil/opt.h>
 }
 
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <queue>
+#include <vector>
+
 #include "camera.h"
 #include "node.h"
 
@@ -32,12 +38,25 @@ public:
 protected:
     void threadEntry();
     static void threadEntryStub(void* obj);
+    void writerEntry();
+    static void writerEntryStub(void* obj);
 
 private:
     std::string generateFileName();
+    void indexStorage();
+    void indexFile(const std::filesystem::path& path);
     bool recycle(uint32_t req_size = 0);
     bool openFile(videoFrame* frame);
     void closeFile();
+    void enqueue(Frame* frame, bool force = false);
+    Frame* dequeue(ma_tick_t timeout);
+    json stats();
+    void ringPush(Frame* frame);
+    void ringPop();
+    void ringFlush();
+    void ringClear();
+    static int writePacket(void* opaque, uint8_t* buf, int size);
+    static int64_t seekPacket(void* opaque, int64_t offset, int whence);
 
 protected:
     std::string storage_;
@@ -53,6 +72,50 @@ protected:
     AVFormatContext* avFmtCtx_;
     AVStream* avStream_;
     AVStream* audioStream_;
+
+private:
+    // closed segments of the storage, oldest on top
+    struct Segment {
+        std::filesystem::file_time_type time;
+        uint64_t size;
+        std::filesystem::path path;
+    };
+    struct Newer {
+        bool operator()(const Segment& a, const Segment& b) const {
+            return a.time > b.time;
+        }
+    };
+    std::priority_queue<Segment, std::vector<Segment>, Newer> segments_;
+    uint64_t indexed_;
+    // free space estimate, lowered by every write and refreshed from the filesystem periodically
+    uint64_t available_;
+    ma_tick_t refresh_;
+
+    // frames fetched from the camera and waiting for the writer, bounded in bytes
+    Thread* writer_;
+    Mutex queueMutex_;
+    Semaphore queueSem_;
+    std::deque<Frame*> queue_;
+    size_t queueCapacity_;
+    size_t queueBytes_;
+    bool dropping_;
+    std::atomic<size_t> queueHighWater_;
+    std::atomic<uint32_t> dropped_;
+
+    // pre-event ring, frames kept while disabled and handed to the writer on enable, starts at a key frame
+    int preRecord_;
+    size_t ringCapacity_;
+    size_t ringBytes_;
+    std::deque<Frame*> ring_;
+    std::deque<uint64_t> ringKeys_;
+    uint64_t ringBase_;
+
+    // output file written through a large AVIO buffer
+    int fd_;
+    uint8_t* ioBuffer_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint32_t> stalls_;
+    std::atomic<int64_t> stallMax_;
 };
 
 }  // namespace ma::node
\ No newline at end of file
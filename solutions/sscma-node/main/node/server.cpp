@@ -3,6 +3,7 @@
 #include "camera.h"
 #include "image_preprocessor.h"
 #include "model.h"
+#include "null.h"
 #include "save.h"
 #include "stream.h"
 
@@ -10,6 +11,14 @@ namespace ma::node {
 
 static constexpr char TAG[] = "ma::node::server";
 
+#ifndef NODE_SERVER_HEARTBEAT_INTERVAL
+#define NODE_SERVER_HEARTBEAT_INTERVAL 2
+#endif
+
+#ifndef NODE_SERVER_OUTBOX_SIZE
+#define NODE_SERVER_OUTBOX_SIZE 64
+#endif
+
 void NodeServer::onConnect(struct mosquitto* mosq, int rc) {
     std::string topic = m_topic_in_prefix + "/+";
     mosquitto_subscribe(mosq, NULL, m_topic_in_prefix.c_str(), 0);
@@ -66,6 +75,8 @@ void NodeServer::onMessage(struct mosquitto* mosq, const struct mosquitto_messag
                     this->response(id, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", name}, {"code", MA_OK}, {"data", ""}}));
                 } else if (name == "health") {
                     this->response(id, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", name}, {"code", MA_OK}, {"data", ""}}));
+                } else if (name == "stats") {
+                    this->response(id, json::object({{"type", MA_MSG_TYPE_RESP}, {"name", name}, {"code", MA_OK}, {"data", stats()}}));
                 } else {
                     Node* node = NodeFactory::find(id);
                     if (node) {
@@ -97,6 +108,25 @@ void NodeServer::onMessage(struct mosquitto* mosq, const struct mosquitto_messag
     }
 }
 
+void NodeServer::heartbeatEntry() {
+    while (true) {
+        Thread::sleep(Tick::fromSeconds(NODE_SERVER_HEARTBEAT_INTERVAL));
+        if (!m_connected.load() || m_heartbeat_pending.exchange(true)) {
+            continue;
+        }
+        // published from the executor, so a stuck request stops the heartbeat and the supervisor notices
+        m_executor.submit([this]() -> bool {
+            m_heartbeat_pending.store(false);
+            response("heartbeat", json::object({{"type", MA_MSG_TYPE_EVT}, {"name", "heartbeat"}, {"code", MA_OK}, {"data", ""}}));
+            return false;
+        });
+    }
+}
+
+void NodeServer::heartbeatEntryStub(void* obj) {
+    reinterpret_cast<NodeServer*>(obj)->heartbeatEntry();
+}
+
 void NodeServer::onConnectStub(struct mosquitto* mosq, void* obj, int rc) {
     NodeServer* server = static_cast<NodeServer*>(obj);
     if (server) {
@@ -120,18 +150,96 @@ void NodeServer::onMessageStub(struct mosquitto* mosq, void* obj, const struct m
     }
 }
 
+const std::string& NodeServer::topic(const std::string& id) {
+    Guard guard(m_mutex);
+    auto it = m_topics.find(id);
+    if (it == m_topics.end()) {
+        it = m_topics.emplace(id, m_topic_out_prefix + '/' + id).first;
+    }
+    return it->second;
+}
+
 void NodeServer::response(const std::string& id, const json& msg) {
 
     if (!m_connected) {
         // MA_LOGW(TAG, "response: skipped, not connected, id=%s msg=%s", id.c_str(), msg.dump().c_str());
         return;
     }
-    // Guard guard(m_mutex);
-    std::string topic = m_topic_out_prefix + '/' + id;
-    // MA_LOGI(TAG, "response: publishing to topic=%s msg=%s", topic.c_str(), msg.dump().c_str());
-    int mid = mosquitto_publish(m_client, nullptr, topic.c_str(), msg.dump().size(), msg.dump().data(), 0, false);
-    // MA_LOGI(TAG, "response: message id %d published", mid);
-    return;
+
+    Outgoing out = {&topic(id), "", msg.dump(), Tick::current()};
+    if (msg.contains("type") && msg["type"] == MA_MSG_TYPE_EVT && msg.contains("name") && msg["name"].is_string()) {
+        out.name = msg["name"].get<std::string>();
+    }
+
+    {
+        Guard guard(m_outbox_mutex);
+        if (!out.name.empty()) {
+            for (auto& pending : m_outbox) {
+                if (pending.topic == out.topic && pending.name == out.name) {
+                    pending.payload = std::move(out.payload);
+                    m_coalesced++;
+                    return;
+                }
+            }
+        }
+        if (m_outbox.size() >= NODE_SERVER_OUTBOX_SIZE) {
+            // the oldest event makes room, responses are always kept
+            auto it = std::find_if(m_outbox.begin(), m_outbox.end(), [](const Outgoing& pending) { return !pending.name.empty(); });
+            if (it != m_outbox.end()) {
+                m_outbox.erase(it);
+                m_dropped++;
+            } else if (!out.name.empty()) {
+                m_dropped++;
+                return;
+            }
+        }
+        m_outbox.push_back(std::move(out));
+    }
+    m_outbox_signal.signal();
+}
+
+void NodeServer::senderEntry() {
+    while (true) {
+        bool sending = m_sending.load();
+        m_outbox_signal.wait(Tick::fromMilliseconds(100));
+        while (true) {
+            Outgoing out;
+            {
+                Guard guard(m_outbox_mutex);
+                if (m_outbox.empty()) {
+                    break;
+                }
+                out = std::move(m_outbox.front());
+                m_outbox.pop_front();
+            }
+            if (!m_connected.load() || mosquitto_publish(m_client, nullptr, out.topic->c_str(), out.payload.size(), out.payload.data(), 0, false) != MOSQ_ERR_SUCCESS) {
+                m_dropped++;
+                continue;
+            }
+            uint32_t latency = Tick::toMicroseconds(Tick::current() - out.queued);
+            m_published++;
+            m_latency_total += latency;
+            if (latency > m_latency_max.load()) {
+                m_latency_max.store(latency);
+            }
+        }
+        // what was queued before stop() is still sent
+        if (!sending) {
+            break;
+        }
+    }
+}
+
+void NodeServer::senderEntryStub(void* obj) {
+    reinterpret_cast<NodeServer*>(obj)->senderEntry();
+}
+
+json NodeServer::stats() const {
+    uint64_t published = m_published.load();
+    return json::object({{"published", published},
+                         {"coalesced", m_coalesced.load()},
+                         {"dropped", m_dropped.load()},
+                         {"latency_us", {{"avg", published ? m_latency_total.load() / published : 0}, {"max", m_latency_max.load()}}}});
 }
 
 void NodeServer::setStorage(StorageFile* storage) {
@@ -142,7 +250,8 @@ StorageFile* NodeServer::getStorage() const {
     return m_storage;
 }
 
-NodeServer::NodeServer(std::string client_id) : m_client(nullptr), m_connected(false), m_client_id(std::move(client_id)), m_storage(nullptr), m_mutex() {
+NodeServer::NodeServer(std::string client_id) : m_client(nullptr), m_connected(false), m_client_id(std::move(client_id)), m_storage(nullptr), m_mutex(), m_heartbeat(nullptr), m_heartbeat_pending(false),
+      m_outbox_signal(0), m_sender(nullptr), m_sending(false), m_published(0), m_coalesced(0), m_dropped(0), m_latency_total(0), m_latency_max(0) {
     mosquitto_lib_init();
 
     m_client = mosquitto_new(m_client_id.c_str(), true, this);
@@ -155,16 +264,29 @@ NodeServer::NodeServer(std::string client_id) : m_client(nullptr), m_connected(f
     m_topic_in_prefix  = std::string("sscma/v0/" + m_client_id + "/node/in");
     m_topic_out_prefix = std::string("sscma/v0/" + m_client_id + "/node/out");
 
+    m_heartbeat = new Thread("heartbeat", heartbeatEntryStub);
+    MA_ASSERT(m_heartbeat);
+
+    m_sender = new Thread("publisher", senderEntryStub);
+    MA_ASSERT(m_sender);
+
 #if MA_USE_NODE_REGISTRAR == 0
     NodeFactory::registerNode("camera", [](const std::string& id) { return new CameraNode(id); });
     NodeFactory::registerNode("model", [](const std::string& id) { return new ModelNode(id); });
     NodeFactory::registerNode("save", [](const std::string& id) { return new SaveNode(id); });
     NodeFactory::registerNode("stream", [](const std::string& id) { return new StreamNode(id); });
     NodeFactory::registerNode("image_preprocessor", [](const std::string& id) { return new ImagePreProcessorNode(id); });
+    NodeFactory::registerNode("null", [](const std::string& id) { return new NullNode(id); });
 #endif
 }
 NodeServer::~NodeServer() {
     stop();
+    if (m_heartbeat) {
+        delete m_heartbeat;
+    }
+    if (m_sender) {
+        delete m_sender;
+    }
     if (m_client) {
         mosquitto_destroy(m_client);
     }
@@ -177,6 +299,9 @@ ma_err_t NodeServer::start(std::string host, int port, std::string username, std
         return MA_EBUSY;
     }
 
+    m_sending.store(true);
+    m_sender->start(this);
+
     mosquitto_loop_start(m_client);
 
     mosquitto_reconnect_delay_set(m_client, 2, 30, true);
@@ -185,6 +310,8 @@ ma_err_t NodeServer::start(std::string host, int port, std::string username, std
     }
     int rc = mosquitto_connect(m_client, host.c_str(), port, 60);
 
+    m_heartbeat->start(this);
+
     MA_LOGI(TAG, "node server started: mqtt://%s:%d", host.c_str(), port);
     MA_LOGI(TAG, "in: %s, out: %s", m_topic_in_prefix.c_str(), m_topic_out_prefix.c_str());
 
@@ -193,6 +320,11 @@ ma_err_t NodeServer::start(std::string host, int port, std::string username, std
 }
 
 ma_err_t NodeServer::stop() {
+    m_heartbeat->stop();
+    if (m_sending.exchange(false)) {
+        m_outbox_signal.signal();
+        m_sender->join();
+    }
     if (m_client && m_connected.load()) {
         mosquitto_disconnect(m_client);
         mosquitto_loop_stop(m_client, true);
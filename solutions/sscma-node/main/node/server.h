@@ -1,6 +1,8 @@
 #pragma once
 
+#include <deque>
 #include <string>
+#include <unordered_map>
 
 #include <mosquitto.h>
 
@@ -20,7 +22,10 @@ public:
     ma_err_t stop();
 
     // void dispatch(const std::string& id, const json& msg);
+    // serialised once and queued, published by the sender thread; a pending event of the same
+    // node and name is replaced by the newer one
     void response(const std::string& id, const json& msg);
+    json stats() const;
 
     StorageFile* getStorage() const;
     void setStorage(StorageFile* storage);
@@ -34,6 +39,18 @@ private:
     static void onConnectStub(struct mosquitto* mosq, void* obj, int rc);
     static void onDisconnectStub(struct mosquitto* mosq, void* obj, int rc);
     static void onMessageStub(struct mosquitto* mosq, void* obj, const struct mosquitto_message* msg);
+    void heartbeatEntry();
+    static void heartbeatEntryStub(void* obj);
+    void senderEntry();
+    static void senderEntryStub(void* obj);
+    const std::string& topic(const std::string& id);
+
+    struct Outgoing {
+        const std::string* topic;
+        std::string name;  // empty for responses, which are never coalesced
+        std::string payload;
+        ma_tick_t queued;
+    };
 
     struct mosquitto* m_client;
     std::string m_client_id;
@@ -43,6 +60,21 @@ private:
     StorageFile* m_storage;
     Executor m_executor;
     Mutex m_mutex;
+    Thread* m_heartbeat;
+    std::atomic<bool> m_heartbeat_pending;
+
+    std::unordered_map<std::string, std::string> m_topics;
+    std::deque<Outgoing> m_outbox;
+    Mutex m_outbox_mutex;
+    Semaphore m_outbox_signal;
+    Thread* m_sender;
+    std::atomic<bool> m_sending;
+
+    std::atomic<uint64_t> m_published;
+    std::atomic<uint64_t> m_coalesced;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_latency_total;  // us, over m_published
+    std::atomic<uint32_t> m_latency_max;
 };
 
 }  // namespace ma::node
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <algorithm>
+
+#include "stats.h"
+
+namespace ma::node {
+
+static constexpr char TAG[] = "ma::node::stats";
+
+// latencies kept per node, the oldest are overwritten past this
+static constexpr size_t STATS_SAMPLES = 65536;
+
+std::atomic<bool> NodeStats::m_enabled(false);
+std::unordered_map<std::string, NodeStats::Entry> NodeStats::m_entries;
+std::unordered_map<MessageBox*, std::string> NodeStats::m_queues;
+Mutex NodeStats::m_mutex;
+
+NodeStats::Scope::Scope(const std::string& id, ma_tick_t timestamp) : id_(id), timestamp_(timestamp), begin_(0) {
+    if (enabled()) {
+        begin_ = Tick::current();
+    }
+}
+
+NodeStats::Scope::~Scope() {
+    if (begin_ != 0) {
+        record(id_, timestamp_, begin_);
+    }
+}
+
+ma_tick_t NodeStats::Scope::release() {
+    ma_tick_t begin = begin_;
+    begin_          = 0;
+    return begin;
+}
+
+void NodeStats::enable(bool enabled) {
+    m_enabled.store(enabled);
+    MA_LOGI(TAG, "node statistics %s", enabled ? "enabled" : "disabled");
+}
+
+void NodeStats::watch(const std::string& id, MessageBox* queue) {
+    if (!enabled()) {
+        return;
+    }
+    Guard guard(m_mutex);
+    m_queues[queue] = id;
+    m_entries.try_emplace(id, Entry{0, 0, {}, {}, 0, 0, 0, 0});
+}
+
+void NodeStats::unwatch(MessageBox* queue) {
+    if (!enabled()) {
+        return;
+    }
+    Guard guard(m_mutex);
+    m_queues.erase(queue);
+}
+
+void NodeStats::drop(MessageBox* queue) {
+    if (!enabled()) {
+        return;
+    }
+    Guard guard(m_mutex);
+    auto it = m_queues.find(queue);
+    if (it != m_queues.end()) {
+        m_entries[it->second].drops++;
+    }
+}
+
+void NodeStats::record(const std::string& id, ma_tick_t timestamp, ma_tick_t begin) {
+    ma_tick_t end = Tick::current();
+    Guard guard(m_mutex);
+    Entry& entry = m_entries.try_emplace(id, Entry{0, 0, {}, {}, 0, 0, 0, 0}).first->second;
+
+    uint32_t latency = begin > timestamp ? Tick::toMicroseconds(begin - timestamp) : 0;
+    uint32_t busy    = Tick::toMicroseconds(end - begin);
+    if (entry.latency.size() < STATS_SAMPLES) {
+        entry.latency.push_back(latency);
+        entry.busy.push_back(busy);
+    } else {
+        entry.latency[entry.next] = latency;
+        entry.busy[entry.next]    = busy;
+        entry.next                = (entry.next + 1) % STATS_SAMPLES;
+    }
+    entry.frames++;
+}
+
+void NodeStats::sample() {
+    Guard guard(m_mutex);
+    for (auto& queue : m_queues) {
+        Entry& entry = m_entries[queue.second];
+        size_t count = queue.first->count();
+        entry.occupancy += count;
+        entry.samples++;
+        entry.peak = std::max(entry.peak, count);
+    }
+}
+
+void NodeStats::reset() {
+    Guard guard(m_mutex);
+    for (auto& it : m_entries) {
+        it.second = Entry{0, 0, {}, {}, 0, 0, 0, 0};
+    }
+}
+
+static json percentiles(std::vector<uint32_t> values) {
+    if (values.empty()) {
+        return json::object({{"p50", 0}, {"p99", 0}, {"max", 0}});
+    }
+    auto at = [&values](double q) {
+        auto nth = values.begin() + static_cast<size_t>(q * (values.size() - 1));
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+    };
+    uint32_t p50 = at(0.50);
+    uint32_t p99 = at(0.99);
+    return json::object({{"p50", p50}, {"p99", p99}, {"max", *std::max_element(values.begin(), values.end())}});
+}
+
+json NodeStats::report(double seconds) {
+    Guard guard(m_mutex);
+    json nodes = json::object();
+
+    for (const auto& it : m_entries) {
+        const Entry& entry = it.second;
+        nodes[it.first]    = json::object({
+            {"frames", entry.frames},
+            {"fps", seconds > 0 ? entry.frames / seconds : 0.0},
+            {"drops", entry.drops},
+            {"latency_us", percentiles(entry.latency)},
+            {"busy_us", percentiles(entry.busy)},
+            {"queue", {{"mean", entry.samples ? static_cast<double>(entry.occupancy) / entry.samples : 0.0}, {"max", entry.peak}}},
+        });
+    }
+
+    return nodes;
+}
+
+}  // namespace ma::node
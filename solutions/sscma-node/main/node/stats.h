@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/ma_core.h"
+#include "porting/ma_porting.h"
+
+namespace ma::node {
+
+/**
+ * Frame statistics of the nodes, collected by the benchmark mode (sscma-node --bench) only, the
+ * hooks cost one relaxed load otherwise.
+ * - latency: from the capture timestamp of a frame to the moment a node takes it;
+ * - busy: time the node spends on the frame, measured by a Scope around its handling;
+ * - queue: occupancy of the message boxes a node watches, sampled by the benchmark;
+ * - drops: frames a producer could not post to one of these message boxes.
+ */
+class NodeStats {
+public:
+    class Scope {
+    public:
+        Scope(const std::string& id, ma_tick_t timestamp);
+        ~Scope();
+
+        // for a frame completed elsewhere: returns the start of the measure (0 when disabled) and
+        // records nothing, the completion calls record() with it
+        ma_tick_t release();
+
+    private:
+        const std::string& id_;
+        ma_tick_t timestamp_;
+        ma_tick_t begin_;
+    };
+
+    static void enable(bool enabled);
+    static inline bool enabled() {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void watch(const std::string& id, MessageBox* queue);
+    static void unwatch(MessageBox* queue);
+    static void drop(MessageBox* queue);
+
+    static void sample();
+    static void reset();
+    static json report(double seconds);
+
+    // busy from begin to now, latency from the capture timestamp to begin
+    static void record(const std::string& id, ma_tick_t timestamp, ma_tick_t begin);
+
+private:
+    struct Entry {
+        uint64_t frames;
+        uint64_t drops;
+        std::vector<uint32_t> latency;
+        std::vector<uint32_t> busy;
+        size_t next;
+        uint64_t occupancy;
+        uint64_t samples;
+        size_t peak;
+    };
+
+    static std::atomic<bool> m_enabled;
+    static std::unordered_map<std::string, Entry> m_entries;
+    static std::unordered_map<MessageBox*, std::string> m_queues;
+    static Mutex m_mutex;
+};
+
+}  // namespace ma::node
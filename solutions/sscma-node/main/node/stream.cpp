@@ -4,6 +4,7 @@
 #include <unistd.h>
 
 #include "stream.h"
+#include "stats.h"
 
 namespace ma::node {
 
@@ -29,6 +30,7 @@ void StreamNode::threadEntry() {
 
     while (started_) {
         if (frame_.fetch(reinterpret_cast<void**>(&frame), Tick::fromSeconds(2))) {
+            NodeStats::Scope scope(id_, frame->timestamp);
             Thread::enterCritical();
             if (enabled_) {
                 if (frame->chn == CHN_H264) {
@@ -170,6 +172,7 @@ ma_err_t StreamNode::onStart() {
     camera_->config(CHN_H264);
     camera_->attach(CHN_H264, &frame_);
     camera_->attach(CHN_AUDIO, &frame_);
+    NodeStats::watch(id_, &frame_);
 
     started_ = true;
 
@@ -194,6 +197,7 @@ ma_err_t StreamNode::onStop() {
         camera_->detach(CHN_H264, &frame_);
         camera_->detach(CHN_AUDIO, &frame_);
     }
+    NodeStats::unwatch(&frame_);
 
     if (transport_ != nullptr) {
         transport_->deInit();
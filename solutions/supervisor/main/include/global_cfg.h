@@ -39,6 +39,7 @@
 #define PATH_FIRST_LOGIN           "/etc/.first_login"
 
 #define PATH_WLAN0_MAC             "/sys/class/net/wlan0/address"
+#define PATH_WPA_CTRL              "/var/run/wpa_supplicant/wlan0"
 
 #define KEY_AES_128                "zqCwT7H7!rNdP3wL"
 
@@ -36,6 +36,7 @@ int getDeviceList(HttpRequest* req, HttpResponse* resp);
 int getDeviceInfo(HttpRequest* req, HttpResponse* resp);
 
 int getAppInfo(HttpRequest* req, HttpResponse* resp);
+std::string installApp(const std::string& filePath, const std::string& appName, const std::string& appVersion);
 int uploadApp(const HttpContextPtr& ctx);
 
 int getModelInfo(HttpRequest* req, HttpResponse* resp);
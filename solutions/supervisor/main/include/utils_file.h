@@ -3,6 +3,10 @@
 
 int queryFileList(HttpRequest* req, HttpResponse* resp);
 int uploadFile(HttpRequest* req, HttpResponse* resp);
+int uploadChunk(const HttpContextPtr& ctx, http_parser_state state, const char* data, size_t size);
+int queryUpload(HttpRequest* req, HttpResponse* resp);
 int deleteFile(HttpRequest* req, HttpResponse* resp);
 
+std::string getFileDigest(const std::string& path, const std::string& type = "md5");
+
 #endif
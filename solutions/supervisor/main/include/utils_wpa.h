@@ -0,0 +1,76 @@
+#ifndef _UTILS_WPA_H_
+#define _UTILS_WPA_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Client of the wpa_supplicant control interface (the protocol of wpa_cli), kept open for the
+ * life of the supervisor instead of one wpa_cli process per query.
+ *
+ * Requests go through a command socket: several commands can be sent at once and their replies
+ * are read back in order. A second socket is attached for the CTRL-EVENT-* notifications, which
+ * invalidate the cached scan results and network list, and signal eventFd() on state changes.
+ * The caches are only trusted while the monitor is attached.
+ */
+class WpaCtrl {
+public:
+    WpaCtrl(const std::string& path);
+    ~WpaCtrl();
+
+    bool start();
+    void stop();
+
+    // reply of one command, empty on failure
+    std::string request(const std::string& cmd, int timeoutMs = 2000);
+    // replies of several commands sent back to back, in order
+    std::vector<std::string> request(const std::vector<std::string>& cmds, int timeoutMs = 2000);
+
+    // key=value reply of STATUS
+    std::map<std::string, std::string> status();
+    std::string scanResults();
+    std::string listNetworks();
+
+    // readable (eventfd) when the connection state changes
+    int eventFd() const;
+
+private:
+    int openSocket(const char* tag);
+    void closeSocket(int& fd);
+    bool sendRecv(const std::vector<std::string>& cmds, std::vector<std::string>& replies, int timeoutMs);
+    bool attach();
+    void monitor();
+    void onEvent(const char* event);
+
+    std::string m_path;
+    std::mutex m_mutex;
+    int m_cmdFd;
+    int m_monFd;
+    int m_eventFd;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_attached;
+
+    // a cache is valid while its generation matches the one it was filled at
+    struct Cache {
+        std::string reply;
+        uint32_t filled;
+        std::atomic<uint32_t> generation;
+    };
+    std::string cached(Cache& cache, const char* cmd);
+    void invalidate(Cache& cache);
+
+    std::mutex m_cacheMutex;
+    Cache m_scan;
+    Cache m_networks;
+};
+
+std::string wpaDecode(const std::string& str);
+std::string wpaHex(const std::string& str);
+
+#endif
@@ -1,8 +1,15 @@
-#include <semaphore.h>
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <syslog.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "daemon.h"
 #include "global_cfg.h"
@@ -10,18 +17,27 @@
 #include "hv/mqtt_client.h"
 #include "hv/requests.h"
 
-#define MQTT_TOPIC_IN  "sscma/v0/recamera/node/in/"
-#define MQTT_TOPIC_OUT "sscma/v0/recamera/node/out/"
-#define MQTT_PAYLOAD   "{\"name\":\"health\",\"type\":3,\"data\":\"\"}"
-
-const int threadTimeout  = 3;
-const int retryTimes     = 3;
-int daemonStatus         = 0;
-int noderedStarting      = 1;
-int sscmaStarting        = 1;
-APP_STATUS noderedStatus = APP_STATUS_UNKNOWN;
-APP_STATUS sscmaStatus   = APP_STATUS_UNKNOWN;
-sem_t semSscma;
+#define MQTT_TOPIC_IN        "sscma/v0/recamera/node/in/"
+#define MQTT_TOPIC_OUT       "sscma/v0/recamera/node/out/"
+#define MQTT_TOPIC_HEARTBEAT MQTT_TOPIC_OUT "heartbeat"
+#define MQTT_PAYLOAD         "{\"name\":\"health\",\"type\":3,\"data\":\"\"}"
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+const int probeTimeout     = 3;
+const int retryTimes       = 3;
+const int noderedInterval  = 10; // seconds between two node-red HTTP probes
+const int heartbeatProbe   = 5;  // seconds of silence before sscma-node is asked for its health
+const int heartbeatTimeout = 12; // seconds of silence before sscma-node is restarted
+const int startTimeout     = 60; // seconds a restarted service has to answer
+int daemonStatus           = 0;
+int noderedStarting        = 1;
+int sscmaStarting          = 1;
+APP_STATUS noderedStatus   = APP_STATUS_UNKNOWN;
+APP_STATUS sscmaStatus     = APP_STATUS_UNKNOWN;
+int heartbeatFd            = -1;
 
 hv::MqttClient cli;
 
@@ -30,15 +46,18 @@ void runMqtt() {
 }
 
 void initMqtt() {
-    sem_init(&semSscma, 0, 0);
+    heartbeatFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
     cli.onConnect = [](hv::MqttClient* cli) {
         cli->subscribe(MQTT_TOPIC_OUT);
+        cli->subscribe(MQTT_TOPIC_HEARTBEAT);
         cli->publish(MQTT_TOPIC_IN, MQTT_PAYLOAD);
     };
 
+    // any message of sscma-node on these topics (heartbeat or health reply) proves it is alive
     cli.onMessage = [](hv::MqttClient* cli, mqtt_message_t* msg) {
-        sem_post(&semSscma);
+        uint64_t one = 1;
+        write(heartbeatFd, &one, sizeof(one));
     };
 
     cli.onClose = [](hv::MqttClient* cli) {
@@ -132,110 +151,278 @@ APP_STATUS getFlowStatus() {
 }
 
 APP_STATUS getNoderedStatus() {
-    for (int i = 0; i < retryTimes; i++) {
-        auto resp = requests::get("localhost:1880");
-
-        if (NULL != resp) {
-            return getFlowStatus();
-        }
+    HttpRequestPtr req(new HttpRequest);
+    req->method  = HTTP_GET;
+    req->url     = "localhost:1880";
+    req->timeout = probeTimeout;
 
-        std::this_thread::sleep_for(std::chrono::seconds(threadTimeout));
+    if (NULL != requests::request(req)) {
+        return getFlowStatus();
     }
 
     return APP_STATUS_NORESPONSE;
 }
 
-APP_STATUS getSscmaStatus() {
+typedef struct {
+    const char* name;
+    const char* comm;
+    const char* script;
+    pid_t pid;
+    int pidfd;
+    time_t since; // last sign of life, or restart time while starting
+} SERVICE_S;
+
+static SERVICE_S nodered = {"node-red", "node-red", SCRIPT_DEVICE_RESTARTNODERED, 0, -1, 0};
+static SERVICE_S sscma   = {"sscma-node", "sscma-node", SCRIPT_DEVICE_RESTARTSSCMA, 0, -1, 0};
+
+static time_t monotonic() {
     struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
 
-    if (!cli.isConnected()) {
-        syslog(LOG_ERR, "mqtt is not connected\n");
-        cli.reconnect();
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+static pid_t findProcess(const char* comm) {
+    DIR* dir  = opendir("/proc");
+    pid_t pid = 0;
+
+    if (dir == NULL) {
+        return 0;
     }
 
-    for (int i = 0; i < retryTimes; i++) {
-        cli.publish(MQTT_TOPIC_IN, MQTT_PAYLOAD);
+    struct dirent* entry;
+    while (pid == 0 && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9') {
+            continue;
+        }
 
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_nsec += 500 * 1000;
-        if (0 == sem_timedwait(&semSscma, &ts)) {
-            return APP_STATUS_NORMAL;
+        char path[64];
+        char name[32] = "";
+        snprintf(path, sizeof(path), "/proc/%s/comm", entry->d_name);
+        FILE* fp = fopen(path, "r");
+        if (fp == NULL) {
+            continue;
         }
+        if (fgets(name, sizeof(name), fp) != NULL) {
+            name[strcspn(name, "\n")] = '\0';
+            if (strcmp(name, comm) == 0) {
+                pid = atoi(entry->d_name);
+            }
+        }
+        fclose(fp);
+    }
+    closedir(dir);
 
-        std::this_thread::sleep_for(std::chrono::seconds(threadTimeout));
+    return pid;
+}
+
+// the services are started by their init scripts, not by us: pidfd_open works on any process,
+// without it the pid is checked with kill(0) on every tick
+static void watchService(SERVICE_S* svc, int epfd) {
+    if (svc->pid > 0) {
+        return;
     }
 
-    return APP_STATUS_NORESPONSE;
+    svc->pid = findProcess(svc->comm);
+    if (svc->pid <= 0) {
+        return;
+    }
+
+    svc->pidfd = syscall(__NR_pidfd_open, svc->pid, 0);
+    if (svc->pidfd >= 0) {
+        struct epoll_event ev = {0};
+        ev.events             = EPOLLIN;
+        ev.data.ptr           = svc;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, svc->pidfd, &ev);
+    }
+    syslog(LOG_INFO, "%s pid: %d\n", svc->name, svc->pid);
 }
 
-void runDaemon() {
-    initMqtt();
+static void unwatchService(SERVICE_S* svc, int epfd) {
+    if (svc->pidfd >= 0) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, svc->pidfd, NULL);
+        close(svc->pidfd);
+        svc->pidfd = -1;
+    }
+    svc->pid = 0;
+}
 
-    while (daemonStatus) {
-        std::this_thread::sleep_for(std::chrono::seconds(threadTimeout));
-        APP_STATUS appStatus;
+static bool isServiceAlive(SERVICE_S* svc) {
+    if (svc->pid <= 0) {
+        return false;
+    }
+    if (svc->pidfd >= 0) {
+        struct pollfd pfd = {svc->pidfd, POLLIN, 0};
+        return poll(&pfd, 1, 0) == 0;
+    }
+    return kill(svc->pid, 0) == 0 || errno == EPERM;
+}
+
+static int restartService(SERVICE_S* svc, int epfd) {
+    unwatchService(svc, epfd);
+    svc->since = monotonic();
+    return startApp(svc->script, svc->name);
+}
 
-        appStatus = getNoderedStatus();
-        if (APP_STATUS_NORMAL == appStatus) {
-            if (noderedStarting) {
+static void restartSscma(int epfd) {
+    stopFlow();
+    if (0 != restartService(&sscma, epfd)) {
+        sscmaStatus   = APP_STATUS_STARTFAILED;
+        sscmaStarting = 0;
+    } else {
+        sscmaStarting = 1;
+    }
+}
+
+static void onNoderedStatus(APP_STATUS appStatus, int epfd) {
+    if (APP_STATUS_NORMAL == appStatus) {
+        if (noderedStarting) {
+            noderedStarting = 0;
+            syslog(LOG_INFO, "node-red startup status: Finished\n");
+        }
+
+        if (APP_STATUS_NORESPONSE == noderedStatus) {
+            syslog(LOG_INFO, "Stop Flow");
+            stopFlow();
+            noderedStatus = APP_STATUS_STOP;
+        } else {
+            noderedStatus = APP_STATUS_NORMAL;
+        }
+    } else if (APP_STATUS_NORESPONSE == appStatus) {
+        if (noderedStarting && monotonic() - nodered.since < startTimeout) {
+            syslog(LOG_INFO, "Nodered is starting");
+        } else {
+            syslog(LOG_ERR, "node-red is not responding");
+            noderedStatus = APP_STATUS_NORESPONSE;
+            if (0 != restartService(&nodered, epfd)) {
+                noderedStatus   = APP_STATUS_STARTFAILED;
                 noderedStarting = 0;
-                syslog(LOG_INFO, "node-red startup status: Finished\n");
+            } else {
+                noderedStarting = 1;
+                restartService(&sscma, epfd);
+                sscmaStarting = 1;
             }
+        }
+    } else {
+        if (noderedStarting) {
+            noderedStarting = 0;
+        }
+        noderedStatus = appStatus;
+    }
+}
 
-            if (APP_STATUS_NORESPONSE == noderedStatus) {
-                syslog(LOG_INFO, "Stop Flow");
-                stopFlow();
-                noderedStatus = APP_STATUS_STOP;
-            } else {
-                noderedStatus = APP_STATUS_NORMAL;
+static void onSscmaAlive() {
+    sscma.since = monotonic();
+
+    if (sscmaStarting) {
+        sscmaStarting = 0;
+    }
+    if (APP_STATUS_NORMAL != sscmaStatus) {
+        if (APP_STATUS_NORESPONSE == sscmaStatus) {
+            syslog(LOG_INFO, "Restart Flow");
+            startFlow();
+        }
+        sscmaStatus = APP_STATUS_NORMAL;
+    }
+}
+
+static void checkSscma(int epfd) {
+    time_t silence = monotonic() - sscma.since;
+
+    if (sscmaStarting) {
+        if (silence < startTimeout) {
+            return;
+        }
+    } else if (isServiceAlive(&sscma) || sscma.pid <= 0) {
+        if (silence < heartbeatTimeout) {
+            if (silence >= heartbeatProbe) {
+                // no heartbeat (older sscma-node or a busy broker), fall back to a health request
+                if (!cli.isConnected()) {
+                    cli.reconnect();
+                } else {
+                    cli.publish(MQTT_TOPIC_IN, MQTT_PAYLOAD);
+                }
             }
-        } else if (APP_STATUS_NORESPONSE == appStatus) {
-            if (noderedStarting) {
-                syslog(LOG_INFO, "Nodered is starting");
+            return;
+        }
+    }
+
+    syslog(LOG_ERR, "sscma-node is not responding");
+    sscmaStatus = APP_STATUS_NORESPONSE;
+    restartSscma(epfd);
+}
+
+void runDaemon() {
+    int epfd            = epoll_create1(EPOLL_CLOEXEC);
+    int timerfd         = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    time_t lastProbe    = 0;
+    int noderedFailures = 0;
+
+    initMqtt();
+
+    struct itimerspec its = {{1, 0}, {1, 0}};
+    timerfd_settime(timerfd, 0, &its, NULL);
+
+    struct epoll_event ev = {0};
+    ev.events             = EPOLLIN;
+    ev.data.ptr           = &timerfd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, timerfd, &ev);
+    ev.data.ptr = &heartbeatFd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, heartbeatFd, &ev);
+
+    nodered.since = sscma.since = monotonic();
+
+    while (daemonStatus) {
+        struct epoll_event events[4];
+        int n     = epoll_wait(epfd, events, 4, -1);
+        bool tick = false;
+
+        for (int i = 0; i < n; i++) {
+            uint64_t value;
+            if (events[i].data.ptr == &timerfd) {
+                read(timerfd, &value, sizeof(value));
+                tick = true;
+            } else if (events[i].data.ptr == &heartbeatFd) {
+                read(heartbeatFd, &value, sizeof(value));
+                onSscmaAlive();
             } else {
-                syslog(LOG_ERR, "node-red is not responding");
-                if (0 != startApp(SCRIPT_DEVICE_RESTARTNODERED, "node-red")) {
-                    noderedStatus   = APP_STATUS_STARTFAILED;
+                // a pidfd became readable: the process exited
+                SERVICE_S* svc = (SERVICE_S*)events[i].data.ptr;
+                syslog(LOG_ERR, "%s exited\n", svc->name);
+                unwatchService(svc, epfd);
+                if (svc == &nodered) {
                     noderedStarting = 0;
-                } else {
-                    noderedStarting = 1;
-                    startApp(SCRIPT_DEVICE_RESTARTSSCMA, "sscma-node");
-                    sscmaStarting = 1;
+                    onNoderedStatus(APP_STATUS_NORESPONSE, epfd);
+                } else if (!sscmaStarting) {
+                    sscmaStatus = APP_STATUS_NORESPONSE;
+                    restartSscma(epfd);
                 }
             }
-        } else {
-            if (noderedStarting) {
-                noderedStarting = 0;
-            }
-            noderedStatus = appStatus;
         }
 
-        appStatus = getSscmaStatus();
-        if (APP_STATUS_NORMAL == appStatus) {
-            if (sscmaStarting) {
-                sscmaStarting = 0;
-            }
-            if (APP_STATUS_NORESPONSE == sscmaStatus) {
-                syslog(LOG_INFO, "Restart Flow");
-                startFlow();
-            }
-            sscmaStatus = appStatus;
-        } else {
-            if (sscmaStarting) {
-                continue;
-            }
-            sscmaStatus = appStatus;
-            syslog(LOG_ERR, "sscma-node is not responding");
-            stopFlow();
-            if (0 != startApp(SCRIPT_DEVICE_RESTARTSSCMA, "sscma-node")) {
-                sscmaStatus   = APP_STATUS_STARTFAILED;
-                sscmaStarting = 0;
-            } else {
-                sscmaStarting = 1;
+        if (!tick) {
+            continue;
+        }
+
+        watchService(&nodered, epfd);
+        watchService(&sscma, epfd);
+
+        // node-red has no heartbeat, its flow state is still read over HTTP, without blocking retries
+        if (monotonic() - lastProbe >= noderedInterval) {
+            lastProbe            = monotonic();
+            APP_STATUS appStatus = getNoderedStatus();
+            if (APP_STATUS_NORESPONSE != appStatus || ++noderedFailures >= retryTimes || noderedStarting) {
+                noderedFailures = 0;
+                onNoderedStatus(appStatus, epfd);
             }
         }
+
+        checkSscma(epfd);
     }
+
+    unwatchService(&nodered, epfd);
+    unwatchService(&sscma, epfd);
+    close(timerfd);
+    close(epfd);
 }
 
 void initDaemon() {
@@ -121,6 +121,8 @@ static void registerDeviceApi(HttpService& router) {
 static void registerFileApi(HttpService& router) {
     API_GET(fileMgr, queryFileList);
     API_POST(fileMgr, uploadFile);
+    API_POST(fileMgr, uploadChunk);
+    API_GET(fileMgr, queryUpload);
     API_POST(fileMgr, deleteFile);
 }
 
@@ -18,6 +18,7 @@
 #include "global_cfg.h"
 #include "hv/HttpServer.h"
 #include "utils_device.h"
+#include "utils_file.h"
 
 SERVICE_STATUS systemStatus = SERVICE_STATUS_STARTING;
 std::string sn;
@@ -111,11 +112,23 @@ static int saveModelFile(const HttpContextPtr& ctx, std::string filePath) {
         return HTTP_STATUS_BAD_REQUEST;
     }
 
+    // written aside and renamed, so a failed upload never leaves a truncated model behind
     filePath += "model.cvimodel";
-    if (file.open(filePath.c_str(), "wb") != 0) {
+    std::string partPath = filePath + ".part";
+    if (file.open(partPath.c_str(), "wb") != 0) {
+        return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
+    if (file.write(formdata.content.data(), formdata.content.size()) != formdata.content.size()) {
+        file.remove();
+        return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
+    file.close();
+
+    if (rename(partPath.c_str(), filePath.c_str()) != 0) {
+        syslog(LOG_ERR, "rename %s failed(%s)\n", partPath.c_str(), strerror(errno));
+        remove(partPath.c_str());
         return HTTP_STATUS_INTERNAL_SERVER_ERROR;
     }
-    file.write(formdata.content.data(), formdata.content.size());
 
     return 200;
 }
@@ -137,22 +150,7 @@ static int saveModelInfoFile(const HttpContextPtr& ctx, std::string filePath) {
 }
 
 static std::string getFileMd5(std::string filePath) {
-    FILE* fp;
-    char cmd[128]      = SCRIPT_DEVICE_GETFILEMD5;
-    char md5Value[128] = "";
-
-    strcat(cmd, filePath.c_str());
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        return std::string(md5Value);
-    }
-
-    fgets(md5Value, sizeof(md5Value) - 1, fp);
-    clearNewline(md5Value, strlen(md5Value));
-    pclose(fp);
-
-    return std::string(md5Value);
+    return getFileDigest(filePath, "md5");
 }
 
 static std::string getDeviceIp(std::string clientIp) {
@@ -837,12 +835,35 @@ int getAppInfo(HttpRequest* req, HttpResponse* resp) {
     return resp->Json(response);
 }
 
+std::string installApp(const std::string& filePath, const std::string& appName, const std::string& appVersion) {
+    FILE* fp;
+    char cmd[256]  = SCRIPT_DEVICE_INSTALLAPP;
+    char info[128] = "";
+
+    strcat(cmd, filePath.c_str());
+    strcat(cmd, " ");
+    strcat(cmd, appName.c_str());
+    strcat(cmd, " ");
+    strcat(cmd, appVersion.c_str());
+    fp = popen(cmd, "r");
+    if (fp == NULL) {
+        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
+        return std::string("Install failed");
+    }
+
+    fgets(info, sizeof(info) - 1, fp);
+    clearNewline(info, strlen(info));
+    pclose(fp);
+
+    syslog(LOG_INFO, "info: %s\n", info);
+
+    return std::string(info);
+}
+
 int uploadApp(const HttpContextPtr& ctx) {
     int ret             = 0;
     std::string appPath = PATH_APP_DOWNLOAD_DIR;
-    FILE* fp;
-    char cmd[128]  = SCRIPT_DEVICE_INSTALLAPP;
-    char info[128] = "";
+    std::string info;
 
     if (ctx->param("filename").empty()) {
         syslog(LOG_ERR, "Missing filename parameter value\n");
@@ -856,24 +877,10 @@ int uploadApp(const HttpContextPtr& ctx) {
         ret                  = ctx->request->SaveFile(filePath.c_str());
     }
 
-    strcat(cmd, std::string(appPath + ctx->param("filename")).c_str());
-    strcat(cmd, " ");
-    strcat(cmd, ctx->param("appName").c_str());
-    strcat(cmd, " ");
-    strcat(cmd, ctx->param("appVersion").c_str());
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        return -1;
-    }
-
-    fgets(info, sizeof(info) - 1, fp);
-    clearNewline(info, strlen(info));
-
-    syslog(LOG_INFO, "info: %s\n", info);
+    info = installApp(appPath + ctx->param("filename"), ctx->param("appName"), ctx->param("appVersion"));
 
     hv::Json response;
-    if (strcmp(info, "Finished") == 0) {
+    if (info == "Finished") {
         response["code"] = 0;
         response["msg"]  = "";
     } else {
@@ -882,8 +889,6 @@ int uploadApp(const HttpContextPtr& ctx) {
     }
     response["data"] = hv::Json({});
 
-    pclose(fp);
-
     ctx->response.get()->Set("code", 200);
     ctx->response.get()->Set("message", response.dump(2));
     return 200;
@@ -1,8 +1,16 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <map>
+#include <mutex>
 #include <syslog.h>
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
 
 #include "hv/HttpServer.h"
 #include "global_cfg.h"
@@ -25,6 +33,488 @@ static bool isLegalPath(const std::string& filePath) {
     return true;
 }
 
+#define UPLOAD_BUFFER_SIZE  (64 * 1024)
+#define UPLOAD_IDLE_TIMEOUT 3600  // seconds before an abandoned upload releases its resources
+
+/*
+ * Resumable uploads: the data is streamed to <file>.part as it arrives, with the digests
+ * updated on the way, and renamed over <file> once complete. A session only holds the
+ * write position and the digest states, so a chunk can be as large as the client wants.
+ * A lost session (idle timeout, supervisor restart) is rebuilt from the .part file.
+ */
+typedef struct _UPLOAD_S {
+    std::string path;
+    int fd;
+    uint64_t offset;
+    uint64_t total;
+    EVP_MD_CTX* md5;
+    EVP_MD_CTX* sha256;
+    bool busy;
+    time_t active;
+} UPLOAD_S;
+
+typedef struct _UPLOAD_REQ_S {
+    UPLOAD_S* upload;
+    std::string error;
+} UPLOAD_REQ_S;
+
+// a file rewritten in place within the same second keeps st_mtime, the nanoseconds and the
+// inode tell the versions apart
+typedef struct _DIGEST_S {
+    struct timespec mtime;
+    ino_t ino;
+    off_t size;
+    std::string md5;
+    std::string sha256;
+} DIGEST_S;
+
+static std::mutex g_uploadMutex;
+static std::map<std::string, UPLOAD_S*> g_uploads;
+static std::map<std::string, DIGEST_S> g_digests;
+
+static std::string hexDigest(EVP_MD_CTX* md) {
+    static const char hex[] = "0123456789abcdef";
+    unsigned char value[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    std::string str;
+
+    EVP_DigestFinal_ex(md, value, &len);
+    for (unsigned int i = 0; i < len; i++) {
+        str += hex[value[i] >> 4];
+        str += hex[value[i] & 0x0f];
+    }
+
+    return str;
+}
+
+static void resetDigests(UPLOAD_S* upload) {
+    EVP_DigestInit_ex(upload->md5, EVP_md5(), NULL);
+    EVP_DigestInit_ex(upload->sha256, EVP_sha256(), NULL);
+}
+
+// feed the first len bytes of a file to the digests, false on a read error
+static bool hashFile(int fd, uint64_t len, EVP_MD_CTX* md5, EVP_MD_CTX* sha256) {
+    std::vector<char> buf(UPLOAD_BUFFER_SIZE);
+    uint64_t pos = 0;
+
+    while (pos < len) {
+        ssize_t n = pread(fd, buf.data(), std::min<uint64_t>(buf.size(), len - pos), pos);
+        if (n <= 0) {
+            return false;
+        }
+        EVP_DigestUpdate(md5, buf.data(), n);
+        EVP_DigestUpdate(sha256, buf.data(), n);
+        pos += n;
+    }
+
+    return true;
+}
+
+static void freeUpload(UPLOAD_S* upload) {
+    if (upload->fd >= 0) {
+        close(upload->fd);
+    }
+    EVP_MD_CTX_free(upload->md5);
+    EVP_MD_CTX_free(upload->sha256);
+    delete upload;
+}
+
+static bool sameVersion(const DIGEST_S& digest, const struct stat& st) {
+    return digest.mtime.tv_sec == st.st_mtim.tv_sec && digest.mtime.tv_nsec == st.st_mtim.tv_nsec && digest.ino == st.st_ino &&
+           digest.size == st.st_size;
+}
+
+static void rememberDigest(const std::string& path, const struct stat& st, const std::string& md5, const std::string& sha256) {
+    std::lock_guard<std::mutex> lock(g_uploadMutex);
+    g_digests[path] = {st.st_mtim, st.st_ino, st.st_size, md5, sha256};
+}
+
+static void rememberDigest(const std::string& path, const std::string& md5, const std::string& sha256) {
+    struct stat st;
+
+    if (stat(path.c_str(), &st) == 0) {
+        rememberDigest(path, st, md5, sha256);
+    }
+}
+
+// the supervisor replaced or removed the file itself
+static void forgetDigest(const std::string& path) {
+    std::lock_guard<std::mutex> lock(g_uploadMutex);
+    g_digests.erase(path);
+}
+
+std::string getFileDigest(const std::string& path, const std::string& type) {
+    struct stat st;
+    DIGEST_S digest;
+
+    if (stat(path.c_str(), &st) != 0) {
+        return std::string("");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_uploadMutex);
+        auto it = g_digests.find(path);
+        if (it != g_digests.end() && sameVersion(it->second, st)) {
+            return type == "sha256" ? it->second.sha256 : it->second.md5;
+        }
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::string("");
+    }
+
+    EVP_MD_CTX* md5    = EVP_MD_CTX_new();
+    EVP_MD_CTX* sha256 = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(md5, EVP_md5(), NULL);
+    EVP_DigestInit_ex(sha256, EVP_sha256(), NULL);
+    if (hashFile(fd, st.st_size, md5, sha256)) {
+        digest.md5    = hexDigest(md5);
+        digest.sha256 = hexDigest(sha256);
+        // keyed on the version that was hashed, a change made meanwhile is hashed again next time
+        rememberDigest(path, st, digest.md5, digest.sha256);
+    }
+    EVP_MD_CTX_free(md5);
+    EVP_MD_CTX_free(sha256);
+    close(fd);
+
+    return type == "sha256" ? digest.sha256 : digest.md5;
+}
+
+// destination of an upload, empty if the request names an illegal one
+static std::string getUploadPath(const HttpContextPtr& ctx) {
+    std::string target = ctx->param("target", "file");
+
+    if (target == "model") {
+        createFolder(PATH_MODEL_DOWNLOAD_DIR);
+        return std::string(PATH_MODEL_DOWNLOAD_DIR "model.cvimodel");
+    }
+
+    std::string filePath = ctx->param("filePath");
+    if (filePath.empty() || !isLegalPath(filePath) || (target != "file" && target != "app")) {
+        return std::string("");
+    }
+
+    createFolder(PATH_APP_DOWNLOAD_DIR);
+    return PATH_APP_DOWNLOAD_DIR + filePath;
+}
+
+// take the session of a destination, NULL if another request is writing it
+static UPLOAD_S* acquireUpload(const std::string& path, std::string& error) {
+    UPLOAD_S* upload = NULL;
+    bool created     = false;
+    time_t now       = time(NULL);
+
+    {
+        std::lock_guard<std::mutex> lock(g_uploadMutex);
+
+        for (auto it = g_uploads.begin(); it != g_uploads.end();) {
+            if (!it->second->busy && now - it->second->active > UPLOAD_IDLE_TIMEOUT) {
+                freeUpload(it->second);
+                it = g_uploads.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        auto it = g_uploads.find(path);
+        if (it != g_uploads.end()) {
+            if (it->second->busy) {
+                error = "The file is being uploaded by another request";
+                return NULL;
+            }
+            upload = it->second;
+        } else {
+            upload         = new UPLOAD_S;
+            upload->path   = path;
+            upload->fd     = -1;
+            upload->offset = 0;
+            upload->total  = 0;
+            upload->md5    = EVP_MD_CTX_new();
+            upload->sha256 = EVP_MD_CTX_new();
+            g_uploads[path] = upload;
+            created         = true;
+        }
+        upload->busy   = true;
+        upload->active = now;
+    }
+
+    if (!created) {
+        return upload;
+    }
+
+    // resume from whatever a previous session left in the .part file
+    struct stat st;
+    upload->fd = open((path + ".part").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    resetDigests(upload);
+    if (upload->fd < 0 || fstat(upload->fd, &st) != 0 || !hashFile(upload->fd, st.st_size, upload->md5, upload->sha256)) {
+        syslog(LOG_ERR, "open %s.part failed(%s)\n", path.c_str(), strerror(errno));
+        error = "Failed to open the file";
+
+        std::lock_guard<std::mutex> lock(g_uploadMutex);
+        g_uploads.erase(path);
+        freeUpload(upload);
+        return NULL;
+    }
+    upload->offset = st.st_size;
+
+    return upload;
+}
+
+static void releaseUpload(UPLOAD_S* upload, bool finished) {
+    std::lock_guard<std::mutex> lock(g_uploadMutex);
+
+    if (finished) {
+        g_uploads.erase(upload->path);
+        freeUpload(upload);
+        return;
+    }
+
+    upload->busy   = false;
+    upload->active = time(NULL);
+}
+
+// "bytes <start>-<end>/<total>"
+static bool parseContentRange(const std::string& range, uint64_t& start, uint64_t& total) {
+    unsigned long long first, last, size;
+
+    if (sscanf(range.c_str(), "bytes %llu-%llu/%llu", &first, &last, &size) != 3 || first > last || last >= size) {
+        return false;
+    }
+    start = first;
+    total = size;
+
+    return true;
+}
+
+static void beginChunk(const HttpContextPtr& ctx, UPLOAD_REQ_S* req) {
+    std::string path = getUploadPath(ctx);
+    std::string range = ctx->request->GetHeader("Content-Range");
+    uint64_t start = 0, total = 0;
+
+    if (path.empty()) {
+        req->error = "Invalid file name";
+        return;
+    }
+
+    if (range.empty()) {
+        // a whole file in one request
+        total = ctx->request->ContentLength();
+    } else if (!parseContentRange(range, start, total)) {
+        req->error = "Invalid Content-Range";
+        return;
+    }
+
+    req->upload = acquireUpload(path, req->error);
+    if (req->upload == NULL) {
+        return;
+    }
+
+    UPLOAD_S* upload = req->upload;
+    if (start == 0 && (upload->offset != 0 || upload->total != total)) {
+        // (re)start from scratch
+        if (ftruncate(upload->fd, 0) != 0) {
+            req->error = "Failed to truncate the file";
+            return;
+        }
+        upload->offset = 0;
+        resetDigests(upload);
+    } else if (start != upload->offset) {
+        req->error = "Chunk does not start at the uploaded size";
+        return;
+    } else if (upload->total != 0 && upload->total != total) {
+        req->error = "File size changed during the upload";
+        return;
+    }
+    upload->total = total;
+}
+
+static void writeChunk(UPLOAD_REQ_S* req, const char* data, size_t size) {
+    UPLOAD_S* upload = req->upload;
+
+    if (upload == NULL || !req->error.empty()) {
+        return;
+    }
+
+    if (upload->offset + size > upload->total) {
+        req->error = "Chunk exceeds the file size";
+        return;
+    }
+
+    while (size > 0) {
+        ssize_t n = pwrite(upload->fd, data, size, upload->offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            syslog(LOG_ERR, "write %s.part failed(%s)\n", upload->path.c_str(), strerror(errno));
+            req->error = "Failed to write the file";
+            return;
+        }
+        EVP_DigestUpdate(upload->md5, data, n);
+        EVP_DigestUpdate(upload->sha256, data, n);
+        upload->offset += n;
+        data += n;
+        size -= n;
+    }
+}
+
+// verify, then swap the complete file in, false with the error set otherwise
+static bool finishUpload(const HttpContextPtr& ctx, UPLOAD_REQ_S* req, hv::Json& data) {
+    UPLOAD_S* upload   = req->upload;
+    std::string part   = upload->path + ".part";
+    std::string md5    = hexDigest(upload->md5);
+    std::string sha256 = hexDigest(upload->sha256);
+    std::string expect;
+
+    if (((expect = ctx->param("md5")).size() && strcasecmp(expect.c_str(), md5.c_str()) != 0) ||
+        ((expect = ctx->param("sha256")).size() && strcasecmp(expect.c_str(), sha256.c_str()) != 0)) {
+        syslog(LOG_ERR, "checksum mismatch for %s\n", upload->path.c_str());
+        req->error = "Checksum mismatch";
+        unlink(part.c_str());
+        return false;
+    }
+
+    if (fsync(upload->fd) != 0 || rename(part.c_str(), upload->path.c_str()) != 0) {
+        syslog(LOG_ERR, "save %s failed(%s)\n", upload->path.c_str(), strerror(errno));
+        req->error = "Failed to save the file";
+        unlink(part.c_str());
+        return false;
+    }
+
+    // make the rename itself durable
+    std::vector<char> dir(upload->path.begin(), upload->path.end());
+    dir.push_back('\0');
+    int dirFd = open(dirname(dir.data()), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    rememberDigest(upload->path, md5, sha256);
+    data["md5"]    = md5;
+    data["sha256"] = sha256;
+
+    if (ctx->param("target") == "app") {
+        std::string info = installApp(upload->path, ctx->param("appName"), ctx->param("appVersion"));
+        if (info != "Finished") {
+            req->error = info;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int respondChunk(const HttpContextPtr& ctx, UPLOAD_REQ_S* req) {
+    hv::Json response;
+    hv::Json data = hv::Json({});
+    bool finished = false;
+
+    if (req->upload != NULL) {
+        data["offset"] = req->upload->offset;
+        data["total"] = req->upload->total;
+        if (req->error.empty() && req->upload->offset == req->upload->total) {
+            finished = true;
+            if (!finishUpload(ctx, req, data)) {
+                data["offset"] = 0;
+            }
+        }
+        releaseUpload(req->upload, finished);
+        req->upload = NULL;
+    }
+
+    if (req->error.empty()) {
+        response["code"] = 0;
+        response["msg"] = finished ? "Upload file successfully" : "";
+    } else {
+        response["code"] = -1;
+        response["msg"] = req->error;
+    }
+    response["data"] = data;
+
+    return ctx->response->Json(response);
+}
+
+int uploadChunk(const HttpContextPtr& ctx, http_parser_state state, const char* data, size_t size) {
+    UPLOAD_REQ_S* req = (UPLOAD_REQ_S*)ctx->userdata;
+    int ret = HTTP_STATUS_UNFINISHED;
+
+    switch (state) {
+        case HP_HEADERS_COMPLETE:
+            req = new UPLOAD_REQ_S;
+            req->upload = NULL;
+            ctx->userdata = req;
+            beginChunk(ctx, req);
+            break;
+
+        case HP_BODY:
+            if (req != NULL && data != NULL && size > 0) {
+                writeChunk(req, data, size);
+            }
+            break;
+
+        case HP_MESSAGE_COMPLETE:
+            if (req != NULL) {
+                ret = respondChunk(ctx, req);
+                delete req;
+                ctx->userdata = NULL;
+            }
+            break;
+
+        case HP_ERROR:
+            // connection lost: what was written stays in the .part file for the next attempt
+            if (req != NULL) {
+                if (req->upload != NULL) {
+                    releaseUpload(req->upload, false);
+                }
+                delete req;
+                ctx->userdata = NULL;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+int queryUpload(HttpRequest* req, HttpResponse* resp) {
+    std::string target = req->GetParam("target", "file");
+    std::string filePath = req->GetParam("filePath");
+    std::string path;
+    hv::Json response;
+    struct stat st;
+
+    if (target == "model") {
+        path = PATH_MODEL_DOWNLOAD_DIR "model.cvimodel";
+    } else if (isLegalPath(filePath) && !filePath.empty()) {
+        path = PATH_APP_DOWNLOAD_DIR + filePath;
+    } else {
+        response["code"] = -1;
+        response["msg"] = "Invalid file name";
+        response["data"] = hv::Json({});
+        return resp->Json(response);
+    }
+
+    response["code"] = 0;
+    response["msg"] = "";
+    response["data"]["offset"] = 0;
+    response["data"]["total"] = 0;
+
+    std::lock_guard<std::mutex> lock(g_uploadMutex);
+    auto it = g_uploads.find(path);
+    if (it != g_uploads.end()) {
+        response["data"]["offset"] = it->second->offset;
+        response["data"]["total"] = it->second->total;
+    } else if (stat((path + ".part").c_str(), &st) == 0) {
+        response["data"]["offset"] = (uint64_t)st.st_size;
+    }
+
+    return resp->Json(response);
+}
+
 int queryFileList(HttpRequest* req, HttpResponse* resp) {
     DIR* dir;
     struct dirent* ent;
@@ -78,7 +568,11 @@ int uploadFile(HttpRequest* req, HttpResponse* resp) {
 
     filePath = PATH_APP_DOWNLOAD_DIR + filePath;
     createFolder(PATH_APP_DOWNLOAD_DIR);
-    ret = req->SaveFile(filePath.c_str());
+    ret = req->SaveFile((filePath + ".part").c_str());
+    if (200 == ret && rename((filePath + ".part").c_str(), filePath.c_str()) != 0) {
+        ret = -1;
+    }
+    forgetDigest(filePath);
     if (200 == ret) {
         response["code"] = 0;
         response["msg"] = "Upload file successfully";
@@ -109,6 +603,7 @@ int deleteFile(HttpRequest* req, HttpResponse* resp) {
 
     filePath = PATH_APP_DOWNLOAD_DIR + filePath;
     ret = remove(filePath.c_str());
+    forgetDigest(filePath);
 
     if (0 == ret) {
         response["code"] = ret;
@@ -1,20 +1,27 @@
 #include <algorithm>
 #include <arpa/inet.h>
+#include <chrono>
 #include <iostream>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <map>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
 #include <syslog.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 #include "common.h"
 #include "global_cfg.h"
 #include "hv/HttpServer.h"
 #include "utils_wifi.h"
+#include "utils_wpa.h"
 
 typedef struct _WIFI_INFO_S {
     int id;
@@ -30,6 +37,38 @@ bool g_wifiConnecting = false;
 int g_wifiMode        = 1;
 int g_etherConnected  = 0;
 
+static WpaCtrl g_wpa(PATH_WPA_CTRL);
+
+// reply of a command without its trailing newline
+static std::string wpaRequest(const std::string& cmd) {
+    std::string reply = g_wpa.request(cmd);
+    if (!reply.empty() && reply.back() == '\n') {
+        reply.pop_back();
+    }
+    return reply;
+}
+
+// tab separated lines of a table reply, the header line skipped
+static std::vector<std::vector<std::string>> wpaTable(const std::string& reply) {
+    std::vector<std::vector<std::string>> rows;
+    size_t pos = reply.find('\n');
+
+    while (pos != std::string::npos && pos + 1 < reply.size()) {
+        size_t end = reply.find('\n', pos + 1);
+        std::string line = reply.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+        std::vector<std::string> row;
+        size_t start = 0;
+        for (size_t tab; (tab = line.find('\t', start)) != std::string::npos; start = tab + 1) {
+            row.push_back(line.substr(start, tab - start));
+        }
+        row.push_back(line.substr(start));
+        rows.push_back(row);
+        pos = end;
+    }
+
+    return rows;
+}
+
 int exec_cmd(const char* cmd, char* result, const char* param)
 {
     FILE* fp;
@@ -60,93 +99,29 @@ int exec_cmd(const char* cmd, char* result, const char* param)
 }
 
 static int getWifiInfo(std::vector<std::string>& wifiStatus) {
-    FILE* fp;
-    char info[128];
-    int index = 0;
+    auto status = g_wpa.status();
 
-    fp = popen(SCRIPT_WIFI_STATUS, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", SCRIPT_WIFI_STATUS, strerror(errno));
-        return -1;
-    }
-
-    while (fgets(info, sizeof(info) - 1, fp) != NULL) {
-        wifiStatus[index] = std::string(info);
-        if (wifiStatus[index].back() == '\n') {
-            wifiStatus[index].erase(wifiStatus[index].size() - 1);
-        }
+    wifiStatus[0] = wpaDecode(status["ssid"]);
+    wifiStatus[1] = status["key_mgmt"];
+    wifiStatus[2] = status["ip_address"];
+    wifiStatus[3] = status["address"];
 
-        ++index;
-    }
-
-    pclose(fp);
     return 0;
 }
 
 std::string getWifiConnectStatus() {
-    FILE* fp;
-    char cmd[128]           = SCRIPT_WIFI_CONNECT_STATUS;
-    char connectStatus[128] = "";
-    int len                 = 0;
-
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        return std::string("Failed");
-    }
-
-    fgets(connectStatus, sizeof(connectStatus) - 1, fp);
-    len = strlen(connectStatus);
-    if (connectStatus[len - 1] == '\n') {
-        connectStatus[len - 1] = '\0';
-    }
-
-    pclose(fp);
-    return std::string(connectStatus);
+    return g_wpa.status()["wpa_state"];
 }
 
 static std::string getWifiId() {
-    FILE* fp;
-    char cmd[128]  = SCRIPT_WIFI_GET_WIFI_ID;
-    char info[128] = "";
-    int len        = 0;
-
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        return std::string("-1");
-    }
-
-    fgets(info, sizeof(info) - 1, fp);
-    len = strlen(info);
-    if (info[len - 1] == '\n') {
-        info[len - 1] = '\0';
-    }
-    pclose(fp);
+    auto status = g_wpa.status();
+    auto it     = status.find("id");
 
-    return std::string(info);
+    return it == status.end() ? std::string("-1") : it->second;
 }
 
 std::string getWifiIp() {
-    FILE* fp;
-    char cmd[128]  = SCRIPT_WIFI_GET_WIFI_IP;
-    char info[128] = "";
-    int len        = 0;
-
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        return std::string("");
-    }
-
-    fgets(info, sizeof(info) - 1, fp);
-    len = strlen(info);
-    if (info[len - 1] == '\n') {
-        info[len - 1] = '\0';
-    }
-    pclose(fp);
-
-    return std::string(info);
+    return g_wpa.status()["ip_address"];
 }
 
 bool isLegalWifiIp() {
@@ -188,36 +163,20 @@ std::string getGateWay(std::string ip) {
 }
 
 static int selectWifi(std::string id) {
-    char cmd[128] = SCRIPT_WIFI_SELECT;
-
-    strcat(cmd, id.c_str());
-    system(cmd);
+    wpaRequest("SELECT_NETWORK " + id);
 
     return 0;
 }
 
 static std::string removeWifi(std::string id) {
-    FILE* fp;
-    char info[128] = "";
-    char cmd[128]  = SCRIPT_WIFI_REMOVE;
-    int len        = 0;
-
-    strcat(cmd, id.c_str());
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        return std::string(info);
-    }
+    auto replies = g_wpa.request({"DISABLE_NETWORK " + id, "REMOVE_NETWORK " + id, "SAVE_CONFIG"});
+    std::string info = replies[0];
 
-    if (fgets(info, sizeof(info) - 1, fp) != NULL) {
-        len = strlen(info);
-        if (info[len - 1] == '\n') {
-            info[len - 1] = '\0';
-        }
+    if (!info.empty() && info.back() == '\n') {
+        info.pop_back();
     }
 
-    pclose(fp);
-    return std::string(info);
+    return info;
 }
 
 static void startAp() {
@@ -253,31 +212,20 @@ static int deduplicate(std::vector<std::vector<std::string>>& wifiList) {
 }
 
 static int getWifiList() {
-    FILE* fp;
-    char info[128];
-    char cmd[128] = SCRIPT_WIFI_SCAN_RESULTS;
+    std::string reply = g_wpa.scanResults();
     std::vector<std::vector<std::string>> wifiList;
 
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        return -1;
+    if (reply.empty()) {
+        return 0;
     }
 
-    while (fgets(info, sizeof(info) - 1, fp) != NULL) {
-        std::vector<std::string> wifi;
-
-        char* token = strtok(info, "\t");
-        while (token != NULL) {
-            wifi.push_back(std::string(token));
-            token = strtok(NULL, "\t");
-        }
-
-        if (!wifi.empty()) {
-            // TODO:: Need to determine if wifi is encrypted or not
-            wifi[2] = "1";
-            wifiList.push_back(wifi);
+    // bssid, frequency, signal level, flags, ssid -> ssid, signal, auth, bssid
+    for (auto& row : wpaTable(reply)) {
+        if (row.size() < 5 || row[4].empty()) {
+            continue;
         }
+        // TODO:: Need to determine if wifi is encrypted or not
+        wifiList.push_back({wpaDecode(row[4]), row[2], "1", row[0]});
     }
 
     if (!wifiList.empty()) {
@@ -287,50 +235,35 @@ static int getWifiList() {
         g_wifiList = wifiList;
     }
 
-    pclose(fp);
     return 0;
 }
 
 static int updateConnectedWifiInfo() {
-    FILE* fp;
-    char info[128];
-    int len = 0;
-
     syslog(LOG_INFO, "updateConnectedWifiInfo operation...\n");
 
     g_wifiInfo.clear();
 
-    fp = popen(SCRIPT_WIFI_LIST, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", SCRIPT_WIFI_LIST, strerror(errno));
+    std::string reply = g_wpa.listNetworks();
+    if (reply.empty()) {
         return -1;
     }
 
-    while (fgets(info, sizeof(info) - 1, fp) != NULL) {
-        std::vector<std::string> wifi;
-
-        len = strlen(info);
-        if (info[len - 1] == '\n') {
-            info[len - 1] = '\0';
-        }
-
-        char* token = strtok(info, "\t");
-        while (token != NULL) {
-            wifi.push_back(std::string(token));
-            token = strtok(NULL, "\t");
+    // network id, ssid, bssid, flags
+    for (auto& row : wpaTable(reply)) {
+        if (row.size() < 2) {
+            continue;
         }
 
-        g_wifiInfo[wifi[1]].id              = stoi(wifi[0]);
-        g_wifiInfo[wifi[1]].connectedStatus = 1;
-        if (wifi.size() >= 3 && wifi[2] == "[DISABLED]") {
-            g_wifiInfo[wifi[1]].autoConnect = 0;
+        std::string ssid           = wpaDecode(row[1]);
+        g_wifiInfo[ssid].id              = stoi(row[0]);
+        g_wifiInfo[ssid].connectedStatus = 1;
+        if (row.size() >= 4 && row[3].find("[DISABLED]") != std::string::npos) {
+            g_wifiInfo[ssid].autoConnect = 0;
         } else {
-            g_wifiInfo[wifi[1]].autoConnect = 1;
+            g_wifiInfo[ssid].autoConnect = 1;
         }
     }
 
-    pclose(fp);
-
     return 0;
 }
 
@@ -486,27 +419,98 @@ std::string getNetmaskAddress(const char* ifrName) {
     return std::string(netmask);
 }
 
+static int openLinkEvents() {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        syslog(LOG_ERR, "netlink socket failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        syslog(LOG_ERR, "netlink bind failed: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// drain the pending link/address messages, true if one of them is about wlan0
+static bool readLinkEvents(int fd) {
+    char buf[4096];
+    bool changed = false;
+    int index    = if_nametoindex("wlan0");
+
+    for (;;) {
+        ssize_t len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len <= 0) {
+            break;
+        }
+        for (struct nlmsghdr* nh = (struct nlmsghdr*)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK) {
+                changed |= ((struct ifinfomsg*)NLMSG_DATA(nh))->ifi_index == index;
+            } else if (nh->nlmsg_type == RTM_NEWADDR || nh->nlmsg_type == RTM_DELADDR) {
+                changed |= (int)((struct ifaddrmsg*)NLMSG_DATA(nh))->ifa_index == index;
+            }
+        }
+    }
+
+    return changed;
+}
+
 void monitorWifiStatusThread() {
+    using namespace std::chrono;
+
     std::string wifiStatus;
-    bool apStatus    = true;
-    unsigned int cnt = 0;
+    bool apStatus = true;
+    int fd        = openLinkEvents();
+    steady_clock::time_point connected;
+    bool stable = false;
+    bool first  = true;
 
+    g_wpa.start();
+
+    // woken by wlan0 link and address changes or wpa_supplicant state events, the timeout only
+    // covers the AP switch-off delay and a slow fallback in case an event is missed (or every 10s
+    // without netlink)
     while (g_wifiStatus) {
-        std::this_thread::sleep_for(std::chrono::seconds(10));
+        milliseconds timeout = fd < 0 || first ? seconds(10) : seconds(60);
+        first                = false;
+        if (apStatus && stable) {
+            timeout = std::min(timeout, duration_cast<milliseconds>(connected + seconds(120) - steady_clock::now()));
+            timeout = std::max(timeout, milliseconds(0));
+        }
+
+        // a missing netlink socket (-1) is ignored by poll
+        struct pollfd pfd[2] = {{fd, POLLIN, 0}, {g_wpa.eventFd(), POLLIN, 0}};
+        if (poll(pfd, 2, timeout.count()) > 0) {
+            uint64_t events;
+            bool wpaEvent = (pfd[1].revents & POLLIN) && read(pfd[1].fd, &events, sizeof(events)) > 0;
+            bool netEvent = (pfd[0].revents & POLLIN) && readLinkEvents(fd);
+            if (!wpaEvent && !netEvent) {
+                continue;
+            }
+        }
+
         wifiStatus = getWifiConnectStatus();
 
         if (wifiStatus == "COMPLETED" && isLegalWifiIp()) {
-            if (apStatus) {
-                if (++cnt >= 12) {
-                    apStatus = false;
-                    stopAp();
-                }
+            if (!stable) {
+                stable    = true;
+                connected = steady_clock::now();
+            } else if (apStatus && steady_clock::now() - connected >= seconds(120)) {
+                apStatus = false;
+                stopAp();
             }
 
             continue;
         }
 
-        cnt = 0;
+        stable = false;
 
         if (wifiStatus == "DISCONNECTED" || wifiStatus == "INACTIVE" || wifiStatus == "Failed") {
             if (!apStatus) {
@@ -515,6 +519,12 @@ void monitorWifiStatusThread() {
             }
         }
     }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    g_wpa.stop();
 }
 
 int queryWiFiInfo(HttpRequest* req, HttpResponse* resp) {
@@ -557,28 +567,16 @@ int queryWiFiInfo(HttpRequest* req, HttpResponse* resp) {
 int scanWiFi(HttpRequest* req, HttpResponse* resp) {
     syslog(LOG_INFO, "scan WiFi operation...\n");
     hv::Json response;
-    FILE* fp;
-    char cmd[128]  = SCRIPT_WIFI_SCAN;
-    char info[128] = "";
-    int len        = 0;
+    std::string info = wpaRequest("SCAN");
 
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
+    if (info.empty()) {
         response["code"] = -1;
         response["msg"]  = "Failed to scan WiFi";
         response["data"] = hv::Json({});
         return resp->Json(response);
     }
 
-    fgets(info, sizeof(info) - 1, fp);
-    len = strlen(info);
-    if (info[len - 1] == '\n') {
-        info[len - 1] = '\0';
-    }
-    pclose(fp);
-
-    if (strcmp(info, "OK") == 0) {
+    if (info == "OK") {
         response["code"] = 0;
         response["msg"]  = "Scan wifi successfully";
     } else {
@@ -699,9 +697,6 @@ int connectWiFi(HttpRequest* req, HttpResponse* resp) {
     std::string msg, currentWifiId;
     bool status = true;
     int id = 0, connecting = 0, connectCnt = 0, ipAssignmentCnt = 0;
-    FILE* fp;
-    char info[256];
-    char cmd[256] = "";
 
     if (g_wifiConnecting) {
         std::string wifiStatus = getWifiConnectStatus();
@@ -717,43 +712,36 @@ int connectWiFi(HttpRequest* req, HttpResponse* resp) {
     g_wifiConnecting = true;
     currentWifiId    = getWifiId();
     if (req->GetString("password").empty()) {
-        strcpy(cmd, SCRIPT_WIFI_SELECT);
         updateConnectedWifiInfo();
-        id = g_wifiInfo[req->GetString("ssid")].id;
-        strcat(cmd, std::to_string(id).c_str());
+        id  = g_wifiInfo[req->GetString("ssid")].id;
+        msg = wpaRequest("SELECT_NETWORK " + std::to_string(id));
     } else {
-        strcpy(cmd, SCRIPT_WIFI_CONNECT);
-        strcat(cmd, "'");
-        strcat(cmd, req->GetString("ssid").c_str());
-        strcat(cmd, "' '");
-        strcat(cmd, req->GetString("password").c_str());
-        strcat(cmd, "'");
-    }
-
-    syslog(LOG_DEBUG, "cmd: %s\n", cmd);
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
-        response["code"] = -1;
-        response["msg"]  = "Failed to connect WiFi";
-        response["data"] = hv::Json({});
-        g_wifiConnecting = false;
-        return resp->Json(response);
-    }
-
-    if (fgets(info, sizeof(info) - 1, fp) != NULL) {
-        id = stoi(std::string(info));
-    }
+        std::string reply = wpaRequest("ADD_NETWORK");
+        if (reply.empty() || !isdigit((unsigned char)reply[0])) {
+            syslog(LOG_ERR, "Failed to add network(%s)\n", reply.c_str());
+            response["code"] = -1;
+            response["msg"]  = "Failed to connect WiFi";
+            response["data"] = hv::Json({});
+            g_wifiConnecting = false;
+            return resp->Json(response);
+        }
+        id = stoi(reply);
 
-    if (fgets(info, sizeof(info) - 1, fp) != NULL) {
-        msg = std::string(info);
-        if (msg.back() == '\n') {
-            msg.erase(msg.size() - 1);
+        std::string network = "SET_NETWORK " + std::to_string(id);
+        auto replies = g_wpa.request({network + " ssid " + wpaHex(req->GetString("ssid")), network + " psk \"" + req->GetString("password") + "\""});
+        if (replies[0].compare(0, 2, "OK") != 0 || replies[1].compare(0, 2, "OK") != 0) {
+            msg = "Invalid password";
+            wpaRequest("REMOVE_NETWORK " + std::to_string(id));
+        } else {
+            std::string index = std::to_string(id);
+            replies = g_wpa.request({"ENABLE_NETWORK " + index, "SELECT_NETWORK " + index, "SAVE_CONFIG"});
+            msg = replies[0];
+            if (!msg.empty() && msg.back() == '\n') {
+                msg.pop_back();
+            }
         }
     }
 
-    pclose(fp);
-
     if (msg.compare("OK") != 0) {
         response["code"] = -1;
         response["msg"]  = msg;
@@ -830,11 +818,7 @@ int disconnectWiFi(HttpRequest* req, HttpResponse* resp) {
     syslog(LOG_INFO, "ssid: %s\n", req->GetString("ssid").c_str());
 
     hv::Json response;
-    std::string currentId;
-    FILE* fp;
-    char info[128] = "";
-    char cmd[128]  = SCRIPT_WIFI_DISCONNECT;
-    int len        = 0;
+    std::string currentId, info;
 
     updateConnectedWifiInfo();
     currentId = getWifiId();
@@ -845,23 +829,15 @@ int disconnectWiFi(HttpRequest* req, HttpResponse* resp) {
         return resp->Json(response);
     }
 
-    fp = popen(cmd, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", cmd, strerror(errno));
+    info = wpaRequest("DISCONNECT");
+    if (info.empty()) {
         response["code"] = -1;
         response["msg"]  = "Failed to disconnect WiFi";
         response["data"] = hv::Json({});
         return resp->Json(response);
     }
 
-    fgets(info, sizeof(info) - 1, fp);
-    len = strlen(info);
-    if (info[len - 1] == '\n') {
-        info[len - 1] = '\0';
-    }
-    pclose(fp);
-
-    if (strcmp(info, "OK") == 0) {
+    if (info == "OK") {
         response["code"] = 0;
         response["msg"]  = "Disconnect wifi successfully";
     } else {
@@ -890,42 +866,29 @@ int switchWiFi(HttpRequest* req, HttpResponse* resp) {
 }
 
 int getWifiStatus(HttpRequest* req, HttpResponse* resp) {
-    FILE* fp;
-    char info[128];
     hv::Json response, data;
 
     response["code"] = 0;
     response["msg"]  = "";
 
-    fp = popen(SCRIPT_WIFI_STATE, "r");
-    if (fp == NULL) {
-        syslog(LOG_ERR, "Failed to run `%s`(%s)\n", SCRIPT_WIFI_STATE, strerror(errno));
-        return -1;
-    }
-
-    if (fgets(info, sizeof(info) - 1, fp) != NULL) {
-        std::string s(info);
-        if (s.back() == '\n') {
-            s.erase(s.size() - 1);
-        }
-
-        if (s.compare("COMPLETED") == 0) {
-            g_wifiMode     = 3;  // wifi connected
-            data["status"] = 1;  // wifi connected
-        } else if (s.compare("INACTIVE") == 0) {
-            g_wifiMode     = 1;  // wifi is on
-            data["status"] = 2;  // wifi not connected
-        } else {
-            g_wifiMode     = 2;  // wifi connecting
-            data["status"] = 2;  // wifi not connected
-        }
+    std::string s = getWifiConnectStatus();
+    if (s.empty()) {
+        syslog(LOG_ERR, "Failed to get the state of wpa_supplicant\n");
+    } else if (s.compare("COMPLETED") == 0) {
+        g_wifiMode     = 3;  // wifi connected
+        data["status"] = 1;  // wifi connected
+    } else if (s.compare("INACTIVE") == 0) {
+        g_wifiMode     = 1;  // wifi is on
+        data["status"] = 2;  // wifi not connected
+    } else {
+        g_wifiMode     = 2;  // wifi connecting
+        data["status"] = 2;  // wifi not connected
     }
 
     if (g_etherConnected) {
         data["status"] = 0;  // ethernet connected
     }
 
-    pclose(fp);
     response["data"] = data;
 
     return resp->Json(response);
@@ -936,16 +899,13 @@ int autoConnectWiFi(HttpRequest* req, HttpResponse* resp) {
     syslog(LOG_INFO, "ssid: %s\n", req->GetString("ssid").c_str());
     syslog(LOG_INFO, "mode: %s\n", req->GetString("mode").c_str());
 
-    char cmd[128] = SCRIPT_WIFI_AUTO_CONNECT;
-    int id        = 0;
+    int id = 0;
 
     updateConnectedWifiInfo();
     id = g_wifiInfo[req->GetString("ssid")].id;
 
-    strcat(cmd, std::to_string(id).c_str());
-    strcat(cmd, " ");
-    strcat(cmd, req->GetString("mode").c_str());
-    system(cmd);
+    std::string action = req->GetString("mode") == "1" ? "ENABLE_NETWORK " : "DISABLE_NETWORK ";
+    g_wpa.request({action + std::to_string(id), "SAVE_CONFIG"});
 
     hv::Json response;
     response["code"] = 0;
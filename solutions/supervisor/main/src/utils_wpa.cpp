@@ -0,0 +1,416 @@
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "utils_wpa.h"
+
+#define WPA_REPLY_SIZE    16384
+#define WPA_PING_INTERVAL 5 // seconds, a killed wpa_supplicant sends no event
+#define WPA_ATTACH_RETRY  2 // seconds
+
+WpaCtrl::WpaCtrl(const std::string& path)
+    : m_path(path), m_cmdFd(-1), m_monFd(-1), m_eventFd(-1), m_running(false), m_attached(false) {
+    m_scan.filled         = UINT32_MAX;
+    m_scan.generation     = 0;
+    m_networks.filled     = UINT32_MAX;
+    m_networks.generation = 0;
+    m_eventFd             = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+WpaCtrl::~WpaCtrl() {
+    stop();
+    if (m_eventFd >= 0) {
+        close(m_eventFd);
+    }
+}
+
+bool WpaCtrl::start() {
+    if (m_running) {
+        return true;
+    }
+
+    m_running = true;
+    m_thread  = std::thread(&WpaCtrl::monitor, this);
+
+    return true;
+}
+
+void WpaCtrl::stop() {
+    if (!m_running) {
+        return;
+    }
+
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    closeSocket(m_cmdFd);
+}
+
+int WpaCtrl::eventFd() const {
+    return m_eventFd;
+}
+
+// same scheme as wpa_ctrl: a bound datagram socket per client, so the daemon can answer
+int WpaCtrl::openSocket(const char* tag) {
+    struct sockaddr_un local, dest;
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+    snprintf(local.sun_path, sizeof(local.sun_path), "/tmp/wpa_ctrl_supervisor-%d-%s", getpid(), tag);
+    unlink(local.sun_path);
+    if (bind(fd, (struct sockaddr*)&local, sizeof(local)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    memset(&dest, 0, sizeof(dest));
+    dest.sun_family = AF_UNIX;
+    strncpy(dest.sun_path, m_path.c_str(), sizeof(dest.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&dest, sizeof(dest)) < 0) {
+        unlink(local.sun_path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void WpaCtrl::closeSocket(int& fd) {
+    if (fd < 0) {
+        return;
+    }
+
+    struct sockaddr_un local;
+    socklen_t len = sizeof(local);
+    if (getsockname(fd, (struct sockaddr*)&local, &len) == 0 && len > sizeof(sa_family_t)) {
+        unlink(local.sun_path);
+    }
+    close(fd);
+    fd = -1;
+}
+
+static bool recvReply(int fd, std::string& reply, int timeoutMs) {
+    static thread_local char buf[WPA_REPLY_SIZE];
+
+    for (;;) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeoutMs) <= 0) {
+            return false;
+        }
+
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            return false;
+        }
+
+        // unsolicited "<level>" messages only reach attached sockets
+        if (len > 0 && buf[0] == '<') {
+            continue;
+        }
+
+        reply.assign(buf, len);
+        return true;
+    }
+}
+
+bool WpaCtrl::sendRecv(const std::vector<std::string>& cmds, std::vector<std::string>& replies, int timeoutMs) {
+    // the daemon may have been restarted since the last request, reconnect once
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (m_cmdFd < 0) {
+            m_cmdFd = openSocket("cmd");
+            if (m_cmdFd < 0) {
+                return false;
+            }
+        }
+
+        bool sent = true;
+        for (const auto& cmd : cmds) {
+            if (send(m_cmdFd, cmd.data(), cmd.size(), 0) < 0) {
+                sent = false;
+                break;
+            }
+        }
+        if (!sent) {
+            closeSocket(m_cmdFd);
+            continue;
+        }
+
+        replies.resize(cmds.size());
+        for (auto& reply : replies) {
+            if (!recvReply(m_cmdFd, reply, timeoutMs)) {
+                // a late reply would be read as the answer of the next request
+                syslog(LOG_ERR, "wpa_supplicant did not answer `%s`\n", cmds.front().c_str());
+                closeSocket(m_cmdFd);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+std::vector<std::string> WpaCtrl::request(const std::vector<std::string>& cmds, int timeoutMs) {
+    std::vector<std::string> replies;
+    bool networks = false;
+
+    // commands changing the saved networks or their flags outdate the cached list
+    for (const auto& cmd : cmds) {
+        networks |= cmd.compare(0, 4, "ADD_") == 0 || cmd.compare(0, 7, "REMOVE_") == 0 || cmd.compare(0, 4, "SET_") == 0 ||
+                    cmd.compare(0, 7, "ENABLE_") == 0 || cmd.compare(0, 8, "DISABLE_") == 0 || cmd.compare(0, 7, "SELECT_") == 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!sendRecv(cmds, replies, timeoutMs)) {
+            replies.assign(cmds.size(), "");
+        }
+    }
+
+    if (networks) {
+        invalidate(m_networks);
+    }
+
+    return replies;
+}
+
+std::string WpaCtrl::request(const std::string& cmd, int timeoutMs) {
+    return request(std::vector<std::string>{cmd}, timeoutMs)[0];
+}
+
+std::map<std::string, std::string> WpaCtrl::status() {
+    std::map<std::string, std::string> result;
+    std::string reply = request("STATUS");
+    size_t pos        = 0;
+
+    while (pos < reply.size()) {
+        size_t end = reply.find('\n', pos);
+        if (end == std::string::npos) {
+            end = reply.size();
+        }
+        size_t eq = reply.find('=', pos);
+        if (eq != std::string::npos && eq < end) {
+            result[reply.substr(pos, eq - pos)] = reply.substr(eq + 1, end - eq - 1);
+        }
+        pos = end + 1;
+    }
+
+    return result;
+}
+
+std::string WpaCtrl::cached(Cache& cache, const char* cmd) {
+    uint32_t generation = cache.generation.load();
+
+    if (m_attached) {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        if (cache.filled == generation) {
+            return cache.reply;
+        }
+    }
+
+    std::string reply = request(cmd);
+
+    // only keep it if no event arrived meanwhile
+    if (m_attached && !reply.empty() && reply.compare(0, 4, "FAIL") != 0) {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        if (cache.generation.load() == generation) {
+            cache.reply  = reply;
+            cache.filled = generation;
+        }
+    }
+
+    return reply;
+}
+
+void WpaCtrl::invalidate(Cache& cache) {
+    cache.generation++;
+}
+
+std::string WpaCtrl::scanResults() {
+    return cached(m_scan, "SCAN_RESULTS");
+}
+
+std::string WpaCtrl::listNetworks() {
+    return cached(m_networks, "LIST_NETWORKS");
+}
+
+bool WpaCtrl::attach() {
+    std::string reply;
+
+    m_monFd = openSocket("mon");
+    if (m_monFd < 0) {
+        return false;
+    }
+
+    if (send(m_monFd, "ATTACH", 6, 0) < 0 || !recvReply(m_monFd, reply, 2000) || reply.compare(0, 2, "OK") != 0) {
+        closeSocket(m_monFd);
+        return false;
+    }
+
+    invalidate(m_scan);
+    invalidate(m_networks);
+    m_attached = true;
+    syslog(LOG_INFO, "attached to %s\n", m_path.c_str());
+
+    return true;
+}
+
+void WpaCtrl::onEvent(const char* event) {
+    if (strncmp(event, "CTRL-EVENT-SCAN-RESULTS", 23) == 0 || strncmp(event, "CTRL-EVENT-BSS-", 15) == 0) {
+        invalidate(m_scan);
+        return;
+    }
+
+    if (strncmp(event, "CTRL-EVENT-NETWORK-", 19) == 0) {
+        invalidate(m_networks);
+        return;
+    }
+
+    if (strncmp(event, "CTRL-EVENT-CONNECTED", 20) == 0 || strncmp(event, "CTRL-EVENT-DISCONNECTED", 23) == 0 ||
+        strncmp(event, "CTRL-EVENT-STATE-CHANGE", 23) == 0 || strncmp(event, "CTRL-EVENT-SSID-", 16) == 0) {
+        // the [CURRENT] flag of the network list follows the connection
+        invalidate(m_networks);
+        uint64_t one = 1;
+        write(m_eventFd, &one, sizeof(one));
+    }
+}
+
+void WpaCtrl::monitor() {
+    using namespace std::chrono;
+
+    char buf[WPA_REPLY_SIZE];
+    steady_clock::time_point lastPing;
+    bool pinged = false;
+
+    while (m_running) {
+        if (!m_attached) {
+            if (!attach()) {
+                for (int i = 0; i < WPA_ATTACH_RETRY * 10 && m_running; i++) {
+                    std::this_thread::sleep_for(milliseconds(100));
+                }
+                continue;
+            }
+            lastPing = steady_clock::now();
+            pinged   = false;
+        }
+
+        bool lost         = false;
+        struct pollfd pfd = {m_monFd, POLLIN, 0};
+        if (poll(&pfd, 1, 500) > 0) {
+            ssize_t len = recv(m_monFd, buf, sizeof(buf) - 1, 0);
+            if (len <= 0) {
+                lost = true;
+            } else {
+                buf[len]    = '\0';
+                char* event = buf;
+                if (event[0] == '<') {
+                    char* end = strchr(event, '>');
+                    event     = end ? end + 1 : event;
+                }
+                if (strncmp(event, "PONG", 4) == 0) {
+                    pinged = false;
+                } else if (strncmp(event, "CTRL-EVENT-TERMINATING", 22) == 0) {
+                    lost = true;
+                } else {
+                    onEvent(event);
+                }
+            }
+        }
+
+        if (!lost && steady_clock::now() - lastPing >= seconds(WPA_PING_INTERVAL)) {
+            // the previous ping was not answered, or the daemon is gone
+            lost     = pinged || send(m_monFd, "PING", 4, 0) < 0;
+            pinged   = true;
+            lastPing = steady_clock::now();
+        }
+
+        if (lost) {
+            syslog(LOG_ERR, "lost %s\n", m_path.c_str());
+            m_attached = false;
+            closeSocket(m_monFd);
+            invalidate(m_scan);
+            invalidate(m_networks);
+            uint64_t one = 1;
+            write(m_eventFd, &one, sizeof(one));
+        }
+    }
+
+    if (m_attached) {
+        send(m_monFd, "DETACH", 6, 0);
+        m_attached = false;
+    }
+    closeSocket(m_monFd);
+}
+
+// inverse of the printf_encode() escaping used for SSIDs in the replies
+std::string wpaDecode(const std::string& str) {
+    std::string out;
+
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] != '\\' || i + 1 >= str.size()) {
+            out += str[i];
+            continue;
+        }
+
+        char c = str[++i];
+        switch (c) {
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'e':
+                out += '\033';
+                break;
+            case 'x':
+                if (i + 2 < str.size() && isxdigit(str[i + 1]) && isxdigit(str[i + 2])) {
+                    out += (char)strtol(str.substr(i + 1, 2).c_str(), NULL, 16);
+                    i += 2;
+                } else {
+                    out += c;
+                }
+                break;
+            default:
+                out += c;
+                break;
+        }
+    }
+
+    return out;
+}
+
+std::string wpaHex(const std::string& str) {
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+
+    out.reserve(str.size() * 2);
+    for (unsigned char c : str) {
+        out += hex[c >> 4];
+        out += hex[c & 0x0f];
+    }
+
+    return out;
+}
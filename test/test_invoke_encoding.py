@@ -0,0 +1,149 @@
+import argparse
+import base64
+import json
+import struct
+import threading
+import time
+
+import websocket
+
+# decoder of the compact invoke events of the model node, see docs/sscma-node-protocol.md
+
+HEADER = struct.Struct("<2sBBIHHHBB")
+KIND_LABELS = 1
+KIND_RESULT = 2
+FLAG_TRACKS = 0x01
+FLAG_IMAGE = 0x02
+
+OUTPUT_CLASS = 1
+OUTPUT_BBOX = 3
+OUTPUT_KEYPOINT = 4
+OUTPUT_SEGMENT = 5
+
+BOX = struct.Struct("<hhhhbxH")
+
+
+class InvokeDecoder:
+    def __init__(self):
+        self.labels = []
+
+    def label(self, target):
+        if target < len(self.labels):
+            return self.labels[target]
+        return f"N/A-{target}"
+
+    def decode(self, packet):
+        """Returns the invoke event as the JSON path would, or None for a label table."""
+        magic, version, kind, count, width, height, items, output, flags = HEADER.unpack_from(packet, 0)
+        if magic != b"MB" or version != 1:
+            raise ValueError(f"not an invoke packet: {magic} v{version}")
+        offset = HEADER.size
+
+        if kind == KIND_LABELS:
+            self.labels = []
+            for _ in range(items):
+                length = packet[offset]
+                self.labels.append(packet[offset + 1:offset + 1 + length].decode())
+                offset += 1 + length
+            return None
+
+        data = {"count": count, "resolution": [width, height], "labels": []}
+        data["perf"] = [list(struct.unpack_from("<HHH", packet, offset))]
+        offset += 6
+
+        results = []
+        for _ in range(items):
+            if output == OUTPUT_CLASS:
+                score, target = struct.unpack_from("<bxH", packet, offset)
+                offset += 4
+                results.append([score, target])
+                data["labels"].append(self.label(target))
+                continue
+            box = list(BOX.unpack_from(packet, offset))
+            offset += BOX.size
+            data["labels"].append(self.label(box[5]))
+            if output == OUTPUT_KEYPOINT:
+                (n,) = struct.unpack_from("<H", packet, offset)
+                offset += 2
+                pts = [list(struct.unpack_from("<hhbx", packet, offset + 6 * i)) for i in range(n)]
+                offset += 6 * n
+                results.append([box, pts])
+            elif output == OUTPUT_SEGMENT:
+                (n,) = struct.unpack_from("<H", packet, offset)
+                offset += 2
+                contour = list(struct.unpack_from(f"<{n}H", packet, offset))
+                offset += 2 * n
+                results.append([box, contour])
+            else:
+                results.append(box)
+
+        key = {OUTPUT_CLASS: "classes", OUTPUT_KEYPOINT: "keypoints", OUTPUT_SEGMENT: "segments"}.get(output, "boxes")
+        data[key] = results
+
+        if flags & FLAG_TRACKS:
+            data["tracks"] = list(struct.unpack_from(f"<{items}i", packet, offset))
+            offset += 4 * items
+
+        data["image"] = b""
+        if flags & FLAG_IMAGE:
+            (size,) = struct.unpack_from("<I", packet, offset)
+            data["image"] = packet[offset + 4:offset + 4 + size]
+
+        return {"type": 2, "name": "invoke", "code": 0, "data": data}
+
+
+class Receiver(threading.Thread):
+    def __init__(self, url, encoding, frames):
+        super().__init__(daemon=True)
+        self.url = f"{url}/?encoding={encoding}"
+        self.encoding = encoding
+        self.frames = frames
+        self.decoder = InvokeDecoder()
+        self.arrivals = {}
+        self.bytes = 0
+        self.decode_time = 0.0
+
+    def run(self):
+        ws = websocket.create_connection(self.url)
+        while len(self.arrivals) < self.frames:
+            packet = ws.recv()
+            now = time.monotonic()
+            begin = time.perf_counter()
+            if self.encoding == "binary":
+                event = self.decoder.decode(packet)
+                if event is None:
+                    continue
+            else:
+                event = json.loads(packet)
+                base64.b64decode(event["data"].get("image", ""))
+            self.decode_time += time.perf_counter() - begin
+            self.bytes += len(packet)
+            self.arrivals[event["data"]["count"]] = now
+        ws.close()
+
+
+def compare(url, frames):
+    """Subscribes with both encodings at once and compares the size, decode time and arrival of each event."""
+    receivers = [Receiver(url, "json", frames), Receiver(url, "binary", frames)]
+    for receiver in receivers:
+        receiver.start()
+    for receiver in receivers:
+        receiver.join()
+
+    for receiver in receivers:
+        n = len(receiver.arrivals)
+        print(f"{receiver.encoding:>6}: {receiver.bytes / n:10.0f} bytes/event, decode {receiver.decode_time / n * 1000:.3f} ms/event")
+
+    text, binary = receivers[0].arrivals, receivers[1].arrivals
+    common = sorted(set(text) & set(binary))
+    if common:
+        lead = [(text[c] - binary[c]) * 1000 for c in common]
+        print(f"binary arrives {sum(lead) / len(lead):.2f} ms ahead of json on average ({len(common)} events)")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Compare the json and binary invoke events of a model node")
+    parser.add_argument("--url", default="ws://192.168.42.1:8090")
+    parser.add_argument("--frames", type=int, default=100)
+    args = parser.parse_args()
+    compare(args.url, args.frames)